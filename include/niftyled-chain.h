@@ -87,6 +87,9 @@ NftResult                       led_chain_map_from_frame(LedChain * c, LedFrame
 
 //~ LedCount                                            led_chain_fill_from_tile(LedChain * c, LedTile * t, LedCount offset);
 NftResult                       led_chain_fill_from_frame(LedChain * c, LedFrame * f);
+NftResult                       led_chain_fill_from_frame_rect(LedChain * c, LedFrame * f, LedFrameCord x1, LedFrameCord y1, LedFrameCord x2, LedFrameCord y2);
+NftResult                       led_chain_get_dirty(LedChain * c, LedCount * offset, LedCount * count);
+void                            led_chain_clear_dirty(LedChain * c);
 void                            led_chain_print(LedChain * c, NftLoglevel l);
 void                            led_chain_print_buffer(LedChain * c, NftLoglevel l);
 LedCount                        led_chain_stride_map(LedChain * c, LedCount stride, LedCount offset);
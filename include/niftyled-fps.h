@@ -55,6 +55,13 @@
  * @brief Framerate timing functions
  *
  * Some useful functions to time a desired framerate.
+ * - create a @ref LedFps with led_fps_new()
+ * - call led_fps_wait() right before displaying a frame
+ * - led_fps_get_rate() & led_fps_get_late() tell how well that worked
+ * - free it with led_fps_destroy()
+ *
+ * The old led_fps_sample()/led_fps_delay() API still works on one global
+ * instance:
  * - Initially call led_fps_sample() once
  * - Then call led_fps_delay() right before displaying a frame to delay
  * - call led_fps_sample() right after the frame has been displayed
@@ -68,6 +75,20 @@
 
 
 
+/** frame pacing state (one per output loop) */
+typedef struct _LedFps          LedFps;
+
+
+
+LedFps                         *led_fps_new(double fps);
+void                            led_fps_destroy(LedFps * f);
+NftResult                       led_fps_set_target(LedFps * f, double fps);
+double                          led_fps_get_target(LedFps * f);
+NftResult                       led_fps_set_spin(LedFps * f, long long ns);
+NftResult                       led_fps_start(LedFps * f);
+NftResult                       led_fps_wait(LedFps * f);
+double                          led_fps_get_rate(LedFps * f);
+unsigned long                   led_fps_get_late(LedFps * f);
 
 NftResult                       led_fps_sample();
 NftResult                       led_fps_delay(int fps);
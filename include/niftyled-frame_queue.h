@@ -0,0 +1,130 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/**
+ * @file niftyled-frame_queue.h
+ * @brief queue of frames between a renderer and the hardware output
+ */
+
+
+/**
+ * @addtogroup frame
+ * @{
+ * @defgroup frame_queue LedFrameQueue
+ * @brief hand frames from a rendering thread to an output thread
+ *
+ * A LedFrameQueue owns a small pool of @ref LedFrame buffers. The producer
+ * renders into a frame from led_frame_queue_acquire() and queues it with
+ * led_frame_queue_submit(). The output loop takes the frame that's due with
+ * led_frame_queue_take(), fills, sends & shows it and gives it back with
+ * led_frame_queue_release(). Neither side ever waits for the other one to
+ * render or latch a frame.
+ *
+ * If rendering stalls for a moment, the output loop just shows the last
+ * frame again (or nothing). If it then produces frames faster than they can
+ * be shown, the policy decides which frames are dropped, so a short spike
+ * costs a skipped frame instead of adding latency to every following frame:
+ * - LED_FRAME_QUEUE_DROP_OLDEST: a full queue drops its oldest frame
+ * - LED_FRAME_QUEUE_DROP_NEWEST: a full queue drops the submitted frame
+ * - LED_FRAME_QUEUE_MAILBOX: the newest frame is always shown next and all
+ *   older pending frames are dropped
+ *
+ * Output loop, e.g. with a @ref LedFps:
+ * - f = led_frame_queue_take(q, 0)
+ * - if(f) led_chain_fill_from_frame(chain, f) & led_hardware_send(h)
+ * - led_frame_queue_release(q, f)
+ * - led_fps_wait(fps)
+ * - led_hardware_show(h)
+ * @{
+ */
+
+#ifndef _LED_FRAME_QUEUE_H
+#define _LED_FRAME_QUEUE_H
+
+
+#include "niftyled-frame.h"
+
+
+
+/** which frames are dropped when frames are submitted faster than taken */
+typedef enum
+{
+        /** drop oldest pending frame if queue is full */
+        LED_FRAME_QUEUE_DROP_OLDEST,
+        /** drop submitted frame if queue is full */
+        LED_FRAME_QUEUE_DROP_NEWEST,
+        /** always take newest frame & drop all older pending frames */
+        LED_FRAME_QUEUE_MAILBOX,
+
+        /** always last entry */
+        LED_FRAME_QUEUE_POLICY_MAX
+} LedFrameQueuePolicy;
+
+
+/** queue of frames (s. @ref frame_queue) */
+typedef struct _LedFrameQueue   LedFrameQueue;
+
+
+
+LedFrameQueue                  *led_frame_queue_new(LedFrameCord width, LedFrameCord height, LedPixelFormat * format, int depth, LedFrameQueuePolicy policy);
+void                            led_frame_queue_destroy(LedFrameQueue * q);
+
+LedFrame                       *led_frame_queue_acquire(LedFrameQueue * q);
+NftResult                       led_frame_queue_submit(LedFrameQueue * q, LedFrame * f);
+LedFrame                       *led_frame_queue_take(LedFrameQueue * q, long long timeout);
+NftResult                       led_frame_queue_release(LedFrameQueue * q, LedFrame * f);
+
+LedFrameQueuePolicy             led_frame_queue_get_policy(LedFrameQueue * q);
+int                             led_frame_queue_get_pending(LedFrameQueue * q);
+unsigned long long              led_frame_queue_get_submitted(LedFrameQueue * q);
+unsigned long long              led_frame_queue_get_presented(LedFrameQueue * q);
+unsigned long long              led_frame_queue_get_dropped(LedFrameQueue * q);
+
+
+#endif /* _LED_FRAME_QUEUE_H */
+
+/**
+ * @}
+ * @}
+ */
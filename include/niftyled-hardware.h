@@ -57,6 +57,9 @@
  * All code that actually interfaces the hardware is located in the "plugin"
  * library. 
  * There's one "dummy" plugin family for testing purposes.
+ * The "capture" plugin that is linked into the library records frames in memory
+ * and can simulate transfer- & latch-latencies to benchmark the whole
+ * pipeline without any hardware attached (s. plugins/capture.c)
  *
  * Every LedHardware has:
  * - one or more @ref LedTile defining the physical location of each LED.
@@ -71,6 +74,10 @@
  * - after that @ref led_hardware_init() will open/initialize the hardware and
  * - @ref led_hardware_deinit() will deinitialize it again. (can be re-initialized again)
  * - @ref led_hardware_destroy() will completly free all resources.
+ * - to bring up many adapters at once, use @ref led_hardware_init_deferred()
+ *   for each of them and @ref led_hardware_list_init_deferred() to initialize
+ *   all of them concurrently. (hardware of one plugin family is initialized
+ *   one after the other)
  * - use other functions from this module to interact with the hardware-model.
  * - use led_hardware_list_*() functions to operate on a hardware and all its siblings
  * @{
@@ -86,6 +93,30 @@
 
 
 
+/**
+ * register a statically linked plugin before main() runs.
+ * Put this in the plugin source with the name of its (static) descriptor
+ * instead of exporting a "hardware_descriptor" symbol:
+ * @code
+ * static LedHardwarePlugin _descriptor = { .family = "foo", ... };
+ * LED_HARDWARE_PLUGIN_STATIC(_descriptor)
+ * @endcode
+ * @note when linking against static archives, the object holding the
+ * descriptor has to be linked in (e.g. -Wl,--whole-archive)
+ * @note only defined for compilers that support constructors (GCC & compatible).
+ * Otherwise call led_hardware_plugin_register() before the plugin is used.
+ */
+#ifdef __GNUC__
+#define LED_HARDWARE_PLUGIN_STATIC(descriptor) \
+        static void __attribute__ ((constructor)) \
+        _led_hardware_plugin_static##descriptor() \
+        { \
+                led_hardware_plugin_register(&(descriptor)); \
+        }
+#endif
+
+
+
 /** macro to check if plugin provides function */
 #define LED_HARDWARE_PLUGIN_HAS_FUNC(h, func) ((h) && \
         (led_hardware_get_plugin(h)) && \
@@ -101,6 +132,23 @@ typedef struct _LedHardware     LedHardware;
 #include "niftyled-tile.h"
 
 
+#ifdef WIN32
+#include <stddef.h>
+/** one span of data to send (same layout as struct iovec on POSIX systems) */
+typedef struct
+{
+        /** start of span */
+        void *iov_base;
+        /** size of span in bytes */
+        size_t iov_len;
+} LedIoVec;
+#else
+#include <sys/uio.h>
+/** one span of data to send (can be passed to writev() or sendmsg()) */
+typedef struct iovec LedIoVec;
+#endif
+
+
 
 
 /** dynamic runtime plugin property */
@@ -156,6 +204,106 @@ typedef enum
 
 
 
+/**
+ * wire formats the chain buffer can be encoded to before it's sent
+ * (s. led_hardware_set_wire_encoder())
+ * @note also edit src/hardware/wire.c if you edit this
+ */
+typedef enum
+{
+        /** send chain buffer as it is */
+        LED_WIRE_NONE,
+
+        /** APA102/SK9822: start frame, brightness + 3 bytes per pixel, end frame
+            (pixelformat must have 3 components) */
+        LED_WIRE_APA102,
+        /** WS281x via SPI @ 2.4 MHz: 3 SPI bits per data bit + reset */
+        LED_WIRE_WS281X_SPI,
+        /** DMX512: start code + 512 slots per universe (universes as set
+            with led_hardware_set_universes() or 512 packed slots) */
+        LED_WIRE_DMX512,
+
+        /** always last entry */
+        LED_WIRE_MAX
+} LedWireEncoder;
+
+
+
+/**
+ * how LEDs are distributed over DMX universes
+ * (s. led_hardware_set_universes())
+ */
+typedef enum
+{
+        /** fill every universe completely (pixels may cross universes) */
+        LED_UNIVERSE_PACKED,
+        /** only complete pixels per universe (remaining slots stay unused) */
+        LED_UNIVERSE_PIXEL_ALIGNED,
+
+        /** always last entry */
+        LED_UNIVERSE_MAX
+} LedUniversePacking;
+
+
+/**
+ * one DMX universe of a hardware. A view into the chain buffer that's valid
+ * until the chain changes (s. led_hardware_get_universe())
+ */
+typedef struct
+{
+        /** first slot of universe in chain buffer */
+        const void                     *data;
+        /** amount of slots (bytes) used */
+        size_t                          size;
+        /** position of first LED of universe in chain */
+        LedCount                        offset;
+        /** amount of LEDs in universe */
+        LedCount                        count;
+} LedUniverse;
+
+
+
+/**
+ * pipeline stages that are timed per hardware
+ * (s. led_hardware_get_stage_stats())
+ * @note also edit src/hardware/stats.c if you edit this
+ */
+typedef enum
+{
+        /** led_chain_fill_from_frame() of hardware's chain (excl. convert) */
+        LED_STAGE_FILL,
+        /** pixel-format conversion of the source frame */
+        LED_STAGE_CONVERT,
+        /** passing chain buffer to the plugin (incl. wire encoding) */
+        LED_STAGE_SEND,
+        /** latching by the plugin */
+        LED_STAGE_SHOW,
+
+        /** always last entry */
+        LED_STAGE_MAX
+} LedStage;
+
+
+/**
+ * timing summary of one stage (all times in nanoseconds, percentiles are
+ * precise to about 6%)
+ */
+typedef struct
+{
+        /** amount of recorded values */
+        unsigned long long              count;
+        /** average */
+        long long                       mean;
+        /** median */
+        long long                       p50;
+        /** 99th percentile */
+        long long                       p99;
+        /** maximum */
+        long long                       max;
+} LedStageStats;
+
+
+
 /**
  * @brief plugin-parameter specific data passed to getter/setter 
  * (also s. @ref LedPluginParam)
@@ -208,6 +356,7 @@ typedef union
  * @brief Descriptor of runtime-loadable plugins to access & control LED-hardware adapters
  * (every plugin must provide this)
  * @note descriptor delivered by plugin should be exported with symbol <b>"hardware_descriptor"</b>
+ * (or registered with LED_HARDWARE_PLUGIN_STATIC() if plugin is linked statically)
  *
  * <h3>Developing a hardware-plugin:</h3>
  * Every hardware-plugin must provide a symbol called <b>"hardware_descriptor"</b>
@@ -310,9 +459,62 @@ typedef struct LedHardwarePlugin
          * @p privdata The plugins private data-descriptor from LedHardware->privdata 
          */
         NftResult                       (*show) (void *privdata);
+        /**
+         * send data from chain to hardware as list of spans (s. LedIoVec)
+         * that can be passed to writev() or sendmsg() directly. If provided,
+         * this is used instead of send(). The spans are the header of the
+         * hardware (s. led_hardware_set_header()) - if it has one - followed by the 
+         * part of the chain buffer holding the LEDs to send (or the complete
+         * encoded frame if the hardware has a wire encoder). The plugin may 
+         * patch fields of the header span in place (e.g. length or sequence 
+         * number). All spans are only valid during this call.
+         *
+         * @note function is optional - may be NULL (only used for plugins compiled against plugin API >= 0.1)
+         * @p privdata The plugins private data-descriptor from LedHardware->privdata 
+         * @p iov spans to send
+         * @p iovcnt amount of spans
+         * @p count amount of LEDs to send
+         * @p offset position of first LED to send in chain
+         */
+        NftResult                       (*send_iov) (void *privdata, const LedIoVec * iov, int iovcnt, LedCount count, LedCount offset);
 } LedHardwarePlugin;
 
 
+/**
+ * metadata of an installed hardware-plugin as provided by its
+ * @ref LedHardwarePlugin descriptor (s. led_hardware_plugin_get_info())
+ */
+typedef struct
+{
+        /** family name of the plugin */
+        const char                     *family;
+        /** full path of the plugin library (NULL if statically linked) */
+        const char                     *path;
+        /** api major version */
+        int                             api_major;
+        /** api minor version */
+        int                             api_minor;
+        /** api micro version */
+        int                             api_micro;
+        /** plugin major version */
+        int                             major_version;
+        /** plugin minor version */
+        int                             minor_version;
+        /** plugin micro version */
+        int                             micro_version;
+        /** license string or NULL */
+        const char                     *license;
+        /** author(s) string or NULL */
+        const char                     *author;
+        /** short plugin description string or NULL */
+        const char                     *description;
+        /** plugin URL string or NULL */
+        const char                     *url;
+        /** example ID string or NULL */
+        const char                     *id_example;
+} LedHardwarePluginInfo;
+
+
 
 
 
@@ -323,6 +525,7 @@ typedef struct LedHardwarePlugin
 LedHardware                    *led_hardware_new(const char *name, const char *plugin_name);
 void                            led_hardware_destroy(LedHardware * h);
 NftResult                       led_hardware_init(LedHardware * h, const char *id, LedCount ledcount, const char *pixelformat);
+NftResult                       led_hardware_init_deferred(LedHardware * h, const char *id, LedCount ledcount, const char *pixelformat);
 void                            led_hardware_deinit(LedHardware * h);
 bool                            led_hardware_is_initialized(LedHardware * h);
 
@@ -335,6 +538,13 @@ const char                     *led_hardware_get_name(LedHardware * h);
 LedCount                        led_hardware_get_ledcount(LedHardware * h);
 LedGain                         led_hardware_get_gain(LedHardware * h, LedCount pos);
 void                           *led_hardware_get_privdata(LedHardware * h);
+const void                     *led_hardware_get_header(LedHardware * h, size_t * size);
+LedWireEncoder                  led_hardware_get_wire_encoder(LedHardware * h);
+int                             led_hardware_get_universe_count(LedHardware * h);
+const LedUniverse              *led_hardware_get_universe(LedHardware * h, int n);
+NftResult                       led_hardware_get_stage_stats(LedHardware * h, LedStage stage, LedStageStats * stats);
+unsigned long long              led_hardware_get_late_frames(LedHardware * h);
+unsigned long long              led_hardware_get_dropped_frames(LedHardware * h);
 
 //const char *            led_hardware_get_propname(LedHardware *h, const char *propname);
 
@@ -345,20 +555,32 @@ NftResult                       led_hardware_set_name(LedHardware * h, const cha
 NftResult                       led_hardware_set_ledcount(LedHardware * h, LedCount leds);
 NftResult                       led_hardware_set_gain(LedHardware * h, LedCount pos, LedGain gain);
 NftResult                       led_hardware_set_privdata(LedHardware * h, void *privdata);
+NftResult                       led_hardware_set_header(LedHardware * h, const void *header, size_t size);
+NftResult                       led_hardware_set_wire_encoder(LedHardware * h, LedWireEncoder e);
+NftResult                       led_hardware_set_universes(LedHardware * h, size_t slots, LedUniversePacking packing);
+NftResult                       led_hardware_set_frame_budget(LedHardware * h, long long ns);
 
 NftResult                       led_hardware_append_tile(LedHardware * h, LedTile * t);
 void                            led_hardware_print(LedHardware * h, NftLoglevel l);
 NftResult                       led_hardware_send(LedHardware * h);
+NftResult                       led_hardware_send_dirty(LedHardware * h);
 NftResult                       led_hardware_show(LedHardware * h);
 NftResult                       led_hardware_refresh_gain(LedHardware * h);
 NftResult                       led_hardware_refresh_mapping(LedHardware * h);
+const void                     *led_hardware_wire_encode(LedHardware * h, LedCount count, LedCount offset, size_t * size);
+const char                     *led_hardware_wire_encoder_to_string(LedWireEncoder e);
+LedWireEncoder                  led_hardware_wire_encoder_from_string(const char *name);
+void                            led_hardware_reset_stats(LedHardware * h);
+const char                     *led_hardware_stage_to_string(LedStage stage);
 
 /* LedHardware linked list functions */
 void                            led_hardware_list_destroy(LedHardware * first);
 NftResult                       led_hardware_list_append_head(LedHardware * head, LedHardware * sibling);
+NftResult                       led_hardware_list_init_deferred(LedHardware * first, int threads);
 NftResult                       led_hardware_list_refresh_gain(LedHardware * first);
 NftResult                       led_hardware_list_refresh_mapping(LedHardware * first);
 NftResult                       led_hardware_list_send(LedHardware * first);
+NftResult                       led_hardware_list_send_dirty(LedHardware * first);
 NftResult                       led_hardware_list_show(LedHardware * first);
 
 int                             led_hardware_list_get_length(LedHardware * h);
@@ -374,6 +596,10 @@ void                            led_hardware_plugin_print_all();
 void                           *led_hardware_plugin_get_privdata(LedHardware * h);
 const char                     *led_hardware_plugin_get_family(LedHardware * h);
 const char                     *led_hardware_plugin_get_family_by_n(unsigned int num);
+NftResult                       led_hardware_plugin_register(LedHardwarePlugin * plugin);
+NftResult                       led_hardware_plugin_rescan();
+const LedHardwarePluginInfo    *led_hardware_plugin_get_info(const char *family);
+const LedHardwarePluginInfo    *led_hardware_plugin_get_info_by_n(unsigned int num);
 const char                     *led_hardware_plugin_get_license(LedHardware * h);
 const char                     *led_hardware_plugin_get_author(LedHardware * h);
 const char                     *led_hardware_plugin_get_description(LedHardware * h);
@@ -63,6 +63,9 @@
 /** name of the LedChain object for NftPrefs */
 #define LED_CHAIN_NAME  "chain"
 
+/** name of nodes inside a chain that generate LEDs procedurally */
+#define LED_CHAIN_LAYOUT_NAME "layout"
+
 
 
 bool                            led_prefs_is_chain_node(LedPrefsNode * n);
@@ -73,7 +73,9 @@
 
 
 LedSetup                       *led_prefs_setup_from_node(LedPrefs * p, LedPrefsNode * n);
+LedSetup                       *led_prefs_setup_from_node_arena(LedPrefs * p, LedPrefsNode * n);
 LedPrefsNode                   *led_prefs_setup_to_node(LedPrefs * p, LedSetup * s);
+LedSetup                       *led_prefs_setup_from_file_stream(const char *filename);
 
 
 #endif /* _LED_PREFS_SETUP_H */
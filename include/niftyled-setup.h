@@ -68,6 +68,17 @@
 /** LedSetup model */
 typedef struct _LedSetup        LedSetup;
 
+/** one horizontal run of pixels that is sampled by at least one LED */
+typedef struct
+{
+        /** x-coordinate of first pixel in this span */
+        LedFrameCord x;
+        /** y-coordinate (row) of this span */
+        LedFrameCord y;
+        /** amount of consecutive pixels in this span */
+        LedFrameCord width;
+} LedFrameSpan;
+
 
 
 LedSetup                       *led_setup_new();
@@ -77,6 +88,9 @@ void                            led_setup_set_hardware(LedSetup * s, LedHardware
 LedHardware                    *led_setup_get_hardware(LedSetup * s);
 
 NftResult                       led_setup_get_dim(LedSetup * s, LedFrameCord * width, LedFrameCord * height);
+NftResult                       led_setup_get_bounding_box(LedSetup * s, LedFrameCord * x1, LedFrameCord * y1, LedFrameCord * x2, LedFrameCord * y2);
+LedFrameSpan                   *led_setup_get_spans(LedSetup * s, LedCount * count);
+void                            led_setup_spans_free(LedFrameSpan * spans);
 
 
 
@@ -0,0 +1,123 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+
+/**
+ * @file niftyled-space.h
+ */
+
+
+/**
+ * @addtogroup setup
+ * @{
+ * @defgroup space LedSpace
+ * @brief render target that exposes the mapped LEDs of a setup
+ *
+ * Procedural effects often don't need a pixel frame at all. A LedSpace holds
+ * the frame-coordinates and components of all mapped LEDs of a @ref LedSetup
+ * as packed arrays (structure of arrays), so an effect can calculate one
+ * greyscale value per LED and write it directly to the hardware chains.
+ * No @ref LedFrame is rendered and led_chain_fill_from_frame() is skipped.
+ *
+ * - call led_hardware_list_refresh_mapping()
+ * - create a LedSpace using led_space_new()
+ * - for every LED n < led_space_get_ledcount(), calculate a value from
+ *   led_space_get_x()[n], led_space_get_y()[n] and
+ *   led_space_get_component()[n] and store it with led_space_set_greyscale()
+ * - send & show hardware as usual
+ * - call led_space_refresh() whenever the mapping changed
+ *
+ * A LedSpace also sorts its LEDs into a grid of cells, so LEDs inside a
+ * rectangle or radius (e.g. for localized effects or touch input) can be
+ * found with led_space_find_rect() and led_space_find_radius() without
+ * testing every LED of the setup.
+ * @{
+ */
+
+#ifndef _LED_SPACE_H
+#define _LED_SPACE_H
+
+
+#include "niftyled-setup.h"
+
+
+
+
+/** LedSpace model */
+typedef struct _LedSpace        LedSpace;
+
+/** one LED found by a spatial query */
+typedef struct
+{
+        /** position of hardware chain in LedSpace (s. led_space_get_chain()) */
+        int chain;
+        /** position of LED in that chain */
+        LedCount led;
+} LedSpaceHit;
+
+
+
+LedSpace                       *led_space_new(LedSetup * s);
+void                            led_space_destroy(LedSpace * sp);
+NftResult                       led_space_refresh(LedSpace * sp);
+
+LedCount                        led_space_get_ledcount(LedSpace * sp);
+const LedFrameCord             *led_space_get_x(LedSpace * sp);
+const LedFrameCord             *led_space_get_y(LedSpace * sp);
+const LedFrameComponent        *led_space_get_component(LedSpace * sp);
+
+int                             led_space_get_chain_count(LedSpace * sp);
+LedChain                       *led_space_get_chain(LedSpace * sp, int n, LedCount * offset);
+
+NftResult                       led_space_set_greyscale(LedSpace * sp, LedCount n, long long int value);
+
+LedCount                        led_space_find_rect(LedSpace * sp, LedFrameCord x1, LedFrameCord y1, LedFrameCord x2, LedFrameCord y2, LedSpaceHit * hits, LedCount size);
+LedCount                        led_space_find_radius(LedSpace * sp, LedFrameCord x, LedFrameCord y, LedFrameCord radius, LedSpaceHit * hits, LedCount size);
+
+
+#endif /* _LED_SPACE_H */
+
+/**
+ * @}
+ * @}
+ */
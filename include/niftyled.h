@@ -81,8 +81,10 @@
 #include "niftyled-frame.h"
 #include "niftyled-hardware.h"
 #include "niftyled-setup.h"
+#include "niftyled-space.h"
 #include "niftyled-tile.h"
 #include "niftyled-fps.h"
+#include "niftyled-frame_queue.h"
 
 #include "niftyled-prefs.h"
 #include "niftyled-prefs_setup.h"
@@ -90,6 +92,7 @@
 #include "niftyled-prefs_led.h"
 #include "niftyled-prefs_chain.h"
 #include "niftyled-prefs_tile.h"
+#include "niftyled-prefs_cache.h"
 
 
 
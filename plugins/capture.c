@@ -0,0 +1,599 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file capture.c
+ *
+ * "capture" hardware-plugin
+ *
+ * In-memory plugin that doesn't talk to any device. Data passed to send() is
+ * copied into a transmit buffer, every show() latches that buffer into a
+ * ring of the last captured frames. Transfer- and latch-times of real
+ * hardware can be simulated, so the complete frame -> chain -> send -> show
+ * pipeline can be benchmarked & tested without any LED hardware attached.
+ * Use a ringsize of 0 to get a pure "null" sink that only counts.
+ * If the hardware has a wire encoder, the encoded frames are captured.
+ * The plugin is linked into the library and always available.
+ *
+ * Custom properties:
+ * - "ringsize" (int) amount of frames kept (default: 4, resets capture)
+ * - "byte_latency" (int) simulated transfer time per byte sent in ns
+ * - "show_latency" (int) simulated time to latch a frame in us
+ * - "frames" (string) decimal amount of frames shown so far (read-only)
+ * - "bytes" (string) decimal amount of bytes sent so far (read-only)
+ * - "frame_age" (int) select captured frame for "frame" (0 = newest)
+ * - "frame" (string) hex-dump of selected frame (read-only)
+ */
+
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "niftyled.h"
+
+
+
+/** default amount of frames to keep */
+#define CAPTURE_RINGSIZE_DEFAULT        4
+/** maximum length of hardware id */
+#define CAPTURE_ID_MAXSIZE              64
+/** maximum length of a decimal counter value */
+#define CAPTURE_COUNTER_MAXSIZE         24
+
+
+
+/** private descriptor of one capture instance */
+typedef struct
+{
+        /** LedHardware we belong to */
+        LedHardware *hw;
+        /** id passed to hw_init() */
+        char id[CAPTURE_ID_MAXSIZE];
+        /** amount of LEDs */
+        LedCount ledcount;
+        /** gain of every LED */
+        LedGain *gain;
+        /** data received by send() */
+        unsigned char *tx;
+        /** size of one frame in bytes */
+        size_t framesize;
+        /** captured frames (ringsize * framesize bytes) */
+        unsigned char *ring;
+        /** amount of frames ring can hold */
+        int ringsize;
+        /** position of next frame in ring */
+        int head;
+        /** simulated transfer time per byte (ns) */
+        int byte_latency;
+        /** simulated latch time (us) */
+        int show_latency;
+        /** frames shown */
+        unsigned long long frames;
+        /** bytes sent */
+        unsigned long long bytes;
+        /** frame selected for "frame" property */
+        int frame_age;
+        /** hex-dump buffer for "frame" property */
+        char *dump;
+        /** buffer for "frames" & "bytes" properties */
+        char counter[CAPTURE_COUNTER_MAXSIZE];
+} Capture;
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** sleep some nanoseconds */
+static void _delay(long long ns)
+{
+        if(ns <= 0)
+                return;
+
+        struct timespec t = {
+                .tv_sec = ns / 1000000000LL,
+                .tv_nsec = ns % 1000000000LL
+        };
+
+        /* sleep remaining time if we got interrupted */
+        while(nanosleep(&t, &t) == -1 && errno == EINTR);
+}
+
+
+/** forget all captured frames */
+static void _reset(Capture * c)
+{
+        free(c->ring);
+        c->ring = NULL;
+        c->head = 0;
+        c->frames = 0;
+        c->bytes = 0;
+}
+
+
+/** (re)allocate transmit buffer & ring for frames of "size" bytes */
+static NftResult _resize(Capture * c, size_t size)
+{
+        if(size == c->framesize && (c->ring || c->ringsize == 0))
+                return NFT_SUCCESS;
+
+        _reset(c);
+
+        c->framesize = 0;
+        if(size == 0)
+                return NFT_SUCCESS;
+
+        unsigned char *tx;
+        if(!(tx = realloc(c->tx, size)))
+        {
+                NFT_LOG_PERROR("realloc");
+                return NFT_FAILURE;
+        }
+        memset(tx, 0, size);
+        c->tx = tx;
+        c->framesize = size;
+
+        if(c->ringsize > 0 &&
+           !(c->ring = calloc((size_t) c->ringsize, size)))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** set amount of LEDs */
+static NftResult _set_ledcount(Capture * c, LedCount ledcount)
+{
+        LedGain *gain;
+        if(!(gain = realloc(c->gain, sizeof(LedGain) * (ledcount ? ledcount : 1))))
+        {
+                NFT_LOG_PERROR("realloc");
+                return NFT_FAILURE;
+        }
+
+        LedCount i;
+        for(i = c->ledcount; i < ledcount; i++)
+                gain[i] = LED_GAIN_MAX;
+
+        c->gain = gain;
+        c->ledcount = ledcount;
+
+        return NFT_SUCCESS;
+}
+
+
+/** create hex-dump of frame "age" frames ago */
+static const char *_dump(Capture * c, int age)
+{
+        int captured = c->frames < (unsigned long long) c->ringsize ?
+                (int) c->frames : c->ringsize;
+        if(!c->ring || age < 0 || age >= captured)
+        {
+                NFT_LOG(L_ERROR, "No captured frame %d (got %d)", age,
+                        captured);
+                return NULL;
+        }
+
+        char *dump;
+        if(!(dump = realloc(c->dump, c->framesize * 2 + 1)))
+        {
+                NFT_LOG_PERROR("realloc");
+                return NULL;
+        }
+        c->dump = dump;
+
+        int slot = (c->head - 1 - age + c->ringsize) % c->ringsize;
+        unsigned char *frame = c->ring + (size_t) slot * c->framesize;
+
+        size_t i;
+        for(i = 0; i < c->framesize; i++)
+                sprintf(&dump[i * 2], "%02x", frame[i]);
+        dump[c->framesize * 2] = '\0';
+
+        return dump;
+}
+
+
+/** set custom property */
+static NftResult _set_prop(Capture * c, LedPluginParamData * data)
+{
+        const char *name = data->custom.name;
+        int i = data->custom.value.i;
+
+        if(strcmp(name, "ringsize") == 0)
+        {
+                if(i < 0)
+                {
+                        NFT_LOG(L_ERROR, "Invalid ringsize: %d", i);
+                        return NFT_FAILURE;
+                }
+                c->ringsize = i;
+                /* force reallocation */
+                _reset(c);
+                return _resize(c, c->framesize);
+        }
+        else if(strcmp(name, "byte_latency") == 0)
+                c->byte_latency = i;
+        else if(strcmp(name, "show_latency") == 0)
+                c->show_latency = i;
+        else if(strcmp(name, "frame_age") == 0)
+                c->frame_age = i;
+        else
+        {
+                NFT_LOG(L_ERROR, "Property \"%s\" can't be set", name);
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** get custom property */
+static NftResult _get_prop(Capture * c, LedPluginParamData * data)
+{
+        const char *name = data->custom.name;
+
+        if(strcmp(name, "frame") == 0)
+        {
+                const char *dump;
+                if(!(dump = _dump(c, c->frame_age)))
+                        return NFT_FAILURE;
+                data->custom.value.s = (char *) dump;
+                data->custom.valuesize = strlen(dump) + 1;
+                return NFT_SUCCESS;
+        }
+
+        /* counters don't fit into an int property */
+        if(strcmp(name, "frames") == 0 || strcmp(name, "bytes") == 0)
+        {
+                snprintf(c->counter, sizeof(c->counter), "%llu",
+                         name[0] == 'f' ? c->frames : c->bytes);
+                data->custom.value.s = c->counter;
+                data->custom.valuesize = strlen(c->counter) + 1;
+                return NFT_SUCCESS;
+        }
+
+        if(strcmp(name, "ringsize") == 0)
+                data->custom.value.i = c->ringsize;
+        else if(strcmp(name, "byte_latency") == 0)
+                data->custom.value.i = c->byte_latency;
+        else if(strcmp(name, "show_latency") == 0)
+                data->custom.value.i = c->show_latency;
+        else if(strcmp(name, "frame_age") == 0)
+                data->custom.value.i = c->frame_age;
+        else
+        {
+                NFT_LOG(L_ERROR, "Unknown property \"%s\"", name);
+                return NFT_FAILURE;
+        }
+
+        data->custom.valuesize = sizeof(int);
+
+        return NFT_SUCCESS;
+}
+
+
+
+/******************************************************************************/
+/**************************** PLUGIN FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** initialize plugin */
+static NftResult _plugin_init(void **privdata, LedHardware * h)
+{
+        Capture *c;
+        if(!(c = calloc(1, sizeof(Capture))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NFT_FAILURE;
+        }
+
+        c->hw = h;
+        c->ringsize = CAPTURE_RINGSIZE_DEFAULT;
+
+        /* register custom properties */
+        if(!led_hardware_plugin_prop_register(h, "ringsize",
+                                              LED_HW_CUSTOM_PROP_INT) ||
+           !led_hardware_plugin_prop_register(h, "byte_latency",
+                                              LED_HW_CUSTOM_PROP_INT) ||
+           !led_hardware_plugin_prop_register(h, "show_latency",
+                                              LED_HW_CUSTOM_PROP_INT) ||
+           !led_hardware_plugin_prop_register(h, "frames",
+                                              LED_HW_CUSTOM_PROP_STRING) ||
+           !led_hardware_plugin_prop_register(h, "bytes",
+                                              LED_HW_CUSTOM_PROP_STRING) ||
+           !led_hardware_plugin_prop_register(h, "frame_age",
+                                              LED_HW_CUSTOM_PROP_INT) ||
+           !led_hardware_plugin_prop_register(h, "frame",
+                                              LED_HW_CUSTOM_PROP_STRING))
+        {
+                free(c);
+                return NFT_FAILURE;
+        }
+
+        *privdata = c;
+
+        return NFT_SUCCESS;
+}
+
+
+/** deinitialize plugin */
+static void _plugin_deinit(void *privdata)
+{
+        Capture *c = privdata;
+
+        /* unregister custom properties */
+        led_hardware_plugin_prop_unregister(c->hw, "ringsize");
+        led_hardware_plugin_prop_unregister(c->hw, "byte_latency");
+        led_hardware_plugin_prop_unregister(c->hw, "show_latency");
+        led_hardware_plugin_prop_unregister(c->hw, "frames");
+        led_hardware_plugin_prop_unregister(c->hw, "bytes");
+        led_hardware_plugin_prop_unregister(c->hw, "frame_age");
+        led_hardware_plugin_prop_unregister(c->hw, "frame");
+
+        _reset(c);
+        free(c->tx);
+        free(c->gain);
+        free(c->dump);
+        free(c);
+}
+
+
+/** initialize "hardware" */
+static NftResult _hw_init(void *privdata, const char *id)
+{
+        Capture *c = privdata;
+
+        strncpy(c->id, id ? id : "", sizeof(c->id) - 1);
+
+        return NFT_SUCCESS;
+}
+
+
+/** get parameter */
+static NftResult _get(void *privdata, LedPluginParam param,
+                      LedPluginParamData * data)
+{
+        Capture *c = privdata;
+
+        switch (param)
+        {
+                case LED_HW_ID:
+                {
+                        data->id = c->id;
+                        return NFT_SUCCESS;
+                }
+
+                case LED_HW_LEDCOUNT:
+                {
+                        data->ledcount = c->ledcount;
+                        return NFT_SUCCESS;
+                }
+
+                case LED_HW_GAIN:
+                {
+                        if(data->gain.pos < 0 ||
+                           data->gain.pos >= c->ledcount)
+                                return NFT_FAILURE;
+
+                        data->gain.value = c->gain[data->gain.pos];
+                        return NFT_SUCCESS;
+                }
+
+                case LED_HW_CUSTOM_PROP:
+                {
+                        return _get_prop(c, data);
+                }
+
+                default:
+                {
+                        return NFT_FAILURE;
+                }
+        }
+}
+
+
+/** set parameter */
+static NftResult _set(void *privdata, LedPluginParam param,
+                      LedPluginParamData * data)
+{
+        Capture *c = privdata;
+
+        switch (param)
+        {
+                case LED_HW_ID:
+                {
+                        strncpy(c->id, data->id, sizeof(c->id) - 1);
+                        return NFT_SUCCESS;
+                }
+
+                case LED_HW_LEDCOUNT:
+                {
+                        return _set_ledcount(c, data->ledcount);
+                }
+
+                case LED_HW_GAIN:
+                {
+                        /* set all LEDs? */
+                        if(data->gain.pos < 0)
+                        {
+                                LedCount i;
+                                for(i = 0; i < c->ledcount; i++)
+                                        c->gain[i] = data->gain.value;
+                                return NFT_SUCCESS;
+                        }
+
+                        if(data->gain.pos >= c->ledcount)
+                                return NFT_FAILURE;
+
+                        c->gain[data->gain.pos] = data->gain.value;
+                        return NFT_SUCCESS;
+                }
+
+                case LED_HW_CUSTOM_PROP:
+                {
+                        return _set_prop(c, data);
+                }
+
+                default:
+                {
+                        return NFT_FAILURE;
+                }
+        }
+}
+
+
+/** receive LEDs from chain */
+static NftResult _send(void *privdata, LedChain * chain, LedCount count,
+                       LedCount offset)
+{
+        Capture *c = privdata;
+
+        /* capture encoded frame if hardware has a wire encoder */
+        if(led_hardware_get_wire_encoder(c->hw) != LED_WIRE_NONE)
+        {
+                const void *frame;
+                size_t size;
+                if(!(frame = led_hardware_wire_encode(c->hw, count, offset,
+                                                      &size)))
+                        return NFT_FAILURE;
+
+                if(!_resize(c, size))
+                        return NFT_FAILURE;
+
+                memcpy(c->tx, frame, size);
+                c->bytes += size;
+
+                /* simulate transfer */
+                _delay((long long) c->byte_latency * (long long) size);
+
+                return NFT_SUCCESS;
+        }
+
+        if(!_resize(c, led_chain_get_buffer_size(chain)))
+                return NFT_FAILURE;
+
+        /* one LED is one component of a pixel */
+        LedPixelFormat *f = led_chain_get_format(chain);
+        size_t components = led_pixel_format_get_n_components(f);
+        size_t bpc = components ?
+                led_pixel_format_get_bytes_per_pixel(f) / components : 0;
+
+        /* an incomplete last pixel isn't part of the chain buffer */
+        size_t start = (size_t) offset * bpc;
+        size_t size = (size_t) count * bpc;
+        if(start > c->framesize)
+                start = c->framesize;
+        if(size > c->framesize - start)
+                size = c->framesize - start;
+
+        memcpy(c->tx + start,
+               (unsigned char *) led_chain_get_buffer(chain) + start, size);
+        c->bytes += size;
+
+        /* simulate transfer */
+        _delay((long long) c->byte_latency * (long long) size);
+
+        return NFT_SUCCESS;
+}
+
+
+/** latch received LEDs */
+static NftResult _show(void *privdata)
+{
+        Capture *c = privdata;
+
+        /* capture frame */
+        if(c->ring && c->framesize)
+        {
+                memcpy(c->ring + (size_t) c->head * c->framesize, c->tx,
+                       c->framesize);
+                c->head = (c->head + 1) % c->ringsize;
+        }
+        c->frames++;
+
+        /* simulate latch */
+        _delay((long long) c->show_latency * 1000LL);
+
+        return NFT_SUCCESS;
+}
+
+
+
+/** descriptor of this plugin */
+static LedHardwarePlugin _descriptor = {
+        .family = "capture",
+        .api_major = LED_HW_PLUGIN_API_MAJOR_VERSION,
+        .api_minor = LED_HW_PLUGIN_API_MINOR_VERSION,
+        .api_micro = LED_HW_PLUGIN_API_MICRO_VERSION,
+        .major_version = LED_MAJOR_VERSION,
+        .minor_version = LED_MINOR_VERSION,
+        .micro_version = LED_MICRO_VERSION,
+        .license = "MIT/LGPL-2.1",
+        .author = "niftyled contributors",
+        .description = "in-memory capture of frames for testing & benchmarks",
+        .url = PACKAGE_URL,
+        .id_example = "capture0",
+        .plugin_init = _plugin_init,
+        .plugin_deinit = _plugin_deinit,
+        .hw_init = _hw_init,
+        .get = _get,
+        .set = _set,
+        .send = _send,
+        .show = _show,
+};
+
+/* linked into the library */
+#ifdef LED_HARDWARE_PLUGIN_STATIC
+LED_HARDWARE_PLUGIN_STATIC(_descriptor)
+#endif
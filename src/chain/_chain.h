@@ -45,11 +45,14 @@
 #ifndef _LED__CHAIN_H
 #define _LED__CHAIN_H
 
+#include "led/_led.h"
 
 void                            _chain_destroy(LedChain * c);
 NftResult                       _chain_set_parent_tile(LedChain * c, LedTile * t);
 NftResult                       _chain_set_parent_hardware(LedChain * c, LedHardware * h);
 NftResult                       _chain_set_ledcount(LedChain * c, LedCount ledcount);
+LedArray                       *_chain_get_leds(LedChain * c);
+void                            _chain_positions_changed(LedChain * c);
 
 
 
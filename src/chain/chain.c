@@ -54,11 +54,19 @@
  * @{
  */
 
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <math.h>
 #include <stdio.h>
 #include <stdint.h>
 #include "niftyled-chain.h"
 #include "led/_led.h"
+#include "_chain.h"
+#include "_tile.h"
+#include "_hardware.h"
+#include "_arena.h"
 
 
 
@@ -66,9 +74,21 @@
 #define MIN(a,b) (((a)<(b))?(a):(b))
 /** helper macro */
 #define MAX(a,b) (((a)>(b))?(a):(b))
+/** timing statistics of parent hardware (or NULL) */
+#define CHAIN_STATS(c) ((c)->parent_hw ? _hardware_get_stats((c)->parent_hw) : NULL)
+
 
 
 
+/** one entry of the reverse mapping-index */
+typedef struct
+{
+        /** frame-pixel the LED is mapped to */
+        int pixel;
+        /** position of LED in chain */
+        LedCount led;
+} MapEntry;
+
 
 /** model of one serial chain of LEDs */
 struct _LedChain
@@ -84,10 +104,15 @@ struct _LedChain
         LedPixelFormatConverter *converter;
         /** temporary frame in src_format, internally used for conversions if formats differ */
         LedFrame *tmpframe;
-        /** array of leds holding "ledcount" Led descriptors */
-        Led *leds;
+        /** properties of all "ledcount" LEDs */
+        LedArray leds;
+        /** Led descriptors handed out by led_chain_get_nth() (allocated on
+            first use for the capacity of "leds") */
+        Led *views;
         /** buffersize in bytes */
         size_t buffersize;
+        /** amount of bytes allocated for ledbuffer (>= buffersize) */
+        size_t buffercapacity;
         /** buffer that holds LEDs' greyscale-values */
         void *ledbuffer;
         /** if this chain belongs to a tile, this contains the pointer of the tile */
@@ -97,8 +122,32 @@ struct _LedChain
         /**
          * temporary mapping-buffer. holds one offset per led in chain.
          * Offset points to coresponding location in LedFrame of same LedPixelFormat
+         * (allocated for at least the capacity of "leds")
          */
         int *mapoffsets;
+        /** amount of offsets allocated for mapoffsets */
+        LedCount mapcapacity;
+        /**
+         * reverse mapping-index built by led_chain_map_from_frame().
+         * Holds all mapped LEDs sorted by frame-pixel so the LEDs under a
+         * rectangle of the frame can be found row by row
+         */
+        struct
+        {
+                /** dimensions of the mapped frame (0 if there's no index) */
+                LedFrameCord width, height;
+                /** "height+1" positions in "entries" where each row starts */
+                LedCount *rows;
+                /** one entry per mapped LED */
+                MapEntry *entries;
+        } map;
+        /** range of LEDs changed since the last led_chain_clear_dirty() */
+        struct
+        {
+                LedCount first;
+                /** 0 if chain is clean */
+                LedCount count;
+        } dirty;
         /** private userdata */
         void *privdata;
 };
@@ -159,6 +208,158 @@ static int _print_greyscale_value(LedChain * c, long long int *v,
 }
 
 
+/** free reverse mapping-index of a chain */
+static void _map_free(LedChain * c)
+{
+        _arena_free(c->map.rows);
+        _arena_free(c->map.entries);
+        c->map.rows = NULL;
+        c->map.entries = NULL;
+        c->map.width = 0;
+        c->map.height = 0;
+}
+
+
+/** qsort() helper to sort MapEntries by frame-pixel (then by LED) */
+static int _map_compare(const void *a, const void *b)
+{
+        const MapEntry *m = a;
+        const MapEntry *n = b;
+
+        if(m->pixel != n->pixel)
+                return m->pixel < n->pixel ? -1 : 1;
+
+        return (m->led > n->led) - (m->led < n->led);
+}
+
+
+/** add one LED to the range of LEDs that changed */
+static inline void _mark_dirty(LedChain * c, LedCount pos)
+{
+        if(c->dirty.count == 0)
+        {
+                c->dirty.first = pos;
+                c->dirty.count = 1;
+                return;
+        }
+
+        LedCount end = MAX(c->dirty.first + c->dirty.count, pos + 1);
+        c->dirty.first = MIN(c->dirty.first, pos);
+        c->dirty.count = end - c->dirty.first;
+}
+
+
+/**
+ * prepare frame to be used as source for filling a chain
+ *
+ * Converts endianness and - if frame- & chain-format differ - prepares the
+ * temporary frame of the chain & a converter. Pixels still need to be
+ * converted by _source_convert() if the result isn't "f".
+ *
+ * @result frame with chain's format or NULL upon error
+ */
+static LedFrame *_source_frame(LedChain * c, LedFrame * f)
+{
+#ifdef WORDS_BIGENDIAN
+        /* convert little to big endian? */
+        if(!led_frame_get_big_endian(f))
+        {
+                led_frame_convert_endianness(f);
+
+                /* mark frame as converted */
+                led_frame_set_big_endian(f, true);
+        }
+#else
+        /* convert big to little endian? */
+        if(led_frame_get_big_endian(f))
+        {
+                led_frame_convert_endianness(f);
+
+                /* mark frame as converted */
+                led_frame_set_big_endian(f, false);
+        }
+#endif
+
+        /* frame format == chain format? */
+        if(led_pixel_format_is_equal(c->format, led_frame_get_format(f)))
+                return f;
+
+        /* do we have a tmpframe already but dimensions differ? */
+        LedFrameCord width, height;
+        if(!led_frame_get_dim(f, &width, &height))
+                return NULL;
+
+        if(c->tmpframe)
+        {
+                LedFrameCord wT, hT;
+                if(!led_frame_get_dim(c->tmpframe, &wT, &hT))
+                        return NULL;
+                if((wT != width) || (hT != height))
+                {
+                        /* free tmpframe for we will allocate a new one below */
+                        led_frame_destroy(c->tmpframe);
+                        c->tmpframe = NULL;
+                }
+        }
+
+        /* do we need a new temporary frame? */
+        if(!c->tmpframe)
+        {
+                /* create new temp-frame with dimensions of src-frame and
+                 * format of this chain */
+                if(!(c->tmpframe = led_frame_new(width, height, c->format)))
+                {
+                        return NULL;
+                }
+
+                /* copy endianness of our frame to tmpframe */
+                led_frame_set_big_endian(c->tmpframe,
+                                         led_frame_get_big_endian(f));
+        }
+
+        /* do we need a converter? */
+        LedPixelFormat *format = led_frame_get_format(f);
+        if(!c->converter || !led_pixel_format_is_equal(c->src_format, format))
+        {
+                /* get new converter */
+                if(!(c->converter =
+                     led_pixel_format_get_converter(format, c->format)))
+                {
+                        NFT_LOG(L_ERROR,
+                                "Failed to create converter for color-conversion");
+                        return NULL;
+                }
+
+                /* save src-format */
+                c->src_format = format;
+        }
+
+        return c->tmpframe;
+}
+
+
+/**
+ * convert "count" pixels starting at "pixel" of "f" into the temporary
+ * frame prepared by _source_frame()
+ */
+static void _source_convert(LedChain * c, LedFrame * f,
+                            size_t pixel, size_t count)
+{
+        LedPixelFormat *format = led_frame_get_format(f);
+        char *src = led_frame_get_buffer(f);
+        char *dst = led_frame_get_buffer(c->tmpframe);
+        led_pixel_format_convert(c->converter,
+                                 src +
+                                 pixel *
+                                 led_pixel_format_get_bytes_per_pixel(format),
+                                 dst +
+                                 pixel *
+                                 led_pixel_format_get_bytes_per_pixel(c->
+                                                                      format),
+                                 count);
+}
+
+
 /******************************************************************************/
 /************************ "private" API FUNCTIONS *****************************/
 /******************************************************************************/
@@ -222,14 +423,18 @@ void _chain_destroy(LedChain * c)
         // ~ led_settings_chain_unregister(c);
 
 
-        /* free LED descriptor array */
-        free(c->leds);
+        /* free LED descriptors */
+        _array_free(&c->leds);
+        _arena_free(c->views);
 
         /* free LED-buffer */
-        free(c->ledbuffer);
+        _arena_free(c->ledbuffer);
 
         /* free mapbuffer */
-        free(c->mapoffsets);
+        _arena_free(c->mapoffsets);
+
+        /* free reverse mapping-index */
+        _map_free(c);
 
         /* free temporary frame */
         led_frame_destroy(c->tmpframe);
@@ -238,13 +443,16 @@ void _chain_destroy(LedChain * c)
         led_pixel_format_destroy();
 
         /* free our very own space */
-        free(c);
+        _arena_free(c);
 }
 
 
 /**
  * internal function to change amount of ledcount of a chain (API wrapper contains some checks)
  *
+ * Buffers grow geometrically and never shrink, so adding LEDs one at a time
+ * is amortized O(1)
+ *
  * @param c to change ledcount
  * @param ledcount new amount of LEDs in this chain
  * @result NFT_SUCCESS or NFT_FAILURE
@@ -261,65 +469,118 @@ NftResult _chain_set_ledcount(LedChain * c, LedCount ledcount)
                                                            components);
 
 
-        /* allocate new ledbuffer */
-        void *newbuf;
-        if(!(newbuf = malloc(nbufsize)))
+        /* remember capacity of LED descriptors */
+        LedCount ocapacity = c->leds.capacity;
+
+
+        /* grow ledbuffer geometrically if it's too small (keeps old values) */
+        if(nbufsize > c->buffercapacity)
         {
-                NFT_LOG_PERROR("malloc");
-                return NFT_FAILURE;
+                size_t capacity = MAX(nbufsize, c->buffercapacity * 2);
+
+                void *newbuf;
+                if(!(newbuf = _arena_realloc(c->ledbuffer, capacity)))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+
+                c->ledbuffer = newbuf;
+                c->buffercapacity = capacity;
         }
 
-        /** copy old ledbuffer into new buffer */
-        memcpy(newbuf, c->ledbuffer, MIN(nbufsize, obufsize));
+        /* clear greyscale-values of new LEDs */
+        if(nbufsize > obufsize)
+                memset((char *) c->ledbuffer + obufsize, 0, nbufsize - obufsize);
 
 
-        /* allocate new mapping buffer */
-        int *mapoffsets;
-        if(!(mapoffsets = calloc(ledcount, sizeof(int))))
-        {
-                NFT_LOG_PERROR("malloc");
-                free(newbuf);
+        /** resize LED-descriptors (keeps old LEDs) */
+        if(!_array_set_count(&c->leds, ledcount))
                 return NFT_FAILURE;
-        }
 
-        /* copy old mapbuffer into new buffer */
-        memcpy(mapoffsets, c->mapoffsets,
-               MIN((ledcount * sizeof(int)), (c->ledcount * sizeof(int))));
 
-
-        /** allocate buffer for LED-descriptors */
-        Led *newleds;
-        if(!(newleds = calloc(ledcount, sizeof(Led))))
+        /* views are allocated for the capacity of the LED-descriptors and
+         * will be recreated by led_chain_get_nth() */
+        if(c->leds.capacity != ocapacity)
         {
-                NFT_LOG_PERROR("calloc");
-                free(newbuf);
-                free(mapoffsets);
-                return NFT_FAILURE;
+                _arena_free(c->views);
+                c->views = NULL;
         }
 
-        /** copy old LEDs to new buffer */
-        LedCount i;
-        for(i = 0; i < MIN(ledcount, c->ledcount); i++)
+        /* mapping buffer needs at least the capacity of the LED-descriptors
+         * (tracked separately so a failed realloc can't leave it short) */
+        if(c->leds.capacity == 0)
         {
-                led_copy(&newleds[i], &c->leds[i]);
+                _arena_free(c->mapoffsets);
+                c->mapoffsets = NULL;
+                c->mapcapacity = 0;
+        }
+        else if(c->leds.capacity > c->mapcapacity)
+        {
+                int *mapoffsets;
+                if(!(mapoffsets = _arena_realloc(c->mapoffsets,
+                                                 c->leds.capacity *
+                                                 sizeof(int))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        /* shrinking never reallocates */
+                        _array_set_count(&c->leds, c->ledcount);
+                        return NFT_FAILURE;
+                }
+                c->mapoffsets = mapoffsets;
+                c->mapcapacity = c->leds.capacity;
         }
 
-        /* free resources */
-        free(c->ledbuffer);
-        free(c->leds);
-        free(c->mapoffsets);
+        /* clear mapping-offsets of new LEDs */
+        if(ledcount > c->ledcount)
+                memset(&c->mapoffsets[c->ledcount], 0,
+                       (ledcount - c->ledcount) * sizeof(int));
 
-        /* replace with resources that were just created */
+        /* reverse mapping-index might point to LEDs we don't have anymore */
+        _map_free(c);
+        c->dirty.count = 0;
+
+
+        /* new size */
         c->buffersize = nbufsize;
-        c->ledbuffer = newbuf;
-        c->leds = newleds;
         c->ledcount = ledcount;
-        c->mapoffsets = mapoffsets;
+
+        /* cached dimensions of tiles are outdated now */
+        _chain_positions_changed(c);
 
         return NFT_SUCCESS;
 }
 
 
+/**
+ * get storage of all LED descriptors of a chain
+ *
+ * @param c LedChain descriptor
+ * @result LedArray of chain
+ */
+LedArray *_chain_get_leds(LedChain * c)
+{
+        if(!c)
+                NFT_LOG_NULL(NULL);
+
+        return &c->leds;
+}
+
+
+/**
+ * notify parent tile that positions or amount of LEDs in this chain changed
+ *
+ * @param c LedChain descriptor or NULL
+ */
+void _chain_positions_changed(LedChain * c)
+{
+        if(!c || !c->parent_tile)
+                return;
+
+        _tile_invalidate(c->parent_tile);
+}
+
+
 /**
  * copy one greyscale value from one buffer to another
  */
@@ -409,7 +670,7 @@ LedChain *led_chain_new(LedCount ledcount, const char *pixelformat)
 {
         /* allocate space for descriptor */
         LedChain *c;
-        if(!(c = calloc(1, sizeof(LedChain))))
+        if(!(c = _arena_calloc(1, sizeof(LedChain))))
         {
                 NFT_LOG_PERROR("calloc");
                 return NULL;
@@ -460,17 +721,20 @@ LedChain *led_chain_new(LedCount ledcount, const char *pixelformat)
         c->buffersize = led_pixel_format_get_buffer_size(c->format, pixels);
 
         /** allocate buffer to store LED greyscale values */
-        if(!(c->ledbuffer = calloc(1, c->buffersize)))
+        if(!(c->ledbuffer = _arena_calloc(1, c->buffersize)))
                 goto _lcn_error;
+        c->buffercapacity = c->buffersize;
 
 
         /* allocate LED descriptors */
-        if(!(c->leds = calloc(ledcount, sizeof(Led))))
+        c->leds.chain = c;
+        if(!_array_set_count(&c->leds, ledcount))
                 goto _lcn_error;
 
         /* allocate space for pointer-offsets */
-        if(!(c->mapoffsets = calloc(ledcount, sizeof(int))))
+        if(!(c->mapoffsets = _arena_calloc(c->leds.capacity, sizeof(int))))
                 goto _lcn_error;
+        c->mapcapacity = c->leds.capacity;
 
         /* register to current LedConfCtxt to create an XML config of this
          * chain */
@@ -529,12 +793,8 @@ LedChain *led_chain_dup(LedChain * c)
                           led_pixel_format_to_string(c->format))))
                 return NULL;
 
-        /* copy LEDs */
-        if(!c->leds || !r->leds)
-                NFT_LOG_NULL(NULL);
-
         /* copy LED descriptors */
-        memcpy(r->leds, c->leds, r->ledcount * sizeof(Led));
+        _array_copy(&r->leds, 0, &c->leds, 0, r->ledcount);
 
         /* copy LED buffer */
         memcpy(r->ledbuffer, c->ledbuffer, r->buffersize);
@@ -765,9 +1025,9 @@ void led_chain_print(LedChain * c, NftLoglevel l)
                         {
                                 NFT_LOG(l,
                                         "Pos: %d\tX: %d\tY: %d\tComponent: %d\tGain: %hu\tGreyscale: %hhu",
-                                        i, c->leds[i].x, c->leds[i].y,
-                                        c->leds[i].component,
-                                        c->leds[i].gain,
+                                        i, c->leds.x[i], c->leds.y[i],
+                                        c->leds.component[i],
+                                        c->leds.gain[i],
                                         (unsigned char) value);
                                 break;
                         }
@@ -776,9 +1036,9 @@ void led_chain_print(LedChain * c, NftLoglevel l)
                         {
                                 NFT_LOG(l,
                                         "Pos: %d\tX: %d\tY: %d\tComponent: %d\tGain: %hu\tGreyscale: %hu",
-                                        i, c->leds[i].x, c->leds[i].y,
-                                        c->leds[i].component,
-                                        c->leds[i].gain,
+                                        i, c->leds.x[i], c->leds.y[i],
+                                        c->leds.component[i],
+                                        c->leds.gain[i],
                                         (unsigned short) value);
                                 break;
                         }
@@ -820,14 +1080,10 @@ NftResult led_chain_get_min_pos(LedChain * c, LedFrameCord * x,
 
         for(LedCount i = 0; i < c->ledcount; i++)
         {
-                LedFrameCord xL=0, yL=0;
-                if(!led_get_pos(led_chain_get_nth(c, i), &xL, &yL))
-                        return NFT_FAILURE;
-
                 if(x)
-                        *x = MIN(*x, xL);
+                        *x = MIN(*x, c->leds.x[i]);
                 if(y)
-                        *y = MIN(*y, yL);
+                        *y = MIN(*y, c->leds.y[i]);
 
         }
 
@@ -860,14 +1116,10 @@ NftResult led_chain_get_max_pos(LedChain * c, LedFrameCord * x,
 
         for(LedCount i = 0; i < c->ledcount; i++)
         {
-                LedFrameCord xL=0, yL=0;
-                if(!led_get_pos(led_chain_get_nth(c, i), &xL, &yL))
-                        return NFT_FAILURE;
-
                 if(x)
-                        *x = MAX(*x, xL);
+                        *x = MAX(*x, c->leds.x[i]);
                 if(y)
-                        *y = MAX(*y, yL);
+                        *y = MAX(*y, c->leds.y[i]);
         }
 
         return NFT_SUCCESS;
@@ -886,9 +1138,8 @@ LedFrameComponent led_chain_get_max_component(LedChain * chain)
         LedCount i;
         for(i = 0; i < chain->ledcount; i++)
         {
-                LedFrameComponent c;
-                if((c = led_get_component(led_chain_get_nth(chain, i))) > r)
-                        r = c;
+                if(chain->leds.component[i] > r)
+                        r = chain->leds.component[i];
         }
 
         return r;
@@ -907,9 +1158,8 @@ LedGain led_chain_get_max_gain(LedChain * chain)
         LedCount i;
         for(i = 0; i < chain->ledcount; i++)
         {
-                LedGain g;
-                if((g = led_get_gain(led_chain_get_nth(chain, i))) > r)
-                        r = g;
+                if(chain->leds.gain[i] > r)
+                        r = chain->leds.gain[i];
         }
 
         return r;
@@ -1009,7 +1259,24 @@ Led *led_chain_get_nth(LedChain * c, LedCount n)
                 return NULL;
         }
 
-        return &c->leds[n];
+        /* create views on first access */
+        if(!c->views)
+        {
+                if(!(c->views = _arena_calloc(c->leds.capacity, sizeof(Led))))
+                {
+                        NFT_LOG_PERROR("calloc");
+                        return NULL;
+                }
+
+                LedCount i;
+                for(i = 0; i < c->leds.capacity; i++)
+                {
+                        c->views[i].array = &c->leds;
+                        c->views[i].pos = i;
+                }
+        }
+
+        return &c->views[n];
 }
 
 
@@ -1054,16 +1321,13 @@ LedCount led_chain_stride_map(LedChain * c, LedCount stride, LedCount offset)
         LedCount i = 0;
         LedCount off = 0;
         LedCount pos = 0;
-        // Led *dst = c->leds;
-        // Led *src = tmp->leds;
         LedChain *dst = c;
         LedChain *src = tmp;
         for(i = 0; i < count; i++)
         {
                 /* copy LED */
-                Led *led = led_chain_get_nth(src, offset + pos);
-                if(!led_copy(led_chain_get_nth(dst, offset + i), led))
-                        goto _lhs_exit;
+                _array_copy(&dst->leds, offset + i,
+                            &src->leds, offset + pos, 1);
 
                 /* copy greyscale value */
                 long long int greyscale = 0;
@@ -1079,7 +1343,6 @@ LedCount led_chain_stride_map(LedChain * c, LedCount stride, LedCount offset)
                 }
         }
 
-_lhs_exit:
         /* free temporary chain */
         led_chain_destroy(tmp);
         return i;
@@ -1128,16 +1391,13 @@ LedCount led_chain_stride_unmap(LedChain * c, LedCount stride,
         LedCount i = 0;
         LedCount off = 0;
         LedCount pos = 0;
-        // Led *dst = c->leds;
-        // Led *src = tmp->leds;
         LedChain *dst = c;
         LedChain *src = tmp;
         for(i = 0; i < count; i++)
         {
                 /* copy LED */
-                Led *led = led_chain_get_nth(src, offset + i);
-                if(!led_copy(led_chain_get_nth(dst, offset + pos), led))
-                        goto _lhs_exit;
+                _array_copy(&dst->leds, offset + pos,
+                            &src->leds, offset + i, 1);
 
                 /* copy greyscale value */
                 long long int greyscale = 0;
@@ -1152,7 +1412,6 @@ LedCount led_chain_stride_unmap(LedChain * c, LedCount stride,
                 }
         }
 
-_lhs_exit:
         /* free temporary chain */
         led_chain_destroy(tmp);
         return i;
@@ -1168,99 +1427,124 @@ _lhs_exit:
  */
 NftResult led_chain_fill_from_frame(LedChain * c, LedFrame * f)
 {
-        LedFrame *srcframe = f;
-
         if(!c || !f)
                 NFT_LOG_NULL(NFT_FAILURE);
 
+        STATS_START(t);
 
-#ifdef WORDS_BIGENDIAN
-        /* convert little to big endian? */
-        if(!led_frame_get_big_endian(f))
-        {
-                led_frame_convert_endianness(f);
+        /* get dimensions of frame */
+        LedFrameCord width, height;
+        if(!led_frame_get_dim(f, &width, &height))
+                return NFT_FAILURE;
 
-                /* mark frame as converted */
-                led_frame_set_big_endian(f, true);
+        /* convert whole frame if necessary (not counted as fill) */
+        LedFrame *srcframe;
+        if(!(srcframe = _source_frame(c, f)))
+                return NFT_FAILURE;
+
+        if(srcframe != f)
+        {
+                STATS_START(tc);
+                _source_convert(c, f, 0, width * height);
+                STATS_STOP_NESTED(CHAIN_STATS(c), LED_STAGE_CONVERT, t, tc);
         }
-#else
-        /* convert big to little endian? */
-        if(led_frame_get_big_endian(f))
+
+
+        /* map frame src-buffer to chain dest-buffer */
+        char *srcbuf = led_frame_get_buffer(srcframe);
+        char *dstbuf = c->ledbuffer;
+        /* amount of bytes to add for moving from one component to the next
+         * component */
+        const size_t offset =
+                led_pixel_format_get_component_offset(c->format, 1);
+        LedCount i;
+
+        /* handle different bytes-per-component */
+        const size_t bpc =
+                led_pixel_format_get_bytes_per_pixel(c->format) /
+                led_pixel_format_get_n_components(c->format);
+
+        /* get every single LED in chain from frame-buffer and write to chain
+         * buffer */
+        for(i = 0; i < c->ledcount; i++)
         {
-                led_frame_convert_endianness(f);
+                /* copy one greyscale value */
+                _copy_greyscale_value(bpc, srcbuf + c->mapoffsets[i], dstbuf);
 
-                /* mark frame as converted */
-                led_frame_set_big_endian(f, false);
+                /* move pointer to destbuffer to next component */
+                dstbuf += offset;
         }
-#endif
 
-        /* frame format != chain format? */
-        if(!led_pixel_format_is_equal(c->format, led_frame_get_format(f)))
-        {
-                /* do we have a tmpframe already but dimensions differ? */
-                LedFrameCord width, height;
-                if(!led_frame_get_dim(f, &width, &height))
-                        return NFT_FAILURE;
+        /* all LEDs changed */
+        c->dirty.first = 0;
+        c->dirty.count = c->ledcount;
 
-                if(c->tmpframe)
-                {
-                        LedFrameCord wT, hT;
-                        if(!led_frame_get_dim(c->tmpframe, &wT, &hT))
-                                return NFT_FAILURE;
-                        if((wT != width) || (hT != height))
-                        {
-                                /* free tmpframe for we will allocate a new one
-                                 * below */
-                                led_frame_destroy(c->tmpframe);
-                                c->tmpframe = NULL;
-                        }
-                }
+        STATS_STOP(CHAIN_STATS(c), LED_STAGE_FILL, t);
 
-                /* do we need a new temporary frame? */
-                if(!c->tmpframe)
-                {
-                        /* create new temp-frame with dimensions of src-frame
-                         * and format of this chain */
-                        if(!
-                           (c->tmpframe =
-                            led_frame_new(width, height, c->format)))
-                        {
-                                return NFT_FAILURE;
-                        }
+        return NFT_SUCCESS;
+}
 
-                        /* copy endianness of our frame to tmpframe */
-                        led_frame_set_big_endian(c->tmpframe,
-                                                 led_frame_get_big_endian(f));
-                }
 
-                /* do we need a converter? */
-                LedPixelFormat *format = led_frame_get_format(f);
-                if(!c->converter ||
-                   !led_pixel_format_is_equal(c->src_format, format))
-                {
-                        /* get new converter */
-                        if(!
-                           (c->converter =
-                            led_pixel_format_get_converter(format,
-                                                           c->format)))
-                        {
-                                NFT_LOG(L_ERROR,
-                                        "Failed to create converter for color-conversion");
-                                return NFT_FAILURE;
-                        }
+/**
+ * fill LEDs under a rectangle of a frame with pixels from this frame
+ *
+ * Only the LEDs mapped to pixels inside the rectangle are gathered and
+ * marked as dirty (s. led_chain_get_dirty()). Uses the reverse mapping
+ * built by led_chain_map_from_frame() and falls back to
+ * led_chain_fill_from_frame() if there is none for a frame of this size.
+ *
+ * @param c The LED chain whose brightness values should be set
+ * @param f A frame of pixels
+ * @param x1 left edge of rectangle
+ * @param y1 top edge of rectangle
+ * @param x2 right edge of rectangle (exclusive)
+ * @param y2 bottom edge of rectangle (exclusive)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_chain_fill_from_frame_rect(LedChain * c, LedFrame * f,
+                                         LedFrameCord x1, LedFrameCord y1,
+                                         LedFrameCord x2, LedFrameCord y2)
+{
+        if(!c || !f)
+                NFT_LOG_NULL(NFT_FAILURE);
 
-                        /* save src-format */
-                        c->src_format = format;
-                }
+        /* get dimensions of frame */
+        LedFrameCord width, height;
+        if(!led_frame_get_dim(f, &width, &height))
+                return NFT_FAILURE;
+
+        /* no index for this frame? */
+        if(!c->map.rows || c->map.width != width || c->map.height != height)
+        {
+                NFT_LOG(L_DEBUG,
+                        "No mapping-index for %dx%d frame. Filling whole chain.",
+                        width, height);
+                return led_chain_fill_from_frame(c, f);
+        }
+
+        /* clip rectangle to frame */
+        x1 = MAX(x1, 0);
+        y1 = MAX(y1, 0);
+        x2 = MIN(x2, width);
+        y2 = MIN(y2, height);
+
+        if(x1 >= x2 || y1 >= y2)
+                return NFT_SUCCESS;
 
-                /* convert frame */
-                led_pixel_format_convert(c->converter,
-                                         led_frame_get_buffer(f),
-                                         led_frame_get_buffer(c->tmpframe),
-                                         width * height);
+        STATS_START(t);
 
-                /* use our tmpframe as src */
-                srcframe = c->tmpframe;
+        /* convert rows covered by rectangle if necessary (not counted as
+         * fill) */
+        LedFrame *srcframe;
+        if(!(srcframe = _source_frame(c, f)))
+                return NFT_FAILURE;
+
+        if(srcframe != f)
+        {
+                STATS_START(tc);
+                _source_convert(c, f, (size_t) y1 * width,
+                                (size_t) (y2 - y1) * width);
+                STATS_STOP_NESTED(CHAIN_STATS(c), LED_STAGE_CONVERT, t, tc);
         }
 
 
@@ -1271,32 +1555,91 @@ NftResult led_chain_fill_from_frame(LedChain * c, LedFrame * f)
          * component */
         const size_t offset =
                 led_pixel_format_get_component_offset(c->format, 1);
-        LedCount i;
 
         /* handle different bytes-per-component */
         const size_t bpc =
                 led_pixel_format_get_bytes_per_pixel(c->format) /
                 led_pixel_format_get_n_components(c->format);
 
-        /* get every single LED in chain from frame-buffer and write to chain
-         * buffer */
-        for(i = 0; i < c->ledcount; i++)
+        /* walk all rows of rectangle */
+        LedFrameCord row;
+        for(row = y1; row < y2; row++)
         {
-                /* copy one greyscale value */
-                _copy_greyscale_value(bpc, srcbuf + c->mapoffsets[i], dstbuf);
+                int first = row * width + x1;
+                int last = row * width + x2;
 
-                /* move pointer to destbuffer to next component */
-                dstbuf += offset;
+                /* find first LED of this row inside rectangle */
+                LedCount lo = c->map.rows[row];
+                LedCount hi = c->map.rows[row + 1];
+                while(lo < hi)
+                {
+                        LedCount mid = lo + (hi - lo) / 2;
+                        if(c->map.entries[mid].pixel < first)
+                                lo = mid + 1;
+                        else
+                                hi = mid;
+                }
+
+                /* gather all LEDs of this row inside rectangle */
+                for(; lo < c->map.rows[row + 1] &&
+                    c->map.entries[lo].pixel < last; lo++)
+                {
+                        LedCount i = c->map.entries[lo].led;
+
+                        /* copy one greyscale value */
+                        _copy_greyscale_value(bpc, srcbuf + c->mapoffsets[i],
+                                              dstbuf + i * offset);
+
+                        _mark_dirty(c, i);
+                }
         }
 
+        STATS_STOP(CHAIN_STATS(c), LED_STAGE_FILL, t);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get range of LEDs that changed since the last call of led_chain_clear_dirty()
+ *
+ * @param c LedChain descriptor
+ * @param offset space for position of first changed LED
+ * @param count space for amount of LEDs in range (0 if nothing changed)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_chain_get_dirty(LedChain * c, LedCount * offset,
+                              LedCount * count)
+{
+        if(!c || !offset || !count)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        *offset = c->dirty.count ? c->dirty.first : 0;
+        *count = c->dirty.count;
 
         return NFT_SUCCESS;
 }
 
 
+/**
+ * mark all LEDs of a chain as unchanged
+ *
+ * @param c LedChain descriptor
+ */
+void led_chain_clear_dirty(LedChain * c)
+{
+        if(!c)
+                NFT_LOG_NULL();
+
+        c->dirty.count = 0;
+}
+
+
 /**
  * initialize the mapping of a frame to this chain
  *
+ * Also builds the reverse index used by led_chain_fill_from_frame_rect()
+ *
  * @param c LedChain
  * @param f LedFrame
  */
@@ -1310,36 +1653,70 @@ NftResult led_chain_map_from_frame(LedChain * c, LedFrame * f)
         if(!led_frame_get_dim(f, &width, &height))
                 return NFT_FAILURE;
 
-        /* first LED in chain */
-        Led *l = c->leds;
+        /* LED properties */
+        const LedFrameCord *x = c->leds.x;
+        const LedFrameCord *y = c->leds.y;
+        const LedFrameComponent *component = c->leds.component;
+
+        /* allocate reverse mapping-index */
+        _map_free(c);
+        if(!(c->map.rows = _arena_calloc(height + 1, sizeof(LedCount))) ||
+           (c->ledcount &&
+            !(c->map.entries = _arena_calloc(c->ledcount, sizeof(MapEntry)))))
+        {
+                NFT_LOG_PERROR("calloc");
+                _map_free(c);
+                return NFT_FAILURE;
+        }
 
         /* walk all LEDs */
-        LedCount i;
+        LedCount i, mapped = 0;
         for(i = 0; i < c->ledcount; i++)
         {
-                /* validate coordinates */
-                if(l->x < 0 || l->x > width || l->y < 0 || l->y > height)
+                /* validate coordinates (LEDs outside of frame are mapped
+                 * to first pixel, so they never read beyond the buffer) */
+                if(x[i] < 0 || x[i] >= width || y[i] < 0 || y[i] >= height)
                 {
-                        NFT_LOG(L_ERROR, "Illegal coordinates (%d/%d)", l->x,
-                                l->y);
+                        NFT_LOG(L_ERROR, "Illegal coordinates (%d/%d)", x[i],
+                                y[i]);
+                        c->mapoffsets[i] = 0;
                         continue;
                 }
 
 
                 /* amount of components to seek for this pixel */
                 size_t n =
-                        (width * l->y +
-                         l->x) * led_pixel_format_get_n_components(c->format);
+                        (width * y[i] +
+                         x[i]) * led_pixel_format_get_n_components(c->format);
                 /* get offset of specific component */
                 c->mapoffsets[i] =
                         led_pixel_format_get_component_offset(c->format,
                                                               n +
-                                                              l->component);
+                                                              component[i]);
+
+                /* remember LED for reverse index */
+                c->map.entries[mapped].pixel = width * y[i] + x[i];
+                c->map.entries[mapped].led = i;
+                mapped++;
+        }
+
 
-                /* get next LED - led_chain_get_nth(i) */
-                l++;
+        /* sort LEDs by the pixel they are mapped to */
+        qsort(c->map.entries, mapped, sizeof(MapEntry), _map_compare);
+
+        /* find first entry of every row */
+        LedFrameCord row;
+        LedCount e = 0;
+        for(row = 0; row <= height; row++)
+        {
+                while(e < mapped && c->map.entries[e].pixel < row * width)
+                        e++;
+                c->map.rows[row] = e;
         }
 
+        c->map.width = width;
+        c->map.height = height;
+
         return NFT_SUCCESS;
 }
 
@@ -1377,6 +1754,9 @@ NftResult led_chain_set_greyscale(LedChain * c, LedCount pos,
         /* copy one greyscale value */
         _copy_greyscale_value(bpc, src, dst);
 
+        /* LED changed */
+        _mark_dirty(c, pos);
+
         return NFT_SUCCESS;
 }
 
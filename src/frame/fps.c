@@ -43,6 +43,15 @@
 
 /**
  * @file fps.c
+ *
+ * frame pacing
+ *
+ * Frames are scheduled on absolute deadlines of CLOCK_MONOTONIC. The next
+ * deadline is always the previous one plus one period (not "now + period"),
+ * so time spent rendering & sending doesn't accumulate as drift. If a frame
+ * is more than one period late, the schedule restarts from the current time
+ * instead of sending a burst of frames to catch up. To be more accurate than
+ * the scheduler allows, the last part of the wait can be spent busy-waiting.
  */
 
 
@@ -51,26 +60,118 @@
  * @{
  */
 
-#include <unistd.h>
-#include <sys/time.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
 #include <niftyled.h>
 
 
 
-/** space to hold the time */
-static struct timeval _last;
-/** last fps calculated */
-static int _current_fps;
+/** nanoseconds per second */
+#define NSEC_PER_SEC    1000000000LL
+
+
+
+/** frame pacing state */
+struct _LedFps
+{
+        /** length of one frame in ns */
+        long long period;
+        /** next deadline in ns */
+        long long deadline;
+        /** time of last frame in ns (0 if there was none) */
+        long long last;
+        /** average time between frames in ns */
+        long long interval;
+        /** time before deadline that's spent busy-waiting in ns */
+        long long spin;
+        /** amount of frames that missed their deadline */
+        unsigned long late;
+};
+
+
+/** instance used by the old led_fps_sample()/led_fps_delay() API */
+static LedFps _default;
+
 
 
 /******************************************************************************/
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
+/** current time of monotonic clock in ns */
+static long long _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+
+        return (long long) t.tv_sec * NSEC_PER_SEC + t.tv_nsec;
+}
+
+
+/** sleep until absolute time (ns of monotonic clock) */
+static void _sleep_until(long long t)
+{
+        struct timespec ts = {
+                .tv_sec = t / NSEC_PER_SEC,
+                .tv_nsec = t % NSEC_PER_SEC
+        };
+
+        /* restart if interrupted (deadline stays the same) */
+        while(clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) ==
+              EINTR);
+}
+
+
+/** wait until deadline, returns time we woke up */
+static long long _wait_until(LedFps * f, long long deadline)
+{
+        long long now = _now();
+
+        /* sleep (except busy-wait tail) */
+        if(deadline - f->spin > now)
+        {
+                _sleep_until(deadline - f->spin);
+                now = _now();
+        }
+
+        /* busy-wait rest */
+        while(now < deadline)
+                now = _now();
+
+        return now;
+}
+
+
+/** remember time of frame & update average interval */
+static void _measure(LedFps * f, long long now)
+{
+        if(f->last)
+        {
+                long long interval = now - f->last;
+                f->interval = f->interval ?
+                        f->interval - f->interval / 8 + interval / 8 :
+                        interval;
+        }
+
+        f->last = now;
+}
+
+
+/** set period from framerate */
+static NftResult _set_rate(LedFps * f, double fps)
+{
+        if(fps <= 0)
+        {
+                NFT_LOG(L_ERROR, "Invalid framerate: %f", fps);
+                return NFT_FAILURE;
+        }
+
+        f->period = (long long) ((double) NSEC_PER_SEC / fps);
+
+        return NFT_SUCCESS;
+}
 
-/******************************************************************************/
-/************************ "private" API FUNCTIONS *****************************/
-/******************************************************************************/
 
 
 /******************************************************************************/
@@ -78,62 +179,216 @@ static int _current_fps;
 /******************************************************************************/
 
 /**
- * sample current time
+ * create new frame pacer
+ *
+ * @param fps desired framerate (frames per second)
+ * @result newly allocated LedFps or NULL
  */
-NftResult led_fps_sample()
+LedFps *led_fps_new(double fps)
+{
+        LedFps *f;
+        if(!(f = calloc(1, sizeof(LedFps))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        if(!_set_rate(f, fps))
+        {
+                free(f);
+                return NULL;
+        }
+
+        return f;
+}
+
+
+/**
+ * free frame pacer
+ *
+ * @param f LedFps
+ */
+void led_fps_destroy(LedFps * f)
+{
+        if(!f)
+                NFT_LOG_NULL();
+
+        free(f);
+}
+
+
+/**
+ * set desired framerate (takes effect with the next deadline)
+ *
+ * @param f LedFps
+ * @param fps frames per second
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_fps_set_target(LedFps * f, double fps)
+{
+        if(!f)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        return _set_rate(f, fps);
+}
+
+
+/**
+ * get desired framerate
+ *
+ * @param f LedFps
+ * @result frames per second
+ */
+double led_fps_get_target(LedFps * f)
 {
+        if(!f)
+                NFT_LOG_NULL(0);
+
+        return (double) NSEC_PER_SEC / (double) f->period;
+}
+
 
-        if(gettimeofday(&_last, NULL) != 0)
+/**
+ * set time before every deadline that's spent busy-waiting instead of
+ * sleeping. This trades CPU time for accuracy below the resolution of the
+ * scheduler (e.g. 100000 for the last 0.1 ms).
+ *
+ * @param f LedFps
+ * @param ns nanoseconds to busy-wait (0 to always sleep)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_fps_set_spin(LedFps * f, long long ns)
+{
+        if(!f)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(ns < 0)
         {
-                NFT_LOG_PERROR("gettimeofday");
+                NFT_LOG(L_ERROR, "Invalid busy-wait time: %lld", ns);
                 return NFT_FAILURE;
         }
 
+        f->spin = ns;
+
         return NFT_SUCCESS;
 }
 
 
 /**
- * delay until next frame is due
+ * (re)start schedule. The first frame is due one period from now.
+ * led_fps_wait() does this automatically the first time it's called.
+ *
+ * @param f LedFps
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_fps_start(LedFps * f)
+{
+        if(!f)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        f->deadline = _now() + f->period;
+        f->last = 0;
+        f->interval = 0;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * wait until the next frame is due. Call this right before a frame is
+ * shown.
+ *
+ * @param f LedFps
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_fps_wait(LedFps * f)
+{
+        if(!f)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(!f->deadline)
+                led_fps_start(f);
+
+        /* arrived after deadline? (waiting would hide that) */
+        if(_now() > f->deadline)
+                f->late++;
+
+        long long now = _wait_until(f, f->deadline);
+        _measure(f, now);
+
+        /* next deadline relative to this one (no drift) */
+        f->deadline += f->period;
+
+        /* missed next deadline already? restart schedule from now */
+        if(f->deadline <= now)
+                f->deadline = now + f->period;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get framerate that has been reached
+ *
+ * @param f LedFps
+ * @result measured frames per second (averaged over the last frames)
+ */
+double led_fps_get_rate(LedFps * f)
+{
+        if(!f)
+                NFT_LOG_NULL(0);
+
+        if(!f->interval)
+                return 0;
+
+        return (double) NSEC_PER_SEC / (double) f->interval;
+}
+
+
+/**
+ * get amount of frames that missed their deadline
+ *
+ * @param f LedFps
+ * @result amount of late frames since creation
+ */
+unsigned long led_fps_get_late(LedFps * f)
+{
+        if(!f)
+                NFT_LOG_NULL(0);
+
+        return f->late;
+}
+
+
+/**
+ * sample current time
+ *
+ * @deprecated use led_fps_new() & led_fps_wait()
+ */
+NftResult led_fps_sample()
+{
+        _default.deadline = _now();
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * delay until next frame is due (one period after last led_fps_sample())
+ *
+ * @deprecated use led_fps_new() & led_fps_wait()
+ * @param fps desired framerate
  */
 NftResult led_fps_delay(int fps)
 {
-        /* get current-time */
-        struct timeval current;
-        if(gettimeofday(&current, NULL) != 0)
-        {
-                NFT_LOG_PERROR("gettimeofday");
+        if(!_set_rate(&_default, fps))
                 return NFT_FAILURE;
-        }
 
-        /* calc delay from fps */
-        long fps_sec = (1 / fps);
-        long fps_usec = (1000000 / fps);
+        if(!_default.deadline)
+                _default.deadline = _now();
 
-        /* delay if frame isn't due yet */
-        if(((_last.tv_sec + fps_sec) >= current.tv_sec) &&
-           ((_last.tv_usec + fps_usec) > current.tv_usec))
-        {
-                /* calc time to delay */
-                unsigned long _usec =
-                        (_last.tv_usec + fps_usec) - current.tv_usec;
-                unsigned long _sec =
-                        (_last.tv_sec + fps_sec) - current.tv_sec;
-                usleep(_usec + (_sec * 1000000));
-
-                /* calculate current fps */
-                _current_fps = 1000000 /
-                        ((current.tv_usec - _last.tv_usec +
-                          (current.tv_sec - _last.tv_sec) * 1000000) +
-                         (_usec + (_sec * 1000000)));
-        }
-        else
-        {
-                /* calculate current fps */
-                _current_fps =
-                        1000000 / (current.tv_usec - _last.tv_usec +
-                                   (current.tv_sec - _last.tv_sec) * 1000000);
-        }
+        _measure(&_default, _wait_until(&_default,
+                                        _default.deadline + _default.period));
 
         return NFT_SUCCESS;
 }
@@ -141,10 +396,12 @@ NftResult led_fps_delay(int fps)
 
 /**
  * return current fps
+ *
+ * @deprecated use led_fps_get_rate()
  */
 int led_fps_get()
 {
-        return _current_fps;
+        return (int) (led_fps_get_rate(&_default) + 0.5);
 }
 
 
@@ -0,0 +1,594 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file frame_queue.c
+ *
+ * queue of frames between a renderer and the hardware output
+ *
+ * The queue holds "depth" pending frames plus one frame for the producer and
+ * one for the consumer, so acquiring a frame never has to wait. Frames are
+ * only passed around by pointer, the pixel data is never copied.
+ *
+ * Every frame has a state (free -> acquired -> pending -> taken -> free).
+ * Frames that are passed back in the wrong state (e.g. submitted or
+ * released twice) are rejected, so the bookkeeping can't be corrupted by
+ * the caller.
+ */
+
+
+/**
+ * @addtogroup frame_queue
+ * @{
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <limits.h>
+#include "niftyled-frame_queue.h"
+#include "_thread.h"
+
+
+
+/** state of one frame of a queue */
+typedef enum
+{
+        /** in free stack */
+        FRAME_FREE,
+        /** handed out by led_frame_queue_acquire() */
+        FRAME_ACQUIRED,
+        /** submitted & waiting to be taken */
+        FRAME_PENDING,
+        /** handed out by led_frame_queue_take() */
+        FRAME_TAKEN,
+} FrameState;
+
+
+/** queue of frames */
+struct _LedFrameQueue
+{
+        /** which frames are dropped */
+        LedFrameQueuePolicy policy;
+        /** all frames owned by the queue */
+        LedFrame **frames;
+        /** state of every frame in "frames" */
+        FrameState *state;
+        /** amount of frames owned by the queue (depth + 2) */
+        int count;
+        /** stack of frames that are neither pending nor handed out */
+        LedFrame **free;
+        /** amount of frames in "free" */
+        int nfree;
+        /** ring of submitted frames (oldest first) */
+        LedFrame **pending;
+        /** maximum amount of pending frames */
+        int depth;
+        /** position of oldest pending frame */
+        int head;
+        /** amount of pending frames */
+        int npending;
+        /** frames submitted */
+        unsigned long long submitted;
+        /** frames taken */
+        unsigned long long presented;
+        /** frames dropped */
+        unsigned long long dropped;
+        /** protects everything above */
+        Mutex *mutex;
+        /** signalled when a frame has been submitted */
+        Cond *cond;
+};
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** get index of frame in q->frames (-1 if it doesn't belong to queue) */
+static int _index(LedFrameQueue * q, LedFrame * f)
+{
+        int i;
+        for(i = 0; i < q->count; i++)
+        {
+                if(q->frames[i] == f)
+                        return i;
+        }
+
+        return -1;
+}
+
+
+/** change state of a frame */
+static void _set_state(LedFrameQueue * q, LedFrame * f, FrameState s)
+{
+        q->state[_index(q, f)] = s;
+}
+
+
+/** put frame on free stack */
+static void _push_free(LedFrameQueue * q, LedFrame * f)
+{
+        _set_state(q, f, FRAME_FREE);
+        q->free[q->nfree++] = f;
+}
+
+
+/** remove oldest pending frame */
+static LedFrame *_pop_oldest(LedFrameQueue * q)
+{
+        LedFrame *f = q->pending[q->head];
+        q->head = (q->head + 1) % q->depth;
+        q->npending--;
+        return f;
+}
+
+
+/** drop oldest pending frame */
+static void _drop_oldest(LedFrameQueue * q)
+{
+        _push_free(q, _pop_oldest(q));
+        q->dropped++;
+}
+
+
+/**
+ * check that frame belongs to queue and is in state "s" (mutex must be
+ * locked)
+ */
+static NftResult _check_state(LedFrameQueue * q, LedFrame * f, FrameState s,
+                              const char *func)
+{
+        int i;
+        if((i = _index(q, f)) < 0)
+        {
+                NFT_LOG(L_ERROR, "%s: Frame %p doesn't belong to queue %p",
+                        func, f, q);
+                return NFT_FAILURE;
+        }
+
+        if(q->state[i] != s)
+        {
+                NFT_LOG(L_ERROR, "%s: Frame %p of queue %p is not %s",
+                        func, f, q, s == FRAME_ACQUIRED ?
+                        "acquired" : "taken");
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** wait until a frame is pending or "timeout" ns passed (< 0 = forever) */
+static void _wait(LedFrameQueue * q, long long timeout)
+{
+        /* absolute deadline (a deadline that can't be represented is
+         * forever) */
+        long long now = _thread_now();
+        if(timeout < 0 || timeout > LLONG_MAX - now)
+        {
+                while(!q->npending)
+                        _thread_cond_wait(q->cond, q->mutex);
+                return;
+        }
+
+        long long deadline = now + timeout;
+        while(!q->npending)
+        {
+                if(!_thread_cond_timedwait(q->cond, q->mutex, deadline) &&
+                   _thread_now() >= deadline)
+                        return;
+        }
+}
+
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+/**
+ * create new frame queue
+ *
+ * @param width width of frames in pixels
+ * @param height height of frames in pixels
+ * @param format pixel format of frames
+ * @param depth maximum amount of frames waiting to be taken (e.g. 1 or 2)
+ * @param policy which frames are dropped when the queue is full
+ * @result newly allocated LedFrameQueue or NULL
+ */
+LedFrameQueue *led_frame_queue_new(LedFrameCord width, LedFrameCord height,
+                                   LedPixelFormat * format, int depth,
+                                   LedFrameQueuePolicy policy)
+{
+        if(!format)
+                NFT_LOG_NULL(NULL);
+
+        if(depth < 1 || (unsigned int) policy >= LED_FRAME_QUEUE_POLICY_MAX)
+        {
+                NFT_LOG(L_ERROR, "Invalid frame queue (depth: %d policy: %d)",
+                        depth, policy);
+                return NULL;
+        }
+
+        LedFrameQueue *q;
+        if(!(q = calloc(1, sizeof(LedFrameQueue))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        q->policy = policy;
+        q->depth = depth;
+        q->count = depth + 2;
+
+        /* allocate bookkeeping */
+        if(!(q->frames = calloc(q->count, sizeof(LedFrame *))) ||
+           !(q->state = calloc(q->count, sizeof(FrameState))) ||
+           !(q->free = calloc(q->count, sizeof(LedFrame *))) ||
+           !(q->pending = calloc(depth, sizeof(LedFrame *))))
+        {
+                NFT_LOG_PERROR("calloc");
+                goto _lfqn_error;
+        }
+
+        /* allocate frames */
+        int i;
+        for(i = 0; i < q->count; i++)
+        {
+                if(!(q->frames[i] = led_frame_new(width, height, format)))
+                        goto _lfqn_error;
+
+                _push_free(q, q->frames[i]);
+        }
+
+        /* initialize locking */
+        if(!(q->mutex = _thread_mutex_new()) ||
+           !(q->cond = _thread_cond_new()))
+                goto _lfqn_error;
+
+        return q;
+
+_lfqn_error:
+        if(q->mutex)
+        {
+                /* _thread_mutex_free() expects a locked mutex */
+                _thread_mutex_lock(q->mutex);
+                _thread_mutex_free(q->mutex);
+        }
+        if(q->frames)
+        {
+                for(i = 0; i < q->count; i++)
+                {
+                        if(q->frames[i])
+                                led_frame_destroy(q->frames[i]);
+                }
+        }
+        free(q->frames);
+        free(q->state);
+        free(q->free);
+        free(q->pending);
+        free(q);
+        return NULL;
+}
+
+
+/**
+ * free queue and all its frames (also the ones currently acquired or taken)
+ *
+ * @param q LedFrameQueue
+ */
+void led_frame_queue_destroy(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL();
+
+        int i;
+        for(i = 0; i < q->count; i++)
+                led_frame_destroy(q->frames[i]);
+
+        _thread_cond_free(q->cond);
+        /* _thread_mutex_free() expects a locked mutex */
+        _thread_mutex_lock(q->mutex);
+        _thread_mutex_free(q->mutex);
+
+        free(q->frames);
+        free(q->state);
+        free(q->free);
+        free(q->pending);
+        free(q);
+}
+
+
+/**
+ * get frame to render into (never waits)
+ *
+ * @param q LedFrameQueue
+ * @result frame that must be passed to led_frame_queue_submit() or NULL
+ * if the producer already holds all frames
+ */
+LedFrame *led_frame_queue_acquire(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(NULL);
+
+        LedFrame *f = NULL;
+
+        _thread_mutex_lock(q->mutex);
+
+        if(q->nfree)
+                f = q->free[--q->nfree];
+        /* reuse oldest pending frame unless pending frames must be kept */
+        else if(q->npending && q->policy != LED_FRAME_QUEUE_DROP_NEWEST)
+        {
+                f = _pop_oldest(q);
+                q->dropped++;
+        }
+
+        if(f)
+                _set_state(q, f, FRAME_ACQUIRED);
+
+        _thread_mutex_unlock(q->mutex);
+
+        if(!f)
+                NFT_LOG(L_ERROR,
+                        "No free frame in queue. Forgot to submit a frame?");
+
+        return f;
+}
+
+
+/**
+ * queue rendered frame. If the queue is full, a frame is dropped according
+ * to the policy.
+ *
+ * @param q LedFrameQueue
+ * @param f frame from led_frame_queue_acquire()
+ * @result NFT_SUCCESS or NFT_FAILURE (e.g. if f isn't acquired)
+ */
+NftResult led_frame_queue_submit(LedFrameQueue * q, LedFrame * f)
+{
+        if(!q || !f)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        _thread_mutex_lock(q->mutex);
+
+        if(!_check_state(q, f, FRAME_ACQUIRED, __func__))
+        {
+                _thread_mutex_unlock(q->mutex);
+                return NFT_FAILURE;
+        }
+
+        q->submitted++;
+
+        /* queue full? */
+        if(q->npending == q->depth)
+        {
+                if(q->policy == LED_FRAME_QUEUE_DROP_NEWEST)
+                {
+                        _push_free(q, f);
+                        q->dropped++;
+                        _thread_mutex_unlock(q->mutex);
+                        return NFT_SUCCESS;
+                }
+
+                _drop_oldest(q);
+        }
+
+        _set_state(q, f, FRAME_PENDING);
+        q->pending[(q->head + q->npending) % q->depth] = f;
+        q->npending++;
+
+        _thread_cond_signal(q->cond);
+        _thread_mutex_unlock(q->mutex);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * take next frame that should be shown
+ *
+ * @param q LedFrameQueue
+ * @param timeout nanoseconds to wait for a frame if none is pending
+ * (0 to return immediately, < 0 to wait forever)
+ * @result frame that must be passed to led_frame_queue_release() or NULL
+ * if no frame is pending
+ */
+LedFrame *led_frame_queue_take(LedFrameQueue * q, long long timeout)
+{
+        if(!q)
+                NFT_LOG_NULL(NULL);
+
+        LedFrame *f = NULL;
+
+        _thread_mutex_lock(q->mutex);
+
+        if(!q->npending && timeout != 0)
+                _wait(q, timeout);
+
+        if(q->npending)
+        {
+                /* mailbox: skip to newest frame */
+                if(q->policy == LED_FRAME_QUEUE_MAILBOX)
+                {
+                        while(q->npending > 1)
+                                _drop_oldest(q);
+                }
+
+                f = _pop_oldest(q);
+                _set_state(q, f, FRAME_TAKEN);
+                q->presented++;
+        }
+
+        _thread_mutex_unlock(q->mutex);
+
+        return f;
+}
+
+
+/**
+ * give back frame after it has been shown
+ *
+ * @param q LedFrameQueue
+ * @param f frame from led_frame_queue_take() (NULL is ignored)
+ * @result NFT_SUCCESS or NFT_FAILURE (e.g. if f isn't taken)
+ */
+NftResult led_frame_queue_release(LedFrameQueue * q, LedFrame * f)
+{
+        if(!q)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* nothing was taken */
+        if(!f)
+                return NFT_SUCCESS;
+
+        _thread_mutex_lock(q->mutex);
+
+        NftResult r;
+        if((r = _check_state(q, f, FRAME_TAKEN, __func__)))
+                _push_free(q, f);
+
+        _thread_mutex_unlock(q->mutex);
+
+        return r;
+}
+
+
+/**
+ * get policy of queue
+ *
+ * @param q LedFrameQueue
+ * @result LedFrameQueuePolicy
+ */
+LedFrameQueuePolicy led_frame_queue_get_policy(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(LED_FRAME_QUEUE_POLICY_MAX);
+
+        return q->policy;
+}
+
+
+/**
+ * get amount of frames waiting to be taken
+ *
+ * @param q LedFrameQueue
+ * @result amount of pending frames
+ */
+int led_frame_queue_get_pending(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(0);
+
+        _thread_mutex_lock(q->mutex);
+        int n = q->npending;
+        _thread_mutex_unlock(q->mutex);
+
+        return n;
+}
+
+
+/**
+ * get amount of frames that have been submitted
+ *
+ * @param q LedFrameQueue
+ * @result amount of submitted frames (incl. dropped ones)
+ */
+unsigned long long led_frame_queue_get_submitted(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(0);
+
+        _thread_mutex_lock(q->mutex);
+        unsigned long long n = q->submitted;
+        _thread_mutex_unlock(q->mutex);
+
+        return n;
+}
+
+
+/**
+ * get amount of frames that have been taken to be shown
+ *
+ * @param q LedFrameQueue
+ * @result amount of taken frames
+ */
+unsigned long long led_frame_queue_get_presented(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(0);
+
+        _thread_mutex_lock(q->mutex);
+        unsigned long long n = q->presented;
+        _thread_mutex_unlock(q->mutex);
+
+        return n;
+}
+
+
+/**
+ * get amount of frames that have been dropped without being shown
+ *
+ * @param q LedFrameQueue
+ * @result amount of dropped frames
+ */
+unsigned long long led_frame_queue_get_dropped(LedFrameQueue * q)
+{
+        if(!q)
+                NFT_LOG_NULL(0);
+
+        _thread_mutex_lock(q->mutex);
+        unsigned long long n = q->dropped;
+        _thread_mutex_unlock(q->mutex);
+
+        return n;
+}
+
+
+/**
+ * @}
+ */
@@ -44,8 +44,13 @@
 #ifndef _LED__HARDWARE_H
 #define _LED__HARDWARE_H
 
+#include "niftyled-setup.h"
+#include "_stats.h"
+
 
 void                            hardware_set_parent_setup(LedHardware * h, LedSetup * s);
+LedSetup                       *_hardware_get_setup(LedHardware * h);
+LedStats                       *_hardware_get_stats(LedHardware * h);
 
 
 
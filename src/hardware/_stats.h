@@ -0,0 +1,122 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file _stats.h
+ * @brief per-stage timing statistics of a hardware
+ */
+
+#ifndef _LED__STATS_H
+#define _LED__STATS_H
+
+#include <time.h>
+#include "niftyled-hardware.h"
+
+
+/** timing statistics of one hardware */
+typedef struct _LedStats        LedStats;
+
+
+LedStats                       *_stats_new();
+void                            _stats_free(LedStats * s);
+void                            _stats_reset(LedStats * s);
+void                            _stats_record(LedStats * s, LedStage stage, long long ns);
+void                            _stats_frame(LedStats * s, long long now);
+void                            _stats_dropped(LedStats * s);
+void                            _stats_set_budget(LedStats * s, long long ns);
+void                            _stats_get(LedStats * s, LedStage stage, LedStageStats * r);
+unsigned long long              _stats_get_late(LedStats * s);
+unsigned long long              _stats_get_dropped(LedStats * s);
+int                             _stats_bucket(unsigned long long v);
+long long                       _stats_bucket_max(int b);
+
+
+/** current time of monotonic clock in ns */
+static inline long long _stats_now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+/*
+ * Reading the clock is the main cost of timing a stage, so a timestamp is
+ * never taken twice: STATS_STOP() leaves the stop time in "t" for whatever
+ * comes next and a nested stage shares its start & stop time with the
+ * pause & resume of the outer one.
+ */
+#if ENABLE_STATS
+/** start timing a stage (declares variable "t") */
+#define STATS_START(t) long long t = _stats_now()
+/** stop timing a stage, record time since "t" & store stop time in "t" */
+#define STATS_STOP(s, stage, t) \
+        do { \
+                long long _n = _stats_now(); \
+                if(s) \
+                        _stats_record(s, stage, _n - (t)); \
+                (t) = _n; \
+        } while(0)
+/** stop stage "n" that was started inside outer stage "t" & exclude it
+    from the time of "t" */
+#define STATS_STOP_NESTED(s, stage, t, n) \
+        do { \
+                long long _n = _stats_now(); \
+                if(s) \
+                        _stats_record(s, stage, _n - (n)); \
+                (t) += _n - (n); \
+        } while(0)
+/** record that a frame has been shown at time "t" (s. STATS_STOP()) */
+#define STATS_FRAME(s, t) do { if(s) _stats_frame(s, t); } while(0)
+/** record that a frame couldn't be sent or shown */
+#define STATS_DROPPED(s) do { if(s) _stats_dropped(s); } while(0)
+#else
+#define STATS_START(t)
+#define STATS_STOP(s, stage, t)
+#define STATS_STOP_NESTED(s, stage, t, n)
+#define STATS_FRAME(s, t)
+#define STATS_DROPPED(s)
+#endif
+
+
+#endif /* _LED__STATS_H */
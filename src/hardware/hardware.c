@@ -62,25 +62,26 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
-#include <dirent.h>
 #include <malloc.h>
 
-#if HAVE_DLFCN_H
-#include <dlfcn.h>
-#else
-#error We need dlfcn.h (-ldl) to use runtime loadable plugins
-#endif
-
 #include "niftyled-version.h"
 #include "niftyled-hardware.h"
 #include "niftyled-setup.h"
 #include "_tile.h"
 #include "_chain.h"
+#include "_setup.h"
 #include "_relation.h"
 #include "_thread.h"
+#include "_arena.h"
+#include "_plugin.h"
+#include "_wire.h"
+#include "_universe.h"
+#include "_stats.h"
 
 
 
+/** helper macro */
+#define MIN(a,b) (((a)<(b))?(a):(b))
 /** casting macro @todo add type validty check */
 #define HARDWARE(h) ((LedHardware *) h)
 /** macro to get next hardware */
@@ -100,6 +101,10 @@
 
 /** casting macro @todo add type validty check */
 #define PLUGIN_PROP(p) ((LedPluginCustomProp *) p)
+/** true if plugin provides send_iov() (older plugins don't have the field) */
+#define PLUGIN_HAS_SEND_IOV(h) (((h)->plugin->api_major > 0 || \
+                                 (h)->plugin->api_minor >= 1) ? \
+                                (h)->plugin->send_iov != NULL : false)
 /** macro to get next plugin property */
 #define PLUGIN_PROP_NEXT(p) (PLUGIN_PROP(_relation_next(RELATION(p))))
 /** macro to get previous plugin property */
@@ -113,10 +118,20 @@
 /** macro to get total amount of siblings of a plugin property */
 #define PLUGIN_PROP_COUNT(p) (_relation_sibling_count(RELATION(p))+1)
 
-/** plugin subdirectory */
-#define PLUGINDIR			PACKAGE"-plugins"
+/** default maximum of threads used by led_hardware_list_init_deferred() */
+#define LED_HARDWARE_INIT_THREADS       16
+
 
 
+/** hardware of led_hardware_list_init_deferred() grouped by plugin family */
+typedef struct
+{
+        /** hardware sorted by family */
+        LedHardware **hw;
+        /** family n is hw[start[n]] .. hw[start[n+1]-1] */
+        size_t *start;
+} InitFamilies;
+
 
 /** dynamic runtime plugin property */
 struct _LedPluginCustomProp
@@ -142,8 +157,8 @@ struct _LedHardware
         LedTile *first_tile;
         /** setup of this hardware */
         LedSetup *setup;
-        /** plugin handle as returned by dlopen() */
-        void *libhandle;
+        /** plugin library (shared by all hardware of the same family) */
+        PluginModule *module;
         /** descriptor that has been provided by plugin */
         LedHardwarePlugin *plugin;
         /** first runtime registered dynamic plugin property */
@@ -174,8 +189,37 @@ struct _LedHardware
                 /** advance this many LEDs to reach the next LED when sending */
                 LedCount stride;
         } params;
+        /** header template passed to send_iov() in front of LED data */
+        struct
+        {
+                void *data;
+                size_t size;
+        } header;
+        /** wire encoder (NULL if chain buffer is sent as it is) */
+        LedWire *wire;
+        /** DMX universes chain is split into (NULL if not split) */
+        LedUniverses *universes;
+        /** timing statistics (NULL if compiled without) */
+        LedStats *stats;
         /** mutex to lock plugin interaction */
         Mutex *mutex;
+        /** parameters of a pending led_hardware_init_deferred() (id is NULL
+            if there's none) */
+        struct
+        {
+                char *id;
+                LedCount ledcount;
+                char *pixelformat;
+                NftResult result;
+        } deferred;
+        /** cached led_hardware_list_get_ledcount() of this hardware (valid
+            if flag is set and no relation changed since it was calculated) */
+        struct
+        {
+                LedCount ledcount;
+                bool valid;
+                unsigned long generation;
+        } cache;
 };
 
 
@@ -185,130 +229,27 @@ struct _LedHardware
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
-/** extract plugin-name from filename */
-static const char *_familyname_from_filename(const char *filename)
-{
-/** file extension for shared libraries */
-#ifdef WIN32
-#define LED_HARDWARE_FILE_EXTENSION "dll"
-#else
-#define LED_HARDWARE_FILE_EXTENSION "so"
-#endif
-/** suffix one hardware plugin has to have (e.g. foobar-hardware.so) */
-#define LED_HARDWARE_FILE_SUFFIX "-hardware." LED_HARDWARE_FILE_EXTENSION
-/** maximum size of hardware-plugin filename */
-#define LED_HARDWARE_LIBNAME_MAXSIZE     1024
-
-        char *suffix;
-        if(!(suffix = strstr(filename, LED_HARDWARE_FILE_SUFFIX)))
-        {
-                /* NFT_LOG(L_WARNING, "\"%s\" has no \"%s\" suffix", filename,
-                 * LED_HARDWARE_FILE_SUFFIX); */
-                return NULL;
-        }
-        
-        /* copy filename */
-        static char name[LED_HARDWARE_LIBNAME_MAXSIZE];
-        strncpy(name, filename, suffix - filename);
-
-        /* terminate string */
-        name[suffix - filename] = '\0';
-
-        return name;
-}
-
-
-/** build full library path from prefix + filename */
-static const char *_lib_path(const char *prefix, const char *filename)
-{
-        static char path[4096];
-
-        if(prefix)
-                snprintf(path, sizeof(path), "%s/%s", prefix, filename);
-        else
-                return filename;
-
-        return path;
-}
-
-
 /** load hardware plugin */
 static LedHardware *_load_plugin(const char *name, const char *family)
 {
-
-/** maximum size of hardware-plugin filename */
-#define LED_HARDWARE_LIBNAME_MAXSIZE     1024
-/** symbol name of "hardware_descriptor" (LedHardwarePlugin) structure that a hardware-plugin has to provide */
-#define LED_HARDWARE_DESCRIPTOR  "hardware_descriptor"
-
-
-
-        /* build library-name from hardware-family */
-        char libname[LED_HARDWARE_LIBNAME_MAXSIZE];
-        if(snprintf(libname, 
-                    LED_HARDWARE_LIBNAME_MAXSIZE, 
-                    "%s/%s-hardware.so",
-                    _lib_path(LIBDIR, PLUGINDIR), family) < 0)
-        {
-                NFT_LOG_PERROR("snprintf");
-                return NULL;
-        }
-        
-        NFT_LOG(L_NOISY, "\tTrying to load \"%s\"", libname);
-    
-        void *handle;   
-        if(!(handle = dlopen(libname, RTLD_LAZY)))
-        {
-                NFT_LOG(L_ERROR, "Failed to load \"%s\"", libname);
-                return NULL;      
-        }
-    
-        /* get plugin descriptor from newly loaded library */
-        LedHardwarePlugin *plugin;
-        if(!(plugin = dlsym(handle, LED_HARDWARE_DESCRIPTOR)))
-        {
-                NFT_LOG(L_ERROR,
-                        "Plugin doesn't provide descriptor symbol: \"%s\"",
-                        LED_HARDWARE_DESCRIPTOR);
-                dlclose(handle);
+        /* get (shared) plugin library */
+        PluginModule *m;
+        if(!(m = _plugin_module_get(family)))
                 return NULL;
-        }
-
-
-        /* check plugin API major-version */
-        if(plugin->api_major != LED_HW_PLUGIN_API_MAJOR_VERSION)
-        {
-                NFT_LOG(L_ERROR,
-                        "Plugin has been compiled against major version %d of %s, we are version %d. Not loading plugin.",
-                        plugin->api_major, PACKAGE_NAME,
-                        LED_HW_PLUGIN_API_MAJOR_VERSION);
-                dlclose(handle);
-                return NULL;
-        }
-
-        /* check plugin API minor-version */
-        if(plugin->api_minor != LED_HW_PLUGIN_API_MINOR_VERSION)
-        {
-                NFT_LOG(L_WARNING,
-                        "Plugin compiled against %d of %s, we are version %d. Continue at own risk.",
-                        plugin->api_minor, PACKAGE_NAME,
-                        LED_HW_PLUGIN_API_MINOR_VERSION);
-        }
-
 
         /* prepare hardware descriptor */
         LedHardware *a;
-        if(!(a = calloc(1, sizeof(LedHardware))))
+        if(!(a = _arena_calloc(1, sizeof(LedHardware))))
         {
                 NFT_LOG_PERROR("calloc");
-                dlclose(handle);
+                _plugin_module_put(m);
                 return NULL;
         }
 
         /* save plugin descriptor in hardware descriptor */
-        a->plugin = plugin;
-        /* save libhandle */
-        a->libhandle = handle;
+        a->plugin = _plugin_module_get_descriptor(m);
+        /* save module */
+        a->module = m;
         /* copy instance-name */
         strncpy(a->params.name, name, sizeof(a->params.name));
 
@@ -320,11 +261,11 @@ static LedHardware *_load_plugin(const char *name, const char *family)
 /** unload hardware plugin */
 static void _unload_plugin(LedHardware * h)
 {
-        /* close library */
+        /* release library */
         NFT_LOG(L_DEBUG, "Unloading plugin instance \"%s\" (%s)",
                 h->params.name, h->params.id);
-        if(h->libhandle)
-                dlclose(h->libhandle);
+        if(h->module)
+                _plugin_module_put(h->module);
 }
 
 
@@ -351,6 +292,17 @@ static void _reinitialize(LedHardware * h)
 }
 
 
+/**
+ * drop cached LED count of this hardware and of all lists it is part of
+ * (every previous sibling starts a list that contains this hardware)
+ */
+static void _invalidate(LedHardware * h)
+{
+        for(; h; h = HARDWARE_PREV(h))
+                h->cache.valid = false;
+}
+
+
 /** foreach helper to register setup */
 static NftResult _register_setup(Relation * r, void *u)
 {
@@ -393,6 +345,103 @@ static NftResult _show(Relation * r, void *u)
 }
 
 
+/** pass header & "count" LEDs starting at "offset" to send_iov() of plugin */
+static NftResult _send_iov(LedHardware * h, LedCount count, LedCount offset)
+{
+        /* one LED is one component of a pixel */
+        LedPixelFormat *f = led_chain_get_format(h->chain);
+        size_t components = led_pixel_format_get_n_components(f);
+        size_t bpc = components ?
+                led_pixel_format_get_bytes_per_pixel(f) / components : 0;
+
+        /* an incomplete last pixel isn't part of the chain buffer */
+        size_t bufsize = led_chain_get_buffer_size(h->chain);
+        size_t start = MIN((size_t) offset * bpc, bufsize);
+        size_t size = MIN((size_t) count * bpc, bufsize - start);
+
+        LedIoVec iov[2];
+        int iovcnt = 0;
+        if(h->header.size)
+        {
+                iov[iovcnt].iov_base = h->header.data;
+                iov[iovcnt].iov_len = h->header.size;
+                iovcnt++;
+        }
+
+        /* send complete encoded frame? */
+        if(h->wire)
+        {
+                const void *frame;
+                if(!(frame = _wire_encode(h->wire, h->chain, h->universes,
+                                          count, offset, &size)))
+                        return NFT_FAILURE;
+                iov[iovcnt].iov_base = (void *) frame;
+        }
+        else
+                iov[iovcnt].iov_base =
+                        (char *) led_chain_get_buffer(h->chain) + start;
+        iov[iovcnt].iov_len = size;
+        iovcnt++;
+
+        return h->plugin->send_iov(h->plugin_privdata, iov, iovcnt,
+                                   count, offset);
+}
+
+
+/** send "count" LEDs starting at "offset" of hardware's chain to plugin */
+static NftResult _send_range(LedHardware * h, LedCount count, LedCount offset)
+{
+        /* don't send anything to non-initialized plugin */
+        if(!led_hardware_is_initialized(h))
+        {
+                NFT_LOG(L_ERROR,
+                        "Attempt to send to non-initialized hardware (\"%s - %s\")",
+                        h->params.name, h->params.id);
+                return NFT_FAILURE;
+        }
+
+        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, send))
+        {
+                NFT_LOG(L_WARNING,
+                        "Plugin \"%s\" doesn't provide send-function",
+                        h->params.name);
+                return NFT_SUCCESS;
+        }
+
+        NFT_LOG(L_DEBUG, "Sending %d LEDs (offset %d) to %s",
+                count, offset, h->params.name);
+
+        /* lock */
+        if(!_thread_mutex_lock(h->mutex))
+                return NFT_FAILURE;
+
+        STATS_START(t);
+
+        NftResult r;
+        if(PLUGIN_HAS_SEND_IOV(h))
+                r = _send_iov(h, count, offset);
+        else
+                r = h->plugin->send(h->plugin_privdata, h->chain,
+                                    count, offset);
+
+        STATS_STOP(h->stats, LED_STAGE_SEND, t);
+
+        /* unlock */
+        if(!_thread_mutex_unlock(h->mutex))
+                return NFT_FAILURE;
+
+        if(!r)
+        {
+                NFT_LOG(L_ERROR, "Error while sending to %s", h->params.name);
+                STATS_DROPPED(h->stats);
+
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
 /** foreach helper to send data of hardware */
 static NftResult _send(Relation * r, void *u)
 {
@@ -400,6 +449,13 @@ static NftResult _send(Relation * r, void *u)
 }
 
 
+/** foreach helper to send changed data of hardware */
+static NftResult _send_dirty(Relation * r, void *u)
+{
+        return led_hardware_send_dirty(HARDWARE(r));
+}
+
+
 /** find plugin custom property by its name */
 static LedPluginCustomProp *_prop_get_by_name(LedPluginCustomProp * p,
                                               const char *name)
@@ -417,6 +473,174 @@ static LedPluginCustomProp *_prop_get_by_name(LedPluginCustomProp * p,
 }
 
 
+/** free parameters of pending led_hardware_init_deferred() */
+static void _deferred_clear(LedHardware * h)
+{
+        free(h->deferred.id);
+        free(h->deferred.pixelformat);
+        h->deferred.id = NULL;
+        h->deferred.pixelformat = NULL;
+}
+
+
+/**
+ * first step of led_hardware_init(): create chain & save parameters
+ */
+static NftResult _init_prepare(LedHardware * h, LedCount ledcount,
+                               const char *pixelformat)
+{
+        /* if we are re-initializing, we already have a chain, otherwise we'll
+         * initialize a new one */
+        if(!h->chain)
+        {
+                /** initialize LedChain of this hardware */
+                if(!(h->chain = led_chain_new(ledcount, pixelformat)))
+                {
+                        NFT_LOG(L_ERROR,
+                                "Failed to create chain. Initialization failed");
+                        return NFT_FAILURE;
+                }
+
+                /* register hardware with chain */
+                _chain_set_parent_hardware(h->chain, h);
+        }
+
+        /* save ledcount */
+        h->params.ledcount = ledcount;
+        _invalidate(h);
+
+        /* save pixelformat */
+        strncpy(h->params.pixelformat, pixelformat,
+                sizeof(h->params.pixelformat));
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * second step of led_hardware_init(): let plugin initialize the hardware
+ *
+ * @note this only touches the plugin of this hardware, so it may run
+ * concurrently for hardware of different plugin families
+ */
+static NftResult _init_hw(LedHardware * h, const char *id)
+{
+        /* initialize hardware */
+        NFT_LOG(L_DEBUG, "Initializing \"%s\" (%s)...", h->params.name, id);
+
+        /* no init function */
+        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, hw_init))
+                return NFT_SUCCESS;
+
+        /* lock */
+        if(!_thread_mutex_lock(h->mutex))
+                return NFT_FAILURE;
+
+        /* initialize */
+        NftResult r = h->plugin->hw_init(h->plugin_privdata, id);
+
+        /* unlock */
+        if(!_thread_mutex_unlock(h->mutex))
+                return NFT_FAILURE;
+
+        return r;
+}
+
+
+/**
+ * last step of led_hardware_init(): sync model with initialized hardware
+ */
+static NftResult _init_finish(LedHardware * h, LedCount ledcount)
+{
+        /* mark hardware as "initialized" */
+        h->hw_initialized = true;
+
+        /* ID might have changed after initializing (when using a wildcard id) */
+        NFT_LOG(L_INFO, "\t\033[1mHardware ID:\033[0m \"%s\"\n",
+                led_hardware_get_id(h));
+
+        /* set id in model */
+        if(!led_hardware_set_id(h, led_hardware_get_id(h)))
+        {
+                NFT_LOG(L_ERROR, "Failed to set hardware id");
+                return NFT_FAILURE;
+        }
+
+        /* set ledcount */
+        if(!led_hardware_set_ledcount(h, ledcount))
+        {
+                NFT_LOG(L_WARNING,
+                        "Hardware \"%s\" (%s) didn't accept our ledcount (%d). Trying to adapt.",
+                        led_hardware_get_name(h), led_hardware_get_id(h),
+                        ledcount);
+
+                if(!led_chain_set_ledcount(h->chain, ledcount))
+                {
+                        NFT_LOG(L_ERROR, "Failed to change chain-length");
+                        return NFT_FAILURE;
+                }
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** _thread_pool_run() job of led_hardware_list_init_deferred() */
+static void _init_job(size_t job, void *data)
+{
+        InitFamilies *f = data;
+
+        /* hw_init() of one family runs in list order, never concurrently */
+        size_t i;
+        for(i = f->start[job]; i < f->start[job + 1]; i++)
+        {
+                LedHardware *h = f->hw[i];
+                h->deferred.result = _init_hw(h, h->deferred.id);
+        }
+}
+
+
+/**
+ * sort hardware by plugin family (keeping list order within a family)
+ *
+ * @param jobs hardware to initialize
+ * @param n amount of hardware
+ * @param f families to fill (f->hw & f->start must hold n (n+1) entries)
+ * @result amount of families
+ */
+static size_t _init_families(LedHardware ** jobs, size_t n, InitFamilies * f)
+{
+        size_t families = 0;
+        size_t sorted = 0;
+        size_t i;
+        for(i = 0; i < n; i++)
+        {
+                /* family already sorted? */
+                size_t j;
+                for(j = 0; j < i; j++)
+                {
+                        if(strcmp(jobs[j]->plugin->family,
+                                  jobs[i]->plugin->family) == 0)
+                                break;
+                }
+                if(j < i)
+                        continue;
+
+                /* append all hardware of this family */
+                f->start[families++] = sorted;
+                for(j = i; j < n; j++)
+                {
+                        if(strcmp(jobs[j]->plugin->family,
+                                  jobs[i]->plugin->family) == 0)
+                                f->hw[sorted++] = jobs[j];
+                }
+        }
+        f->start[families] = sorted;
+
+        return families;
+}
+
+
 /******************************************************************************/
 /************************ "private" API FUNCTIONS *****************************/
 /******************************************************************************/
@@ -431,6 +655,31 @@ void hardware_set_parent_setup(LedHardware * h, LedSetup * s)
 }
 
 
+/** get parent setup of this hardware */
+LedSetup *_hardware_get_setup(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(NULL);
+
+        return h->setup;
+}
+
+
+/**
+ * get timing statistics of hardware
+ *
+ * @param h LedHardware
+ * @result LedStats or NULL if compiled without statistics
+ */
+LedStats *_hardware_get_stats(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(NULL);
+
+        return h->stats;
+}
+
+
 /******************************************************************************/
 /****************************** API FUNCTIONS *********************************/
 /******************************************************************************/
@@ -476,10 +725,20 @@ LedHardware *led_hardware_new(const char *name, const char *plugin_name)
                 return NULL;
         }
         
+#if ENABLE_STATS
+        /* allocate timing statistics */
+        if(!(h->stats = _stats_new()))
+        {
+                _unload_plugin(h);
+                return NULL;
+        }
+#endif
+
         /* allocate mutex */
         if(!(h->mutex = _thread_mutex_new()))
         {
                 NFT_LOG(L_ERROR, "Failed to create mutex.");
+                _stats_free(h->stats);
                 _unload_plugin(h);
                 return NULL;
         }
@@ -581,11 +840,26 @@ void led_hardware_destroy(LedHardware * h)
         /* deallocate mutex */
         _thread_mutex_free(h->mutex);
 
+        /* forget pending initialization */
+        _deferred_clear(h);
+
+        /* free header template */
+        _arena_free(h->header.data);
+
+        /* free wire encoder */
+        _wire_free(h->wire);
+
+        /* free universe layout */
+        _universes_free(h->universes);
+
+        /* free timing statistics */
+        _stats_free(h->stats);
+
         /* unload plugin */
         _unload_plugin(h);
 
         /* free descriptor */
-        free(h);
+        _arena_free(h);
 }
 
 
@@ -638,83 +912,167 @@ NftResult led_hardware_init(LedHardware * h, const char *id,
                 return NFT_SUCCESS;
         }
 
-        /* if we are re-initializing, we already have a chain, otherwise we'll
-         * initialize a new one */
-        if(!h->chain)
+        if(!_init_prepare(h, ledcount, pixelformat))
+                return NFT_FAILURE;
+
+        if(!_init_hw(h, id))
         {
-                /** initialize LedChain of this hardware */
-                if(!(h->chain = led_chain_new(ledcount, pixelformat)))
-                {
-                        NFT_LOG(L_ERROR,
-                                "Failed to create chain. Initialization failed");
-                        return NFT_FAILURE;
-                }
+                NFT_LOG(L_ERROR, "Failed to initialize hardware");
+                return NFT_FAILURE;
+        }
 
-                /* register hardware with chain */
-                _chain_set_parent_hardware(h->chain, h);
+        return _init_finish(h, ledcount);
+}
+
+
+/**
+ * remember parameters to initialize this piece of hardware later
+ *
+ * The hardware is initialized by @ref led_hardware_list_init_deferred(),
+ * so a list of hardware can be initialized concurrently.
+ *
+ * @param h @ref LedHardware descriptor
+ * @param id Hardware ID of this plugin (e.g. /dev/ttyS0 or something)
+ * @param ledcount amount of leds currently connected to this hardware
+ * @param pixelformat printable name of the requested pixelformat
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_init_deferred(LedHardware * h, const char *id,
+                                     LedCount ledcount,
+                                     const char *pixelformat)
+{
+        if(!h || !id || !pixelformat)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        _deferred_clear(h);
+
+        if(!(h->deferred.id = strdup(id)) ||
+           !(h->deferred.pixelformat = strdup(pixelformat)))
+        {
+                NFT_LOG_PERROR("strdup");
+                _deferred_clear(h);
+                return NFT_FAILURE;
         }
 
-        /* save ledcount */
-        h->params.ledcount = ledcount;
+        h->deferred.ledcount = ledcount;
 
-        /* save pixelformat */
-        strncpy(h->params.pixelformat, pixelformat,
-                sizeof(h->params.pixelformat));
+        return NFT_SUCCESS;
+}
 
-        /* initialize hardware */
-        NFT_LOG(L_DEBUG, "Initializing \"%s\" (%s)...", h->params.name, id);
 
-        /* no init function */
-        if(LED_HARDWARE_PLUGIN_HAS_FUNC(h, hw_init))
+/**
+ * initialize all hardware of a list that has a pending
+ * @ref led_hardware_init_deferred()
+ *
+ * The (possibly blocking) hw_init() functions of different plugin families
+ * run concurrently on a pool of threads. hw_init() of hardware that belongs
+ * to the same family is called one after the other in list order, since
+ * plugins may share state between their instances. Everything else happens
+ * in the calling thread in list order, so errors are always reported in the
+ * same order.
+ *
+ * @param first first LedHardware of list
+ * @param threads maximum amount of threads to use (0 = default)
+ * @result NFT_SUCCESS if all hardware could be initialized, NFT_FAILURE
+ * otherwise
+ */
+NftResult led_hardware_list_init_deferred(LedHardware * first, int threads)
+{
+        if(!first)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* collect hardware to initialize */
+        size_t n = 0;
+        LedHardware *h;
+        for(h = first; h; h = HARDWARE_NEXT(h))
         {
-                /* lock */
-                if(!_thread_mutex_lock(h->mutex))
-                        return NFT_FAILURE;
+                if(h->deferred.id)
+                        n++;
+        }
 
-                /* initialize */
-                NftResult r = h->plugin->hw_init(h->plugin_privdata, id);
+        if(n == 0)
+                return NFT_SUCCESS;
 
-                /* unlock */
-                if(!_thread_mutex_unlock(h->mutex))
-                        return NFT_FAILURE;
+        LedHardware **jobs;
+        if(!(jobs = calloc(n, sizeof(LedHardware *))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NFT_FAILURE;
+        }
+
+        NftResult r = NFT_SUCCESS;
+        size_t i = 0;
+        for(h = first; h; h = HARDWARE_NEXT(h))
+        {
+                if(!h->deferred.id)
+                        continue;
 
-                if(!r)
+                if(h->hw_initialized)
                 {
-                        NFT_LOG(L_ERROR, "Failed to initialize hardware");
-                        return NFT_FAILURE;
+                        NFT_LOG(L_WARNING,
+                                "Attempt to initialize already initialized \"%s\" (%s)",
+                                h->params.name, h->deferred.id);
+                        _deferred_clear(h);
+                        continue;
                 }
-        }
 
-        /* mark hardware as "initialized" */
-        h->hw_initialized = true;
+                /* prepare in this thread (allocates chain from current
+                 * arena) */
+                if(!_init_prepare(h, h->deferred.ledcount,
+                                  h->deferred.pixelformat))
+                {
+                        NFT_LOG(L_ERROR,
+                                "Failed to initialize hardware \"%s\" (%s)",
+                                h->params.name, h->deferred.id);
+                        _deferred_clear(h);
+                        r = NFT_FAILURE;
+                        continue;
+                }
 
-        /* ID might have changed after initializing (when using a wildcard id) */
-        NFT_LOG(L_INFO, "\t\033[1mHardware ID:\033[0m \"%s\"\n",
-                led_hardware_get_id(h));
+                jobs[i++] = h;
+        }
+        n = i;
 
-        /* set id in model */
-        if(!led_hardware_set_id(h, led_hardware_get_id(h)))
+        /* run hw_init() of all plugins, one job per family */
+        InitFamilies f;
+        f.hw = calloc(n + 1, sizeof(LedHardware *));
+        f.start = calloc(n + 1, sizeof(size_t));
+        if(!f.hw || !f.start)
         {
-                NFT_LOG(L_ERROR, "Failed to set hardware id");
-                return NFT_FAILURE;
+                NFT_LOG_PERROR("calloc");
+                for(i = 0; i < n; i++)
+                        jobs[i]->deferred.result = NFT_FAILURE;
+        }
+        else
+        {
+                _thread_pool_run(_init_job, &f,
+                                 _init_families(jobs, n, &f),
+                                 threads > 0 ? (size_t) threads :
+                                 LED_HARDWARE_INIT_THREADS);
         }
+        free(f.start);
+        free(f.hw);
 
-        /* set ledcount */
-        if(!led_hardware_set_ledcount(h, ledcount))
+        /* finish initialization in list order */
+        for(i = 0; i < n; i++)
         {
-                NFT_LOG(L_WARNING,
-                        "Hardware \"%s\" (%s) didn't accept our ledcount (%d). Trying to adapt.",
-                        led_hardware_get_name(h), led_hardware_get_id(h),
-                        ledcount);
+                h = jobs[i];
 
-                if(!led_chain_set_ledcount(h->chain, ledcount))
+                if(!h->deferred.result ||
+                   !_init_finish(h, h->deferred.ledcount))
                 {
-                        NFT_LOG(L_ERROR, "Failed to change chain-length");
-                        return NFT_FAILURE;
+                        NFT_LOG(L_ERROR,
+                                "Failed to initialize hardware \"%s\" (%s)",
+                                h->params.name, h->deferred.id);
+                        r = NFT_FAILURE;
                 }
+
+                _deferred_clear(h);
         }
 
-        return NFT_SUCCESS;
+        free(jobs);
+
+        return r;
 }
 
 
@@ -752,6 +1110,7 @@ void led_hardware_deinit(LedHardware * h)
 
         /* mark hardware as "deinitialized" */
         h->hw_initialized = false;
+        _invalidate(h);
 }
 
 
@@ -958,6 +1317,9 @@ NftResult led_hardware_set_tile(LedHardware * h, LedTile * t)
         /* register tile with hardware */
         h->first_tile = t;
 
+        /* dimensions of setup changed */
+        _setup_invalidate(h->setup);
+
         if(t)
         {
                 /* register hardware with tile */
@@ -1061,6 +1423,11 @@ NftResult led_hardware_set_ledcount(LedHardware * h, LedCount leds)
                 if(LED_HARDWARE_PLUGIN_HAS_FUNC(h, set))
                 {
                         LedPluginParamData set_ledcount = {.ledcount = leds };
+
+                        /* lock */
+                        if(!_thread_mutex_lock(h->mutex))
+                                return NFT_FAILURE;
+
                         NftResult r = h->plugin->set(h->plugin_privdata,
                                                      LED_HW_LEDCOUNT,
                                                      &set_ledcount);
@@ -1094,6 +1461,8 @@ NftResult led_hardware_set_ledcount(LedHardware * h, LedCount leds)
                 return NFT_FAILURE;
         }
 
+        _invalidate(h);
+
         return NFT_SUCCESS;
 }
 
@@ -1179,7 +1548,9 @@ NftResult _count_leds(Relation * r, void *u)
 
 
 /**
- * count LEDs connected to hardware and it's siblings
+ * count LEDs connected to hardware and it's siblings. The result is cached
+ * until the ledcount of one of the hardwares is changed or hardwares are
+ * added/removed.
  *
  * @param h First LedHardware
  * @result sum of LEDs registered to all sibling hardware-interfaces in total or < 0 upon error
@@ -1190,145 +1561,479 @@ LedCount led_hardware_list_get_ledcount(LedHardware * h)
         if(!h)
                 NFT_LOG_NULL(-1);
 
+        /* use cached result if nothing changed */
+        unsigned long generation = _relation_generation();
+        if(h->cache.valid && h->cache.generation == generation)
+                return h->cache.ledcount;
+
+        /* count total LEDs on hardware adapters */
+        LedCount res = 0;
+        HARDWARE_FOREACH(h, _count_leds, &res);
+
+        h->cache.ledcount = res;
+        h->cache.valid = true;
+        h->cache.generation = generation;
+
+        return res;
+}
+
+
+/**
+ * set gain of a LED connected to hardware
+ *
+ * @param h @ref LedHardware descriptor
+ * @param pos position of LED in chain (if value is negative, process all LEDs in chain)
+ * @param gain gain setting (ranging from 0 for lowest gain to 2^32 for highest gain)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_set_gain(LedHardware * h, LedCount pos, LedGain gain)
+{
+        if(!h)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        NFT_LOG(L_NOISY, "Setting gain of LED %d from %s (%s) to %hu", pos,
+                h->params.name, h->params.id, gain);
+
+
+        /* set operation plugin */
+        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, set))
+        {
+                NFT_LOG(L_WARNING, "Plugin family %s has no set-handler.",
+                        h->params.name);
+                return NFT_SUCCESS;
+        }
+
+        /* lock */
+        if(!_thread_mutex_lock(h->mutex))
+                return NFT_FAILURE;
+
+        LedPluginParamData set_gain = {.gain.pos = pos,.gain.value = gain };
+        NftResult r =
+                h->plugin->set(h->plugin_privdata, LED_HW_GAIN, &set_gain);
+
+        /* unlock */
+        if(!_thread_mutex_unlock(h->mutex))
+                return NFT_FAILURE;
+
+        if(!r)
+        {
+                NFT_LOG(L_ERROR,
+                        "Plugin %s (\"%s\") failed to set gain (%hu) for LED %d",
+                        h->params.name, h->params.id, gain, pos);
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get gain of a LED connected to hardware
+ *
+ * @param h @ref LedHardware descriptor
+ * @param pos position of LED in chain (if value is negative, process all LEDs in chain)
+ * @result LedGain or 0 on failure.
+ */
+LedGain led_hardware_get_gain(LedHardware * h, LedCount pos)
+{
+        if(!h)
+                NFT_LOG_NULL(0);
+
+        NFT_LOG(L_NOISY, "Getting gain of LED %d from %s (%s)", pos,
+                h->params.name, h->params.id);
+
+
+        /* set operation plugin */
+        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, get))
+        {
+                NFT_LOG(L_WARNING, "Plugin family %s has no get-handler.",
+                        h->params.name);
+                return 0;
+        }
+
+        /* lock */
+        if(!_thread_mutex_lock(h->mutex))
+                return NFT_FAILURE;
+
+        LedPluginParamData get_gain = {.gain.pos = pos };
+        NftResult r =
+                h->plugin->get(h->plugin_privdata, LED_HW_GAIN, &get_gain);
+
+        /* unlock */
+        if(!_thread_mutex_unlock(h->mutex))
+                return NFT_FAILURE;
+
+        if(!r)
+        {
+                NFT_LOG(L_ERROR,
+                        "Plugin %s (\"%s\") failed to get gain at %d",
+                        h->params.name, h->params.id, pos);
+                return NFT_FAILURE;
+        }
+
+        return get_gain.gain.value;
+}
+
+
+/**
+ * get private userdata previously set by led_hardware_set_privdata()
+ *
+ * @param h a LedHardware
+ * @result pointer to private userdata
+ */
+void *led_hardware_get_privdata(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(NULL);
+
+        return h->privdata;
+}
+
+
+/**
+ * associate private userdata pointer with hardware
+ *
+ * @param h a LedHardware
+ * @param privdata pointer to private userdata
+ * @result NFT_SUCCESS or NFT_FAILURE upon failure
+ */
+NftResult led_hardware_set_privdata(LedHardware * h, void *privdata)
+{
+        if(!h)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        h->privdata = privdata;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * set header template that's passed to the send_iov() function of the
+ * plugin in front of the LED data. Plugins usually set this from their
+ * plugin_init() or hw_init() function to avoid building a transmit buffer
+ * for every frame.
+ *
+ * @param h a LedHardware
+ * @param header header data (will be copied) or NULL to remove header
+ * @param size size of header in bytes
+ * @result NFT_SUCCESS or NFT_FAILURE upon failure
+ */
+NftResult led_hardware_set_header(LedHardware * h, const void *header,
+                                  size_t size)
+{
+        if(!h || (!header && size))
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        void *data = NULL;
+        if(size)
+        {
+                if(!(data = _arena_malloc(size)))
+                {
+                        NFT_LOG_PERROR("malloc");
+                        return NFT_FAILURE;
+                }
+                memcpy(data, header, size);
+        }
+
+        _arena_free(h->header.data);
+        h->header.data = data;
+        h->header.size = size;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get header template previously set by led_hardware_set_header()
+ *
+ * @param h a LedHardware
+ * @param size space to store size of header in bytes (may be NULL)
+ * @result header data or NULL if hardware has no header
+ */
+const void *led_hardware_get_header(LedHardware * h, size_t * size)
+{
+        if(!h)
+                NFT_LOG_NULL(NULL);
+
+        if(size)
+                *size = h->header.size;
+
+        return h->header.data;
+}
+
+
+/**
+ * encode LED data to a wire format before it's sent. The encoded frame is
+ * passed to send_iov() of the plugin, plugins using send() can get it with
+ * led_hardware_wire_encode(). The pixelformat of the hardware must have 8 bit
+ * components in the order the protocol expects them.
+ *
+ * @param h a LedHardware
+ * @param e wire format (LED_WIRE_NONE to send chain buffer as it is)
+ * @result NFT_SUCCESS or NFT_FAILURE upon failure
+ */
+NftResult led_hardware_set_wire_encoder(LedHardware * h, LedWireEncoder e)
+{
+        if(!h)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        LedWire *w = NULL;
+        if(e != LED_WIRE_NONE && !(w = _wire_new(e)))
+                return NFT_FAILURE;
+
+        /* lock */
+        if(!_thread_mutex_lock(h->mutex))
+        {
+                _wire_free(w);
+                return NFT_FAILURE;
+        }
+
+        _wire_free(h->wire);
+        h->wire = w;
+
+        /* unlock */
+        if(!_thread_mutex_unlock(h->mutex))
+                return NFT_FAILURE;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get wire format LED data is encoded to
+ *
+ * @param h a LedHardware
+ * @result wire format
+ */
+LedWireEncoder led_hardware_get_wire_encoder(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(LED_WIRE_NONE);
+
+        return _wire_get_encoder(h->wire);
+}
+
+
+/**
+ * encode LEDs of chain to the wire format of the hardware. Only the given
+ * range is encoded, the rest of the frame is kept from previous calls.
+ * Plugins call this from their send() function.
+ *
+ * @param h a LedHardware
+ * @param count amount of LEDs to encode
+ * @param offset position of first LED to encode
+ * @param size space to store size of encoded frame in bytes
+ * @result complete encoded frame (valid until next call) or NULL if
+ * hardware has no wire encoder
+ */
+const void *led_hardware_wire_encode(LedHardware * h, LedCount count,
+                                     LedCount offset, size_t * size)
+{
+        if(!h || !size)
+                NFT_LOG_NULL(NULL);
 
-        /* count total LEDs on hardware adapters */
-        LedCount res = 0;
-        HARDWARE_FOREACH(h, _count_leds, &res);
+        if(!h->wire)
+        {
+                NFT_LOG(L_ERROR, "Hardware \"%s\" has no wire encoder",
+                        h->params.name);
+                return NULL;
+        }
 
-        return res;
+        return _wire_encode(h->wire, h->chain, h->universes, count, offset,
+                            size);
 }
 
 
 /**
- * set gain of a LED connected to hardware
+ * split chain of hardware into DMX universes. The layout is calculated when
+ * the mapping is refreshed, use led_hardware_get_universe() to get a view
+ * of every universe without copying the chain buffer.
  *
- * @param h @ref LedHardware descriptor
- * @param pos position of LED in chain (if value is negative, process all LEDs in chain)
- * @param gain gain setting (ranging from 0 for lowest gain to 2^32 for highest gain)
- * @result NFT_SUCCESS or NFT_FAILURE
+ * @param h a LedHardware
+ * @param slots maximum amount of slots (bytes) per universe (e.g. 512) or 0
+ *        to stop splitting
+ * @param packing how pixels are distributed over universes
+ * @result NFT_SUCCESS or NFT_FAILURE upon failure
  */
-NftResult led_hardware_set_gain(LedHardware * h, LedCount pos, LedGain gain)
+NftResult led_hardware_set_universes(LedHardware * h, size_t slots,
+                                     LedUniversePacking packing)
 {
         if(!h)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        NFT_LOG(L_NOISY, "Setting gain of LED %d from %s (%s) to %hu", pos,
-                h->params.name, h->params.id, gain);
-
-
-        /* set operation plugin */
-        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, set))
-        {
-                NFT_LOG(L_WARNING, "Plugin family %s has no set-handler.",
-                        h->params.name);
-                return NFT_SUCCESS;
-        }
+        LedUniverses *u = NULL;
+        if(slots && !(u = _universes_new(slots, packing)))
+                return NFT_FAILURE;
 
         /* lock */
         if(!_thread_mutex_lock(h->mutex))
+        {
+                _universes_free(u);
                 return NFT_FAILURE;
+        }
 
-        LedPluginParamData set_gain = {.gain.pos = pos,.gain.value = gain };
-        NftResult r =
-                h->plugin->set(h->plugin_privdata, LED_HW_GAIN, &set_gain);
+        _universes_free(h->universes);
+        h->universes = u;
+
+        /* DMX512 frames follow the universe layout */
+        _wire_invalidate(h->wire);
 
         /* unlock */
         if(!_thread_mutex_unlock(h->mutex))
                 return NFT_FAILURE;
 
-        if(!r)
-        {
-                NFT_LOG(L_ERROR,
-                        "Plugin %s (\"%s\") failed to set gain (%hu) for LED %d",
-                        h->params.name, h->params.id, gain, pos);
-                return NFT_FAILURE;
-        }
-
         return NFT_SUCCESS;
 }
 
 
 /**
- * get gain of a LED connected to hardware
+ * get amount of DMX universes chain of hardware is split into
  *
- * @param h @ref LedHardware descriptor
- * @param pos position of LED in chain (if value is negative, process all LEDs in chain)
- * @result LedGain or 0 on failure.
+ * @param h a LedHardware
+ * @result amount of universes (0 if hardware isn't split)
  */
-LedGain led_hardware_get_gain(LedHardware * h, LedCount pos)
+int led_hardware_get_universe_count(LedHardware * h)
 {
         if(!h)
                 NFT_LOG_NULL(0);
 
-        NFT_LOG(L_NOISY, "Getting gain of LED %d from %s (%s)", pos,
-                h->params.name, h->params.id);
+        if(!h->universes || !h->chain)
+                return 0;
 
+        return _universes_get_count(h->universes, h->chain);
+}
 
-        /* set operation plugin */
-        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, get))
+
+/**
+ * get view of one DMX universe of hardware
+ *
+ * @param h a LedHardware
+ * @param n number of universe (0 to led_hardware_get_universe_count()-1)
+ * @result view into chain buffer (valid until chain changes) or NULL
+ */
+const LedUniverse *led_hardware_get_universe(LedHardware * h, int n)
+{
+        if(!h)
+                NFT_LOG_NULL(NULL);
+
+        if(!h->universes || !h->chain)
         {
-                NFT_LOG(L_WARNING, "Plugin family %s has no get-handler.",
+                NFT_LOG(L_ERROR, "Hardware \"%s\" isn't split into universes",
                         h->params.name);
-                return 0;
+                return NULL;
         }
 
-        /* lock */
-        if(!_thread_mutex_lock(h->mutex))
-                return NFT_FAILURE;
+        return _universes_get_nth(h->universes, h->chain, n);
+}
 
-        LedPluginParamData get_gain = {.gain.pos = pos };
-        NftResult r =
-                h->plugin->get(h->plugin_privdata, LED_HW_GAIN, &get_gain);
 
-        /* unlock */
-        if(!_thread_mutex_unlock(h->mutex))
-                return NFT_FAILURE;
+/**
+ * get timing summary of one pipeline stage of hardware
+ *
+ * @note if libniftyled was configured with --disable-stats, nothing is
+ * recorded and all values are 0
+ * @param h a LedHardware
+ * @param stage the stage
+ * @param stats space where summary will be written to
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_get_stage_stats(LedHardware * h, LedStage stage,
+                                       LedStageStats * stats)
+{
+        if(!h || !stats)
+                NFT_LOG_NULL(NFT_FAILURE);
 
-        if(!r)
+        if((unsigned int) stage >= LED_STAGE_MAX)
         {
-                NFT_LOG(L_ERROR,
-                        "Plugin %s (\"%s\") failed to get gain at %d",
-                        h->params.name, h->params.id, pos);
+                NFT_LOG(L_ERROR, "Invalid stage: %d", stage);
                 return NFT_FAILURE;
         }
 
-        return get_gain.gain.value;
+        if(!h->stats)
+        {
+                memset(stats, 0, sizeof(LedStageStats));
+                return NFT_SUCCESS;
+        }
+
+        _stats_get(h->stats, stage, stats);
+
+        return NFT_SUCCESS;
 }
 
 
 /**
- * get private userdata previously set by led_hardware_set_privdata()
+ * get amount of frames shown later than the frame budget after the
+ * previous one (s. led_hardware_set_frame_budget())
  *
  * @param h a LedHardware
- * @result pointer to private userdata
+ * @result amount of late frames
  */
-void *led_hardware_get_privdata(LedHardware * h)
+unsigned long long led_hardware_get_late_frames(LedHardware * h)
 {
         if(!h)
-                NFT_LOG_NULL(NULL);
+                NFT_LOG_NULL(0);
 
-        return h->privdata;
+        return h->stats ? _stats_get_late(h->stats) : 0;
 }
 
 
 /**
- * associate private userdata pointer with hardware
+ * get amount of frames that failed to be sent or shown
  *
  * @param h a LedHardware
- * @param privdata pointer to private userdata
- * @result NFT_SUCCESS or NFT_FAILURE upon failure
+ * @result amount of dropped frames
  */
-NftResult led_hardware_set_privdata(LedHardware * h, void *privdata)
+unsigned long long led_hardware_get_dropped_frames(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(0);
+
+        return h->stats ? _stats_get_dropped(h->stats) : 0;
+}
+
+
+/**
+ * set maximum time between two led_hardware_show() before a frame counts
+ * as late (s. led_hardware_get_late_frames())
+ *
+ * @param h a LedHardware
+ * @param ns nanoseconds (e.g. 1000000000/fps) or 0 to never count late frames
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_set_frame_budget(LedHardware * h, long long ns)
 {
         if(!h)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        h->privdata = privdata;
+        if(ns < 0)
+        {
+                NFT_LOG(L_ERROR, "Invalid frame budget: %lld", ns);
+                return NFT_FAILURE;
+        }
+
+        if(h->stats)
+                _stats_set_budget(h->stats, ns);
 
         return NFT_SUCCESS;
 }
 
 
+/**
+ * forget all timing statistics & frame counters of hardware
+ *
+ * @param h a LedHardware
+ */
+void led_hardware_reset_stats(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL();
+
+        if(h->stats)
+                _stats_reset(h->stats);
+}
+
+
 /**
  * print debug-info for hardware
  *
@@ -1451,90 +2156,6 @@ void led_hardware_plugin_print(LedHardwarePlugin * p, NftLoglevel l)
 }
 
 
-/** 
- * print list of installed plugins + all information they provide 
- */
-void led_hardware_plugin_print_all()
-{
-
-        /* save current loglevel */
-        NftLoglevel ll_current = nft_log_level_get();
-
-        /* switch to "info" loglevel */
-        nft_log_level_set(L_INFO);
-
-        int i;
-        for(i = 0; i < led_hardware_plugin_total_count(); i++)
-        {
-                const char *name;
-                if(!(name = led_hardware_plugin_get_family_by_n(i)))
-                        continue;
-
-                printf("======================================\n\n");
-
-                LedHardware *h;
-                if(!(h = led_hardware_new("tmp01", name)))
-                        continue;
-
-                printf("\tID Example: %s\n",
-                       led_hardware_plugin_get_id_example(h));
-
-
-                led_hardware_destroy(h);
-        }
-
-        /* restore log-level */
-        nft_log_level_set(ll_current);
-}
-
-
-/**
- * get amount of available plugins, use this to iterate through all
- * installed plugins (e.g. led_hardware_plugin_name())
- *
- * @result amount of installed hardware plugins
- */
-int led_hardware_plugin_total_count()
-{
-        int amount = 0;
-
-
-        NFT_LOG(L_DEBUG, "Counting installed plugins...");
-    
-        /* count plugins in LIBDIR */      
-        DIR *dir;
-        if(!(dir = opendir(_lib_path(LIBDIR, PLUGINDIR))))
-        {
-                NFT_LOG(L_DEBUG, "Failed to open dir \"%s\" (%s)",
-                        _lib_path(LIBDIR, PLUGINDIR),
-                        strerror(errno));
-                return 0;
-        }
-
-        struct dirent *entry;
-        while((entry = readdir(dir)))
-        {
-                /* extract pluginname from filename */
-                const char *familyname;
-                if(!
-                   (familyname =
-                    _familyname_from_filename(entry->d_name)))
-                        continue;
-
-                NFT_LOG(L_DEBUG, "Found \"%s\" (%s)", familyname, entry->d_name);
-                amount++;
-        }
-
-        closedir(dir);
-        
-
-        /* return amount of found files */
-        NFT_LOG(L_DEBUG, "Found \"%d\" plugins", amount);
-    
-        return amount;
-}
-
-
 /**
  * get plugin descriptor of this hardware
  *
@@ -1580,57 +2201,6 @@ const char *led_hardware_plugin_get_family(LedHardware * h)
 }
 
 
-/**
- * get family-name of a certain installed plugin
- *
- * @param num the index of the plugin (0 to led_hardware_plugin_total_count()-1).
- *        A value of 0 will always bring the "dummy" hardware-plugin
- * @result string holding the name of this plugin or NULL
- */
-const char *led_hardware_plugin_get_family_by_n(unsigned int num)
-{
-        int index = num;
-
-
-        /* search all possible dirs */
-        unsigned int amount = 0;
-
-        DIR *dir;
-        if(!(dir = opendir(_lib_path(LIBDIR, PLUGINDIR))))
-        {
-                NFT_LOG(L_DEBUG, "Failed to open dir \"%s\" (%s)",
-                        _lib_path(LIBDIR, PLUGINDIR),
-                        strerror(errno));
-                return NULL;
-        }
-
-        struct dirent *entry;
-        while((entry = readdir(dir)))
-        {
-                /* extract pluginname from filename */
-                /** @todo maybe load plugin and try to get hardware_descriptor->family */
-                const char *familyname;
-                if(!
-                   (familyname =
-                    _familyname_from_filename(entry->d_name)))
-                        continue;
-
-                if(num == amount++)
-                        return familyname;
-        }
-
-        closedir(dir);
-        
-
-        NFT_LOG(L_WARNING,
-                "invalid index %d. Only %d installed hardware-plugins found.",
-                index, led_hardware_plugin_total_count());
-
-        return NULL;
-}
-
-
-
 /**
  * return license of this plugin
  *
@@ -1826,6 +2396,21 @@ NftResult led_hardware_refresh_mapping(LedHardware * h)
                 mapped += res;
         }
 
+        /* split chain into universes */
+        if(h->universes && !_universes_prepare(h->universes, h->chain))
+        {
+                NFT_LOG(L_WARNING, "Failed to split \"%s\" into universes",
+                        h->params.name);
+        }
+
+        /* prepare transmit buffer for new chain layout */
+        if(h->wire &&
+           !_wire_prepare(h->wire, h->chain, h->universes))
+        {
+                NFT_LOG(L_WARNING, "Failed to prepare wire encoder of \"%s\"",
+                        h->params.name);
+        }
+
         /* unlock */
         if(!_thread_mutex_unlock(h->mutex))
                 return NFT_FAILURE;
@@ -1943,8 +2528,12 @@ NftResult led_hardware_show(LedHardware * h)
         if(!_thread_mutex_lock(h->mutex))
                 return NFT_FAILURE;
 
+        STATS_START(t);
+
         NftResult r = h->plugin->show(h->plugin_privdata);
 
+        STATS_STOP(h->stats, LED_STAGE_SHOW, t);
+
         /* unlock */
         if(!_thread_mutex_unlock(h->mutex))
                 return NFT_FAILURE;
@@ -1952,12 +2541,15 @@ NftResult led_hardware_show(LedHardware * h)
         if(!r)
         {
                 NFT_LOG(L_ERROR, "Error while latching %s", h->params.name);
+                STATS_DROPPED(h->stats);
 
                 /* deinitialize hardware */
                 led_hardware_deinit(h);
                 return NFT_FAILURE;
         }
 
+        STATS_FRAME(h->stats, t);
+
         return NFT_SUCCESS;
 }
 
@@ -1988,43 +2580,40 @@ NftResult led_hardware_send(LedHardware * h)
         if(!h)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        /* don't send anything to non-initialized plugin */
-        if(!led_hardware_is_initialized(h))
-        {
-                NFT_LOG(L_ERROR,
-                        "Attempt to send to non-initialized hardware (\"%s - %s\")",
-                        h->params.name, h->params.id);
+        if(!_send_range(h, led_chain_get_ledcount(h->chain), 0))
                 return NFT_FAILURE;
-        }
 
-        if(!LED_HARDWARE_PLUGIN_HAS_FUNC(h, send))
-        {
-                NFT_LOG(L_WARNING,
-                        "Plugin \"%s\" doesn't provide send-function",
-                        h->params.name);
-                return NFT_SUCCESS;
-        }
+        /* everything was sent */
+        led_chain_clear_dirty(h->chain);
 
-        NFT_LOG(L_DEBUG, "Sending %d LEDs to %s",
-                led_chain_get_ledcount(h->chain), h->params.name);
+        return NFT_SUCCESS;
+}
 
-        /* lock */
-        if(!_thread_mutex_lock(h->mutex))
-                return NFT_FAILURE;
 
-        NftResult r = h->plugin->send(h->plugin_privdata, h->chain,
-                                      led_chain_get_ledcount(h->chain), 0);
+/**
+ * send only the LEDs of the current chain that changed since the last send
+ * (s. led_chain_get_dirty()) to hardware-plugin
+ *
+ * @param h LedHardwareDescriptor
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_send_dirty(LedHardware * h)
+{
+        if(!h)
+                NFT_LOG_NULL(NFT_FAILURE);
 
-        /* unlock */
-        if(!_thread_mutex_unlock(h->mutex))
+        LedCount offset, count;
+        if(!led_chain_get_dirty(h->chain, &offset, &count))
                 return NFT_FAILURE;
 
-        if(!r)
-        {
-                NFT_LOG(L_ERROR, "Error while sending to %s", h->params.name);
+        /* nothing changed? */
+        if(count == 0)
+                return NFT_SUCCESS;
 
+        if(!_send_range(h, count, offset))
                 return NFT_FAILURE;
-        }
+
+        led_chain_clear_dirty(h->chain);
 
         return NFT_SUCCESS;
 }
@@ -2044,6 +2633,20 @@ NftResult led_hardware_list_send(LedHardware * first)
 }
 
 
+/**
+ * send changed chain-values to a hardware and all siblings
+ * @param first first LedHardware
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_list_send_dirty(LedHardware * first)
+{
+        if(!first)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        return HARDWARE_FOREACH(first, _send_dirty, NULL);
+}
+
+
 
 
 
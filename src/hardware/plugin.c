@@ -0,0 +1,900 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file plugin.c
+ *
+ * registry of installed hardware-plugins
+ *
+ * The plugin directory is scanned once. Family names & paths of all plugins
+ * are cached from then on. Descriptor metadata is read the first time it's
+ * requested for a plugin. Use led_hardware_plugin_rescan() to notice plugins
+ * that were (un)installed after the first scan.
+ *
+ * Loaded plugin libraries are kept in a reference-counted module table, so
+ * all LedHardware instances of the same family share one handle &
+ * descriptor. A library is dlopen()ed (with all symbols resolved at once)
+ * and checked only when the first instance is created and dlclose()d when
+ * the last one is destroyed.
+ *
+ * Plugins can also be linked statically (e.g. for embedded builds). They
+ * register their descriptor from a constructor (s. LED_HARDWARE_PLUGIN_STATIC())
+ * and are found before the plugin directory is tried. Without dlfcn.h, only
+ * statically linked plugins are available.
+ *
+ * The registry, the module table & the statically linked plugins are
+ * protected by one mutex. Metadata returned by the registry stays valid until
+ * the next led_hardware_plugin_rescan().
+ */
+
+
+/**
+ * @addtogroup hardware
+ * @{
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+
+#if HAVE_DLFCN_H
+#include <dlfcn.h>
+#endif
+
+#include "niftyled-version.h"
+#include "niftyled-hardware.h"
+#include "_plugin.h"
+#include "_thread.h"
+
+
+
+/** plugin subdirectory */
+#define PLUGINDIR                       PACKAGE"-plugins"
+/** file extension for shared libraries */
+#ifdef WIN32
+#define LED_HARDWARE_FILE_EXTENSION     "dll"
+#else
+#define LED_HARDWARE_FILE_EXTENSION     "so"
+#endif
+/** suffix one hardware plugin has to have (e.g. foobar-hardware.so) */
+#define LED_HARDWARE_FILE_SUFFIX        "-hardware." LED_HARDWARE_FILE_EXTENSION
+
+
+
+/** maximum size of hardware-plugin filename */
+#define LED_HARDWARE_LIBNAME_MAXSIZE    1024
+/** maximum amount of statically linked plugins */
+#define LED_HARDWARE_STATIC_MAX         64
+
+
+
+/** loaded plugin library */
+struct _PluginModule
+{
+        /** next module in table */
+        PluginModule *next;
+        /** family name */
+        char *family;
+        /** handle as returned by dlopen() (NULL for static plugins) */
+        void *handle;
+        /** descriptor provided by plugin */
+        LedHardwarePlugin *plugin;
+        /** amount of LedHardware using this module */
+        unsigned int refs;
+};
+
+
+/** all currently loaded plugin libraries */
+static PluginModule *_modules;
+/** protects _modules, _static & _registry */
+static Mutex _modules_mutex = THREAD_MUTEX_INITIALIZER;
+
+
+/** statically linked plugins (filled by constructors before main()) */
+static struct
+{
+        /** descriptors */
+        LedHardwarePlugin *plugins[LED_HARDWARE_STATIC_MAX];
+        /** amount of descriptors */
+        size_t count;
+} _static;
+
+
+/** one installed plugin */
+typedef struct
+{
+        /** public metadata */
+        LedHardwarePluginInfo info;
+        /** true if we tried to read descriptor */
+        bool probed;
+        /** true if descriptor could be read */
+        bool valid;
+} PluginEntry;
+
+
+/** all installed plugins (sorted by family name) */
+static struct
+{
+        /** entries */
+        PluginEntry *entries;
+        /** amount of entries */
+        size_t count;
+        /** true if plugin directory was scanned already */
+        bool scanned;
+} _registry;
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** find statically linked plugin (_modules_mutex must be locked) */
+static LedHardwarePlugin *_static_find(const char *family)
+{
+        size_t i;
+        for(i = 0; i < _static.count; i++)
+        {
+                if(strcmp(_static.plugins[i]->family, family) == 0)
+                        return _static.plugins[i];
+        }
+
+        return NULL;
+}
+
+
+#if HAVE_DLFCN_H
+/** extract plugin-name from filename (newly allocated) */
+static char *_familyname_from_filename(const char *filename)
+{
+        size_t len = strlen(filename);
+        size_t slen = strlen(LED_HARDWARE_FILE_SUFFIX);
+
+        if(len <= slen ||
+           strcmp(filename + len - slen, LED_HARDWARE_FILE_SUFFIX) != 0)
+                return NULL;
+
+        return strndup(filename, len - slen);
+}
+#endif
+
+
+/** copy string if it's not NULL */
+static char *_strdup_null(const char *s)
+{
+        return s ? strdup(s) : NULL;
+}
+
+
+/** free all resources of one entry */
+static void _entry_free(PluginEntry * e)
+{
+        free((char *) e->info.family);
+        free((char *) e->info.path);
+        free((char *) e->info.license);
+        free((char *) e->info.author);
+        free((char *) e->info.description);
+        free((char *) e->info.url);
+        free((char *) e->info.id_example);
+}
+
+
+/** empty registry */
+static void _clear()
+{
+        size_t i;
+        for(i = 0; i < _registry.count; i++)
+                _entry_free(&_registry.entries[i]);
+
+        free(_registry.entries);
+        _registry.entries = NULL;
+        _registry.count = 0;
+        _registry.scanned = false;
+}
+
+
+/** compare two entries by family name */
+static int _compare(const void *a, const void *b)
+{
+        return strcmp(((const PluginEntry *) a)->info.family,
+                      ((const PluginEntry *) b)->info.family);
+}
+
+
+/** append empty entry to registry */
+static PluginEntry *_append(size_t * capacity)
+{
+        /* grow entries */
+        if(_registry.count >= *capacity)
+        {
+                size_t c = *capacity ? *capacity * 2 : 16;
+                PluginEntry *e;
+                if(!(e = realloc(_registry.entries, c * sizeof(PluginEntry))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NULL;
+                }
+                _registry.entries = e;
+                *capacity = c;
+        }
+
+        PluginEntry *e = &_registry.entries[_registry.count];
+        memset(e, 0, sizeof(*e));
+
+        return e;
+}
+
+
+/** add statically linked plugins to registry (_modules_mutex must be locked) */
+static NftResult _scan_static(size_t * capacity)
+{
+        NftResult r = NFT_SUCCESS;
+
+        size_t i;
+        for(i = 0; i < _static.count; i++)
+        {
+                PluginEntry *e;
+                if(!(e = _append(capacity)) ||
+                   !(e->info.family = strdup(_static.plugins[i]->family)))
+                {
+                        r = NFT_FAILURE;
+                        break;
+                }
+                _registry.count++;
+
+                NFT_LOG(L_DEBUG, "Found \"%s\" (static)", e->info.family);
+        }
+
+        return r;
+}
+
+
+/** scan plugin directory (_modules_mutex must be locked) */
+static NftResult _scan()
+{
+        _clear();
+
+        /* registry is valid (but maybe empty) from now on */
+        _registry.scanned = true;
+
+        /* statically linked plugins take precedence */
+        size_t capacity = 0;
+        NftResult r = _scan_static(&capacity);
+
+#if HAVE_DLFCN_H
+        size_t nstatic = _registry.count;
+
+        NFT_LOG(L_DEBUG, "Scanning \"%s\" for plugins...", _plugin_dir());
+
+        DIR *dir;
+        if(!(dir = opendir(_plugin_dir())))
+        {
+                NFT_LOG(L_DEBUG, "Failed to open dir \"%s\" (%s)",
+                        _plugin_dir(), strerror(errno));
+                r = NFT_FAILURE;
+                goto _s_sort;
+        }
+
+        struct dirent *entry;
+        while((entry = readdir(dir)))
+        {
+                /* extract pluginname from filename */
+                char *family;
+                if(!(family = _familyname_from_filename(entry->d_name)))
+                        continue;
+
+                /* shadowed by statically linked plugin? */
+                size_t i;
+                for(i = 0; i < nstatic; i++)
+                {
+                        if(strcmp(_registry.entries[i].info.family,
+                                  family) == 0)
+                                break;
+                }
+                if(i < nstatic)
+                {
+                        free(family);
+                        continue;
+                }
+
+                PluginEntry *e;
+                if(!(e = _append(&capacity)))
+                {
+                        free(family);
+                        r = NFT_FAILURE;
+                        break;
+                }
+
+                /* full path of plugin */
+                char path[4096];
+                snprintf(path, sizeof(path), "%s/%s", _plugin_dir(),
+                         entry->d_name);
+
+                e->info.family = family;
+                if(!(e->info.path = strdup(path)))
+                {
+                        NFT_LOG_PERROR("strdup");
+                        free(family);
+                        r = NFT_FAILURE;
+                        break;
+                }
+                _registry.count++;
+
+                NFT_LOG(L_DEBUG, "Found \"%s\" (%s)", family, entry->d_name);
+        }
+
+        closedir(dir);
+
+_s_sort:
+#endif
+        /* provide stable order */
+        qsort(_registry.entries, _registry.count, sizeof(PluginEntry),
+              _compare);
+
+        NFT_LOG(L_DEBUG, "Found \"%lu\" plugins",
+                (unsigned long) _registry.count);
+
+        return r;
+}
+
+
+/** scan plugin directory if that didn't happen, yet (_modules_mutex must be
+ * locked) */
+static void _scan_once()
+{
+        if(!_registry.scanned)
+                _scan();
+}
+
+
+/** copy metadata from descriptor to entry */
+static void _entry_fill(PluginEntry * e, const LedHardwarePlugin * p)
+{
+        e->info.api_major = p->api_major;
+        e->info.api_minor = p->api_minor;
+        e->info.api_micro = p->api_micro;
+        e->info.major_version = p->major_version;
+        e->info.minor_version = p->minor_version;
+        e->info.micro_version = p->micro_version;
+        e->info.license = _strdup_null(p->license);
+        e->info.author = _strdup_null(p->author);
+        e->info.description = _strdup_null(p->description);
+        e->info.url = _strdup_null(p->url);
+        e->info.id_example = _strdup_null(p->id_example);
+        e->valid = true;
+}
+
+
+/**
+ * read metadata from descriptor of a plugin if that didn't happen, yet
+ * (_modules_mutex must be locked)
+ */
+static void _probe(PluginEntry * e)
+{
+        if(e->probed)
+                return;
+
+        e->probed = true;
+
+        /* statically linked plugin? */
+        const LedHardwarePlugin *p;
+        if((p = _static_find(e->info.family)))
+        {
+                _entry_fill(e, p);
+                return;
+        }
+
+#if HAVE_DLFCN_H
+        void *handle;
+        if(!(handle = dlopen(e->info.path, RTLD_LAZY | RTLD_LOCAL)))
+        {
+                NFT_LOG(L_WARNING, "Failed to load \"%s\": %s",
+                        e->info.path, dlerror());
+                return;
+        }
+
+        if(!(p = dlsym(handle, LED_HARDWARE_DESCRIPTOR)))
+        {
+                NFT_LOG(L_WARNING,
+                        "\"%s\" doesn't provide descriptor symbol: \"%s\"",
+                        e->info.path, LED_HARDWARE_DESCRIPTOR);
+                dlclose(handle);
+                return;
+        }
+
+        _entry_fill(e, p);
+
+        dlclose(handle);
+#endif
+}
+
+
+/** check if we can use a plugin descriptor */
+static NftResult _check_api(const LedHardwarePlugin * plugin)
+{
+        /* check plugin API major-version */
+        if(plugin->api_major != LED_HW_PLUGIN_API_MAJOR_VERSION)
+        {
+                NFT_LOG(L_ERROR,
+                        "Plugin has been compiled against major version %d of %s, we are version %d. Not loading plugin.",
+                        plugin->api_major, PACKAGE_NAME,
+                        LED_HW_PLUGIN_API_MAJOR_VERSION);
+                return NFT_FAILURE;
+        }
+
+        /* check plugin API minor-version */
+        if(plugin->api_minor != LED_HW_PLUGIN_API_MINOR_VERSION)
+        {
+                NFT_LOG(L_WARNING,
+                        "Plugin compiled against %d of %s, we are version %d. Continue at own risk.",
+                        plugin->api_minor, PACKAGE_NAME,
+                        LED_HW_PLUGIN_API_MINOR_VERSION);
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** load plugin library of a family (NULL handle for static plugins) */
+static NftResult _module_open(const char *family, void **handle,
+                              LedHardwarePlugin ** plugin)
+{
+        *handle = NULL;
+
+        /* statically linked plugins come first */
+        if((*plugin = _static_find(family)))
+        {
+                NFT_LOG(L_NOISY, "\tUsing statically linked \"%s\"", family);
+                return NFT_SUCCESS;
+        }
+
+#if HAVE_DLFCN_H
+        /* build library-name from hardware-family */
+        char libname[LED_HARDWARE_LIBNAME_MAXSIZE];
+        if(snprintf(libname, sizeof(libname), "%s/%s" LED_HARDWARE_FILE_SUFFIX,
+                    _plugin_dir(), family) >= (int) sizeof(libname))
+        {
+                NFT_LOG(L_ERROR, "Plugin family name too long: \"%s\"",
+                        family);
+                return NFT_FAILURE;
+        }
+
+        NFT_LOG(L_NOISY, "\tTrying to load \"%s\"", libname);
+
+        /* resolve all symbols now, so a broken plugin fails here and
+         * not in the middle of sending a frame */
+        if(!(*handle = dlopen(libname, RTLD_NOW | RTLD_LOCAL)))
+        {
+                NFT_LOG(L_ERROR, "Failed to load \"%s\": %s", libname,
+                        dlerror());
+                return NFT_FAILURE;
+        }
+
+        /* get plugin descriptor from newly loaded library */
+        if(!(*plugin = dlsym(*handle, LED_HARDWARE_DESCRIPTOR)))
+        {
+                NFT_LOG(L_ERROR,
+                        "Plugin doesn't provide descriptor symbol: \"%s\"",
+                        LED_HARDWARE_DESCRIPTOR);
+                dlclose(*handle);
+                return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+#else
+        NFT_LOG(L_ERROR,
+                "No statically linked plugin \"%s\" and no support for runtime loadable plugins",
+                family);
+        return NFT_FAILURE;
+#endif
+}
+
+
+/** close plugin library */
+static void _module_close(void *handle)
+{
+#if HAVE_DLFCN_H
+        if(handle)
+                dlclose(handle);
+#endif
+}
+
+
+/** load & check plugin of a family */
+static PluginModule *_module_load(const char *family)
+{
+        void *handle;
+        LedHardwarePlugin *plugin;
+        if(!_module_open(family, &handle, &plugin))
+                return NULL;
+
+        if(!_check_api(plugin))
+        {
+                _module_close(handle);
+                return NULL;
+        }
+
+        PluginModule *m;
+        if(!(m = calloc(1, sizeof(PluginModule))) ||
+           !(m->family = strdup(family)))
+        {
+                NFT_LOG_PERROR("calloc");
+                free(m);
+                _module_close(handle);
+                return NULL;
+        }
+
+        m->handle = handle;
+        m->plugin = plugin;
+
+        return m;
+}
+
+
+
+/******************************************************************************/
+/************************ "private" API FUNCTIONS *****************************/
+/******************************************************************************/
+
+/**
+ * get directory where hardware-plugins are installed
+ */
+const char *_plugin_dir()
+{
+        return LIBDIR "/" PLUGINDIR;
+}
+
+
+
+/**
+ * get plugin library of a family (loaded on first use)
+ *
+ * @param family family name of plugin
+ * @result module (release with _plugin_module_put()) or NULL
+ */
+PluginModule *_plugin_module_get(const char *family)
+{
+        if(!family)
+                NFT_LOG_NULL(NULL);
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        /* already loaded? */
+        PluginModule *m;
+        for(m = _modules; m; m = m->next)
+        {
+                if(strcmp(m->family, family) == 0)
+                        break;
+        }
+
+        /* load library */
+        if(!m && (m = _module_load(family)))
+        {
+                m->next = _modules;
+                _modules = m;
+        }
+
+        if(m)
+                m->refs++;
+
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return m;
+}
+
+
+/**
+ * release plugin library (unloaded when it's not used anymore)
+ *
+ * @param m module as returned by _plugin_module_get()
+ */
+void _plugin_module_put(PluginModule * m)
+{
+        if(!m)
+                NFT_LOG_NULL();
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        if(--m->refs == 0)
+        {
+                /* unlink from table */
+                PluginModule **p;
+                for(p = &_modules; *p; p = &(*p)->next)
+                {
+                        if(*p == m)
+                        {
+                                *p = m->next;
+                                break;
+                        }
+                }
+
+                _module_close(m->handle);
+                free(m->family);
+                free(m);
+        }
+
+        _thread_mutex_unlock(&_modules_mutex);
+}
+
+
+/**
+ * get descriptor of a loaded plugin
+ */
+LedHardwarePlugin *_plugin_module_get_descriptor(PluginModule * m)
+{
+        if(!m)
+                NFT_LOG_NULL(NULL);
+
+        return m->plugin;
+}
+
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+
+/**
+ * register a statically linked hardware-plugin. Usually called from a
+ * constructor generated by LED_HARDWARE_PLUGIN_STATIC(). Statically linked
+ * plugins are preferred over plugins of the same family in the plugin
+ * directory.
+ *
+ * @param plugin descriptor of plugin (must stay valid while it's in use)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_plugin_register(LedHardwarePlugin * plugin)
+{
+        if(!plugin || !plugin->family)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        NftResult r = NFT_FAILURE;
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        if(_static_find(plugin->family))
+        {
+                NFT_LOG(L_ERROR,
+                        "Plugin family \"%s\" is already registered",
+                        plugin->family);
+        }
+        else if(_static.count >= LED_HARDWARE_STATIC_MAX)
+        {
+                NFT_LOG(L_ERROR,
+                        "Can't register \"%s\". Maximum of %d statically linked plugins reached.",
+                        plugin->family, LED_HARDWARE_STATIC_MAX);
+        }
+        else
+        {
+                _static.plugins[_static.count++] = plugin;
+
+                /* registry needs to notice new plugin */
+                _registry.scanned = false;
+
+                r = NFT_SUCCESS;
+        }
+
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return r;
+}
+
+
+/**
+ * forget all cached plugin information and scan plugin directory again
+ *
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_hardware_plugin_rescan()
+{
+        _thread_mutex_lock(&_modules_mutex);
+        NftResult r = _scan();
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return r;
+}
+
+
+/**
+ * get amount of available plugins, use this to iterate through all
+ * installed plugins (e.g. led_hardware_plugin_get_family_by_n())
+ *
+ * @result amount of installed hardware plugins
+ */
+int led_hardware_plugin_total_count()
+{
+        _thread_mutex_lock(&_modules_mutex);
+        _scan_once();
+        int count = (int) _registry.count;
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return count;
+}
+
+
+/**
+ * get family-name of a certain installed plugin
+ *
+ * @param num the index of the plugin (0 to led_hardware_plugin_total_count()-1).
+ *        Plugins are sorted by family name.
+ * @result string holding the name of this plugin or NULL
+ */
+const char *led_hardware_plugin_get_family_by_n(unsigned int num)
+{
+        const char *family = NULL;
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        _scan_once();
+
+        if(num >= _registry.count)
+        {
+                NFT_LOG(L_WARNING,
+                        "invalid index %u. Only %lu installed hardware-plugins found.",
+                        num, (unsigned long) _registry.count);
+        }
+        else
+        {
+                family = _registry.entries[num].info.family;
+        }
+
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return family;
+}
+
+
+/**
+ * get metadata of a certain installed plugin without creating a LedHardware
+ *
+ * @param num the index of the plugin (0 to led_hardware_plugin_total_count()-1).
+ * @result metadata (valid until next led_hardware_plugin_rescan()) or NULL
+ * if plugin doesn't exist or can't be loaded
+ */
+const LedHardwarePluginInfo *led_hardware_plugin_get_info_by_n(unsigned int
+                                                               num)
+{
+        const LedHardwarePluginInfo *info = NULL;
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        _scan_once();
+
+        if(num >= _registry.count)
+        {
+                NFT_LOG(L_WARNING,
+                        "invalid index %u. Only %lu installed hardware-plugins found.",
+                        num, (unsigned long) _registry.count);
+        }
+        else
+        {
+                PluginEntry *e = &_registry.entries[num];
+                _probe(e);
+                if(e->valid)
+                        info = &e->info;
+        }
+
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return info;
+}
+
+
+/**
+ * get metadata of an installed plugin without creating a LedHardware
+ *
+ * @param family family name of plugin
+ * @result metadata (valid until next led_hardware_plugin_rescan()) or NULL
+ * if plugin isn't installed or can't be loaded
+ */
+const LedHardwarePluginInfo *led_hardware_plugin_get_info(const char *family)
+{
+        if(!family)
+                NFT_LOG_NULL(NULL);
+
+        const LedHardwarePluginInfo *info = NULL;
+
+        _thread_mutex_lock(&_modules_mutex);
+
+        _scan_once();
+
+        PluginEntry key = {.info = {.family = family} };
+        PluginEntry *e;
+        if((e = bsearch(&key, _registry.entries, _registry.count,
+                        sizeof(PluginEntry), _compare)))
+        {
+                _probe(e);
+                if(e->valid)
+                        info = &e->info;
+        }
+
+        _thread_mutex_unlock(&_modules_mutex);
+
+        return info;
+}
+
+
+/** 
+ * print list of installed plugins + all information they provide 
+ */
+void led_hardware_plugin_print_all()
+{
+        int i;
+        for(i = 0; i < led_hardware_plugin_total_count(); i++)
+        {
+                const LedHardwarePluginInfo *p;
+                if(!(p = led_hardware_plugin_get_info_by_n(i)))
+                        continue;
+
+                printf("======================================\n\n"
+                       "\t\033[1mPlugin family:\033[0m %s\n"
+                       "\t\033[1mAPI version:\033[0m %d.%d.%d\n"
+                       "\t\033[1mPlugin version:\033[0m %d.%d.%d\n"
+                       "\t\033[1mLicense:\033[0m %s\n"
+                       "\t\033[1mAuthor:\033[0m %s\n"
+                       "\t\033[1mDescription:\033[0m %s\n"
+                       "\t\033[1mURL:\033[0m %s\n"
+                       "\tID Example: %s\n",
+                       p->family,
+                       p->api_major, p->api_minor, p->api_micro,
+                       p->major_version, p->minor_version, p->micro_version,
+                       (p->license ? p->license :
+                        "check documentation or sourcecode"),
+                       (p->author ? p->author : "-"),
+                       (p->description ? p->description : "-"),
+                       (p->url ? p->url : "-"),
+                       (p->id_example ? p->id_example : "-"));
+        }
+}
+
+
+/**
+ * @}
+ */
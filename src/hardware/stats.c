@@ -0,0 +1,402 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file stats.c
+ *
+ * per-stage timing statistics of a hardware
+ *
+ * Every stage (fill, convert, send, show) has a histogram with log-linear
+ * buckets: values below 16 ns get one bucket each, above that every power
+ * of two is split into 16 buckets. So any recorded value is off by less
+ * than 1/16 (6.25%) while one histogram covers up to ~18 minutes in a few
+ * KB. Percentiles are calculated when they're read.
+ *
+ * A stage is only recorded by one thread at a time (send & show hold the
+ * hardware mutex, a chain is never filled concurrently), so recording uses
+ * plain (relaxed atomic) loads & stores instead of locked read-modify-write
+ * instructions. Different stages may be recorded from different threads and
+ * readers never see torn values.
+ */
+
+
+/**
+ * @addtogroup hardware
+ * @{
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "niftyled-hardware.h"
+#include "_stats.h"
+
+
+
+/** bits of value used for linear sub-buckets */
+#define STATS_SUB_BITS          4
+/** linear sub-buckets per power of two */
+#define STATS_SUB               (1 << STATS_SUB_BITS)
+/** highest bit of a value that's still resolved (larger values saturate) */
+#define STATS_MAX_BIT           40
+/** amount of buckets per histogram */
+#define STATS_BUCKETS           ((STATS_MAX_BIT - STATS_SUB_BITS + 2) * STATS_SUB)
+
+/** relaxed atomic add */
+#define ATOMIC_ADD(p, v)        __atomic_fetch_add(p, v, __ATOMIC_RELAXED)
+/** relaxed atomic load */
+#define ATOMIC_LOAD(p)          __atomic_load_n(p, __ATOMIC_RELAXED)
+/** relaxed atomic store */
+#define ATOMIC_STORE(p, v)      __atomic_store_n(p, v, __ATOMIC_RELAXED)
+
+
+
+/** histogram of one stage */
+typedef struct
+{
+        /** amount of values per bucket */
+        unsigned long long buckets[STATS_BUCKETS];
+        /** sum of all values */
+        unsigned long long sum;
+        /** largest value */
+        long long max;
+} Histogram;
+
+
+/** timing statistics of one hardware */
+struct _LedStats
+{
+        /** one histogram per stage */
+        Histogram stage[LED_STAGE_MAX];
+        /** frames that were shown later than "budget" after the last one */
+        unsigned long long late;
+        /** frames that failed to be sent or shown */
+        unsigned long long dropped;
+        /** time of last shown frame (0 if there was none) */
+        long long last_frame;
+        /** maximum time between two frames (0 to never count late frames) */
+        long long budget;
+};
+
+
+/** names of stages (s. LedStage) */
+static const char *_stage_names[LED_STAGE_MAX] = {
+        "fill",
+        "convert",
+        "send",
+        "show",
+};
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** get value below which "percent" of all "count" values are */
+static long long _percentile(Histogram * h, unsigned long long count,
+                             double percent)
+{
+        /* rank of value we're looking for (1 = smallest) */
+        unsigned long long rank =
+                (unsigned long long) ((double) count * percent / 100.0 + 0.5);
+        if(rank < 1)
+                rank = 1;
+
+        unsigned long long n = 0;
+        int b;
+        for(b = 0; b < STATS_BUCKETS; b++)
+        {
+                n += ATOMIC_LOAD(&h->buckets[b]);
+                if(n >= rank)
+                        break;
+        }
+
+        /* values may have been added while we were counting */
+        if(b == STATS_BUCKETS)
+                b = STATS_BUCKETS - 1;
+
+        /* bucket boundary may be above largest value seen */
+        long long v = _stats_bucket_max(b);
+        long long max = ATOMIC_LOAD(&h->max);
+        return v < max ? v : max;
+}
+
+
+
+/******************************************************************************/
+/************************ "private" API FUNCTIONS *****************************/
+/******************************************************************************/
+
+/**
+ * get histogram bucket of a value
+ *
+ * @param v value
+ * @result index of bucket (values too large for the last bucket saturate)
+ */
+int _stats_bucket(unsigned long long v)
+{
+        if(v < STATS_SUB)
+                return (int) v;
+
+        int bit = 63 - __builtin_clzll(v);
+        if(bit > STATS_MAX_BIT)
+                return STATS_BUCKETS - 1;
+
+        return (bit - STATS_SUB_BITS + 1) * STATS_SUB +
+                (int) ((v >> (bit - STATS_SUB_BITS)) & (STATS_SUB - 1));
+}
+
+
+/**
+ * get largest value that falls into a bucket
+ *
+ * @param b index of bucket
+ * @result largest value v with _stats_bucket(v) == b
+ */
+long long _stats_bucket_max(int b)
+{
+        if(b < STATS_SUB)
+                return b;
+
+        int shift = b / STATS_SUB - 1;
+        return ((long long) (STATS_SUB + b % STATS_SUB + 1) << shift) - 1;
+}
+
+
+/**
+ * create new (empty) statistics
+ *
+ * @result newly allocated LedStats or NULL
+ */
+LedStats *_stats_new()
+{
+        LedStats *s;
+        if(!(s = calloc(1, sizeof(LedStats))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        return s;
+}
+
+
+/**
+ * free statistics
+ *
+ * @param s LedStats
+ */
+void _stats_free(LedStats * s)
+{
+        free(s);
+}
+
+
+/**
+ * forget all recorded values (budget is kept)
+ *
+ * @param s LedStats
+ */
+void _stats_reset(LedStats * s)
+{
+        int i, b;
+        for(i = 0; i < LED_STAGE_MAX; i++)
+        {
+                Histogram *h = &s->stage[i];
+                for(b = 0; b < STATS_BUCKETS; b++)
+                        ATOMIC_STORE(&h->buckets[b], 0);
+                ATOMIC_STORE(&h->sum, 0);
+                ATOMIC_STORE(&h->max, 0);
+        }
+
+        ATOMIC_STORE(&s->late, 0);
+        ATOMIC_STORE(&s->dropped, 0);
+        ATOMIC_STORE(&s->last_frame, 0);
+}
+
+
+/**
+ * record time one stage took
+ *
+ * @param s LedStats
+ * @param stage stage that has been timed
+ * @param ns duration in nanoseconds
+ */
+void _stats_record(LedStats * s, LedStage stage, long long ns)
+{
+        if(ns < 0)
+                ns = 0;
+
+        /* only one writer per stage (s. top of file) */
+        Histogram *h = &s->stage[stage];
+        unsigned long long *b = &h->buckets[_stats_bucket(ns)];
+        ATOMIC_STORE(b, ATOMIC_LOAD(b) + 1);
+        ATOMIC_STORE(&h->sum, ATOMIC_LOAD(&h->sum) + (unsigned long long) ns);
+
+        if(ns > ATOMIC_LOAD(&h->max))
+                ATOMIC_STORE(&h->max, ns);
+}
+
+
+/**
+ * record that a frame has been shown & check if it was late
+ *
+ * @param s LedStats
+ * @param now current time (s. _stats_now())
+ */
+void _stats_frame(LedStats * s, long long now)
+{
+        long long last = __atomic_exchange_n(&s->last_frame, now,
+                                             __ATOMIC_RELAXED);
+        long long budget = ATOMIC_LOAD(&s->budget);
+
+        if(last && budget && now - last > budget)
+                ATOMIC_ADD(&s->late, 1);
+}
+
+
+/**
+ * record that a frame failed to be sent or shown
+ *
+ * @param s LedStats
+ */
+void _stats_dropped(LedStats * s)
+{
+        ATOMIC_ADD(&s->dropped, 1);
+}
+
+
+/**
+ * set maximum time between two frames before a frame counts as late
+ *
+ * @param s LedStats
+ * @param ns nanoseconds (0 to never count late frames)
+ */
+void _stats_set_budget(LedStats * s, long long ns)
+{
+        ATOMIC_STORE(&s->budget, ns);
+}
+
+
+/**
+ * get summary of one stage
+ *
+ * @param s LedStats
+ * @param stage stage to summarize
+ * @param r space for result
+ */
+void _stats_get(LedStats * s, LedStage stage, LedStageStats * r)
+{
+        Histogram *h = &s->stage[stage];
+
+        memset(r, 0, sizeof(LedStageStats));
+
+        int b;
+        for(b = 0; b < STATS_BUCKETS; b++)
+                r->count += ATOMIC_LOAD(&h->buckets[b]);
+
+        if(!r->count)
+                return;
+
+        r->mean = (long long) (ATOMIC_LOAD(&h->sum) / r->count);
+        r->p50 = _percentile(h, r->count, 50);
+        r->p99 = _percentile(h, r->count, 99);
+        r->max = ATOMIC_LOAD(&h->max);
+}
+
+
+/**
+ * get amount of late frames
+ *
+ * @param s LedStats
+ * @result frames shown later than the budget after the previous one
+ */
+unsigned long long _stats_get_late(LedStats * s)
+{
+        return ATOMIC_LOAD(&s->late);
+}
+
+
+/**
+ * get amount of dropped frames
+ *
+ * @param s LedStats
+ * @result frames that failed to be sent or shown
+ */
+unsigned long long _stats_get_dropped(LedStats * s)
+{
+        return ATOMIC_LOAD(&s->dropped);
+}
+
+
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+/**
+ * get name of a pipeline stage
+ *
+ * @param stage the stage
+ * @result printable name or NULL
+ */
+const char *led_hardware_stage_to_string(LedStage stage)
+{
+        if((unsigned int) stage >= LED_STAGE_MAX)
+        {
+                NFT_LOG(L_ERROR, "Invalid stage: %d", stage);
+                return NULL;
+        }
+
+        return _stage_names[stage];
+}
+
+
+/**
+ * @}
+ */
@@ -0,0 +1,310 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file universe.c
+ *
+ * split chain buffer into DMX universes (e.g. for Art-Net or sACN nodes)
+ *
+ * The partitioning is calculated once when the mapping of the hardware is
+ * refreshed (or when the chain buffer moved). Every universe is a view into
+ * the chain buffer, so universes can be sent without copying (e.g. with
+ * sendmsg() and a protocol header in front). In pixel-aligned mode, a
+ * universe only holds complete pixels and the remaining slots stay unused
+ * (e.g. 510 of 512 slots for RGB) so no pixel is split between two nodes.
+ */
+
+
+/**
+ * @addtogroup hardware
+ * @{
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include "niftyled-hardware.h"
+#include "_universe.h"
+
+
+
+/** layout of all universes of one chain */
+struct _LedUniverses
+{
+        /** maximum amount of slots per universe */
+        size_t slots;
+        /** how pixels are distributed */
+        LedUniversePacking packing;
+        /** views (one per universe) */
+        LedUniverse *views;
+        /** amount of views */
+        int count;
+        /** allocated views */
+        int capacity;
+        /** chain buffer views were calculated for */
+        const void *buffer;
+        /** size of chain buffer views were calculated for */
+        size_t bufsize;
+        /** true if views are valid */
+        bool valid;
+};
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** recalculate views if chain buffer changed since last calculation */
+static NftResult _refresh(LedUniverses * u, LedChain * c)
+{
+        if(u->valid &&
+           u->buffer == led_chain_get_buffer(c) &&
+           u->bufsize == led_chain_get_buffer_size(c))
+                return NFT_SUCCESS;
+
+        return _universes_prepare(u, c);
+}
+
+
+
+/******************************************************************************/
+/************************ "private" API FUNCTIONS *****************************/
+/******************************************************************************/
+
+/**
+ * create new universe layout
+ *
+ * @param slots maximum amount of slots (bytes) per universe (e.g. 512)
+ * @param packing how pixels are distributed
+ * @result newly allocated LedUniverses or NULL
+ */
+LedUniverses *_universes_new(size_t slots, LedUniversePacking packing)
+{
+        if(slots == 0 || (unsigned int) packing >= LED_UNIVERSE_MAX)
+        {
+                NFT_LOG(L_ERROR, "Invalid universe layout (%lu slots, mode %d)",
+                        (unsigned long) slots, packing);
+                return NULL;
+        }
+
+        LedUniverses *u;
+        if(!(u = calloc(1, sizeof(LedUniverses))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        u->slots = slots;
+        u->packing = packing;
+
+        return u;
+}
+
+
+/**
+ * free universe layout
+ */
+void _universes_free(LedUniverses * u)
+{
+        if(!u)
+                return;
+
+        free(u->views);
+        free(u);
+}
+
+
+/**
+ * calculate views of all universes for a chain
+ *
+ * @param u LedUniverses
+ * @param c chain to split
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _universes_prepare(LedUniverses * u, LedChain * c)
+{
+        if(!u || !c)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        u->valid = false;
+        u->count = 0;
+
+        LedPixelFormat *f = led_chain_get_format(c);
+        size_t bpp = led_pixel_format_get_bytes_per_pixel(f);
+        size_t components = led_pixel_format_get_n_components(f);
+        if(bpp == 0 || components == 0)
+        {
+                NFT_LOG(L_ERROR, "Chain has invalid pixelformat");
+                return NFT_FAILURE;
+        }
+
+        /* bytes per LED (= one component) */
+        size_t bpc = bpp / components;
+
+        /* bytes per universe */
+        size_t stride = u->slots;
+        if(u->packing == LED_UNIVERSE_PIXEL_ALIGNED)
+                stride -= stride % bpp;
+        else
+                stride -= stride % bpc;
+
+        if(stride == 0)
+        {
+                NFT_LOG(L_ERROR,
+                        "%lu slots per universe can't hold one %s",
+                        (unsigned long) u->slots,
+                        u->packing == LED_UNIVERSE_PIXEL_ALIGNED ?
+                        "pixel" : "LED");
+                return NFT_FAILURE;
+        }
+
+        const unsigned char *buffer = led_chain_get_buffer(c);
+        size_t bufsize = led_chain_get_buffer_size(c);
+        int count = (int) ((bufsize + stride - 1) / stride);
+
+        /* grow views */
+        if(count > u->capacity)
+        {
+                LedUniverse *views;
+                if(!(views = realloc(u->views, count * sizeof(LedUniverse))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+                u->views = views;
+                u->capacity = count;
+        }
+
+        int i;
+        for(i = 0; i < count; i++)
+        {
+                size_t start = (size_t) i * stride;
+                size_t size = bufsize - start < stride ?
+                        bufsize - start : stride;
+
+                u->views[i].data = buffer + start;
+                u->views[i].size = size;
+                u->views[i].offset = (LedCount) (start / bpc);
+                u->views[i].count = (LedCount) (size / bpc);
+        }
+
+        u->count = count;
+        u->buffer = buffer;
+        u->bufsize = bufsize;
+        u->valid = true;
+
+        NFT_LOG(L_DEBUG, "Split %lu bytes into %d universes of %lu bytes",
+                (unsigned long) bufsize, count, (unsigned long) stride);
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get amount of universes of chain
+ */
+int _universes_get_count(LedUniverses * u, LedChain * c)
+{
+        if(!u || !c)
+                NFT_LOG_NULL(0);
+
+        if(!_refresh(u, c))
+                return 0;
+
+        return u->count;
+}
+
+
+/**
+ * get view of n-th universe of chain
+ */
+const LedUniverse *_universes_get_nth(LedUniverses * u, LedChain * c, int n)
+{
+        if(!u || !c)
+                NFT_LOG_NULL(NULL);
+
+        if(!_refresh(u, c))
+                return NULL;
+
+        if(n < 0 || n >= u->count)
+        {
+                NFT_LOG(L_ERROR, "Invalid universe %d (got %d)", n, u->count);
+                return NULL;
+        }
+
+        return &u->views[n];
+}
+
+
+/**
+ * get views of all universes of chain
+ *
+ * @param u LedUniverses
+ * @param c chain
+ * @param count space for amount of universes
+ * @result array of "count" views or NULL (count is 0 then)
+ */
+const LedUniverse *_universes_get_all(LedUniverses * u, LedChain * c,
+                                      int *count)
+{
+        if(!u || !c || !count)
+                NFT_LOG_NULL(NULL);
+
+        *count = 0;
+
+        if(!_refresh(u, c))
+                return NULL;
+
+        *count = u->count;
+
+        return u->views;
+}
+
+
+/**
+ * @}
+ */
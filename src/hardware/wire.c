@@ -0,0 +1,610 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file wire.c
+ *
+ * wire encoders (chain buffer -> protocol specific transmit buffer)
+ *
+ * The layout of the transmit buffer and all constant parts (start- & end
+ * frames, start codes, ...) are prepared when the mapping of the hardware
+ * is refreshed. Sending a frame only encodes the LEDs that are sent into the
+ * (cacheline aligned) buffer which is reused for all following frames. So
+ * a partial send still leaves a complete & valid frame in the buffer.
+ *
+ * All encoders expect one byte per LED (u8 components) in the order the
+ * protocol wants them on the wire (e.g. "BGR u8" for APA102, "GRB u8" for
+ * WS2812). DMX512 frames follow the universe layout of the hardware
+ * (s. led_hardware_set_universes()) or 512 packed slots per universe. The inner loops are plain table lookups/copies without
+ * dependencies between iterations, so the compiler can vectorize them.
+ */
+
+
+/**
+ * @addtogroup hardware
+ * @{
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include "niftyled-hardware.h"
+#include "_wire.h"
+#include "_universe.h"
+
+
+
+/** alignment of transmit buffers */
+#define WIRE_ALIGNMENT                  64
+/** APA102: components per pixel */
+#define APA102_COMPONENTS               3
+/** APA102: global brightness bits of every LED frame */
+#define APA102_BRIGHTNESS               0x1f
+/** WS281x: SPI bits per data bit */
+#define WS281X_SPI_BITS                 3
+/** WS281x: zero bytes after a frame to latch (>= 280us at 2.4 MHz SPI) */
+#define WS281X_RESET_BYTES              84
+/** DMX512: slots per universe */
+#define DMX512_SLOTS                    512
+
+
+
+/** encoder for one wire format */
+typedef struct
+{
+        /** name of format */
+        const char *name;
+        /** components per pixel the format needs (0 for any) */
+        size_t components;
+        /** size of encoded frame for "leds" LEDs of LedWire */
+        size_t (*size) (LedWire * w);
+        /** write constant parts of encoded frame */
+        void (*prepare) (LedWire * w);
+        /** encode "count" LEDs starting at "first" */
+        void (*encode) (LedWire * w, const unsigned char *src,
+                        LedCount first, LedCount count);
+} WireEncoder;
+
+
+/** transmit buffer & layout of one wire encoder */
+struct _LedWire
+{
+        /** encoder in use */
+        const WireEncoder *encoder;
+        /** type of encoder */
+        LedWireEncoder type;
+        /** transmit buffer */
+        unsigned char *buffer;
+        /** size of encoded frame */
+        size_t size;
+        /** allocated size of buffer */
+        size_t capacity;
+        /** amount of LEDs buffer has been prepared for */
+        LedCount leds;
+        /** universes of chain if encoder splits chain (DMX512) */
+        const LedUniverse *universes;
+        /** amount of universes */
+        int nuniverses;
+        /** default layout if hardware isn't split into universes */
+        LedUniverses *own;
+        /** true if buffer has been prepared */
+        bool valid;
+};
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** APA102: size of end frame (one clock edge per LED to push data through) */
+static size_t _apa102_end(LedCount leds)
+{
+        size_t pixels = (size_t) leds / APA102_COMPONENTS;
+        size_t end = (pixels + 15) / 16;
+
+        return end < 4 ? 4 : end;
+}
+
+
+/** APA102: start frame, one 4-byte frame per pixel, end frame */
+static size_t _apa102_size(LedWire * w)
+{
+        return 4 + ((size_t) w->leds / APA102_COMPONENTS) * 4 +
+                _apa102_end(w->leds);
+}
+
+
+/** APA102: start frame, brightness bits & end frame */
+static void _apa102_prepare(LedWire * w)
+{
+        unsigned char *dst = w->buffer;
+        size_t pixels = (size_t) w->leds / APA102_COMPONENTS;
+
+        memset(dst, 0x00, 4);
+
+        size_t p;
+        for(p = 0; p < pixels; p++)
+        {
+                dst[4 + p * 4] = 0xe0 | APA102_BRIGHTNESS;
+                dst[5 + p * 4] = 0;
+                dst[6 + p * 4] = 0;
+                dst[7 + p * 4] = 0;
+        }
+
+        memset(dst + 4 + pixels * 4, 0xff, _apa102_end(w->leds));
+}
+
+
+/** APA102: copy pixels touched by range into their LED frames */
+static void _apa102_encode(LedWire * w, const unsigned char *src,
+                           LedCount first, LedCount count)
+{
+        unsigned char *dst = w->buffer;
+        size_t p = (size_t) first / APA102_COMPONENTS;
+        size_t end = ((size_t) first + (size_t) count +
+                      APA102_COMPONENTS - 1) / APA102_COMPONENTS;
+
+        for(; p < end; p++)
+        {
+                dst[5 + p * 4] = src[p * APA102_COMPONENTS];
+                dst[6 + p * 4] = src[p * APA102_COMPONENTS + 1];
+                dst[7 + p * 4] = src[p * APA102_COMPONENTS + 2];
+        }
+}
+
+
+/** WS281x: SPI pattern for every byte value (1 -> 110, 0 -> 100) */
+static unsigned char _ws281x_table[256][WS281X_SPI_BITS];
+/** WS281x: _ws281x_table is filled once */
+static pthread_once_t _ws281x_once = PTHREAD_ONCE_INIT;
+
+
+/** WS281x: fill SPI pattern table */
+static void _ws281x_table_fill()
+{
+        unsigned int v;
+        for(v = 0; v < 256; v++)
+        {
+                unsigned long bits = 0;
+                int b;
+                for(b = 7; b >= 0; b--)
+                        bits = (bits << 3) | ((v >> b) & 1 ? 0x6 : 0x4);
+
+                _ws281x_table[v][0] = (bits >> 16) & 0xff;
+                _ws281x_table[v][1] = (bits >> 8) & 0xff;
+                _ws281x_table[v][2] = bits & 0xff;
+        }
+}
+
+
+/** WS281x: 3 SPI bytes per LED, followed by reset */
+static size_t _ws281x_size(LedWire * w)
+{
+        return (size_t) w->leds * WS281X_SPI_BITS + WS281X_RESET_BYTES;
+}
+
+
+/** WS281x: all LEDs off & reset */
+static void _ws281x_prepare(LedWire * w)
+{
+        pthread_once(&_ws281x_once, _ws281x_table_fill);
+
+        LedCount i;
+        for(i = 0; i < w->leds; i++)
+                memcpy(w->buffer + (size_t) i * WS281X_SPI_BITS,
+                       _ws281x_table[0], WS281X_SPI_BITS);
+
+        memset(w->buffer + (size_t) w->leds * WS281X_SPI_BITS, 0,
+               WS281X_RESET_BYTES);
+}
+
+
+/** WS281x: expand every bit of range to SPI pattern */
+static void _ws281x_encode(LedWire * w, const unsigned char *src,
+                           LedCount first, LedCount count)
+{
+        unsigned char *dst = w->buffer + (size_t) first * WS281X_SPI_BITS;
+        src += first;
+
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                const unsigned char *bits = _ws281x_table[src[i]];
+                dst[i * WS281X_SPI_BITS] = bits[0];
+                dst[i * WS281X_SPI_BITS + 1] = bits[1];
+                dst[i * WS281X_SPI_BITS + 2] = bits[2];
+        }
+}
+
+
+/** DMX512: one start code + 512 slots per universe */
+static size_t _dmx512_size(LedWire * w)
+{
+        return (size_t) w->nuniverses * (DMX512_SLOTS + 1);
+}
+
+
+/** DMX512: null start codes & unused slots */
+static void _dmx512_prepare(LedWire * w)
+{
+        memset(w->buffer, 0, _dmx512_size(w));
+}
+
+
+/** DMX512: copy range into slots of universes (s. _universes_prepare()) */
+static void _dmx512_encode(LedWire * w, const unsigned char *src,
+                           LedCount first, LedCount count)
+{
+        size_t end = (size_t) first + (size_t) count;
+
+        int i;
+        for(i = 0; i < w->nuniverses; i++)
+        {
+                const LedUniverse *u = &w->universes[i];
+
+                /* part of range inside this universe (1 byte per LED) */
+                size_t lo = (size_t) u->offset;
+                size_t hi = lo + u->size;
+                if(lo >= end)
+                        break;
+                if(lo < (size_t) first)
+                        lo = first;
+                if(hi > end)
+                        hi = end;
+                if(lo >= hi)
+                        continue;
+
+                memcpy(w->buffer + (size_t) i * (DMX512_SLOTS + 1) + 1 +
+                       (lo - u->offset), src + lo, hi - lo);
+        }
+}
+
+
+/** all encoders (indexed by LedWireEncoder) */
+static const WireEncoder _encoders[LED_WIRE_MAX] = {
+        [LED_WIRE_APA102] = {
+                             .name = "apa102",
+                             .components = APA102_COMPONENTS,
+                             .size = _apa102_size,
+                             .prepare = _apa102_prepare,
+                             .encode = _apa102_encode,
+                             },
+        [LED_WIRE_WS281X_SPI] = {
+                                 .name = "ws281x-spi",
+                                 .size = _ws281x_size,
+                                 .prepare = _ws281x_prepare,
+                                 .encode = _ws281x_encode,
+                                 },
+        [LED_WIRE_DMX512] = {
+                             .name = "dmx512",
+                             .size = _dmx512_size,
+                             .prepare = _dmx512_prepare,
+                             .encode = _dmx512_encode,
+                             },
+};
+
+
+/** get descriptor of encoder */
+static const WireEncoder *_encoder(LedWireEncoder e)
+{
+        if(e <= LED_WIRE_NONE || e >= LED_WIRE_MAX)
+                return NULL;
+
+        return &_encoders[e];
+}
+
+
+/** DMX512: get universes chain is split into (default: 512 slots, packed) */
+static NftResult _split(LedWire * w, LedChain * c, LedUniverses * u)
+{
+        if(!u)
+        {
+                if(!w->own &&
+                   !(w->own = _universes_new(DMX512_SLOTS,
+                                             LED_UNIVERSE_PACKED)))
+                        return NFT_FAILURE;
+                u = w->own;
+        }
+
+        if(!(w->universes = _universes_get_all(u, c, &w->nuniverses)) &&
+           w->nuniverses)
+                return NFT_FAILURE;
+
+        int i;
+        for(i = 0; i < w->nuniverses; i++)
+        {
+                if(w->universes[i].size > DMX512_SLOTS)
+                {
+                        NFT_LOG(L_ERROR,
+                                "DMX512 universe can't hold %lu slots",
+                                (unsigned long) w->universes[i].size);
+                        return NFT_FAILURE;
+                }
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+
+/******************************************************************************/
+/************************ "private" API FUNCTIONS *****************************/
+/******************************************************************************/
+
+/**
+ * create new wire encoder
+ *
+ * @param e type of encoder
+ * @result newly allocated LedWire or NULL
+ */
+LedWire *_wire_new(LedWireEncoder e)
+{
+        const WireEncoder *encoder;
+        if(!(encoder = _encoder(e)))
+        {
+                NFT_LOG(L_ERROR, "Invalid wire encoder: %d", e);
+                return NULL;
+        }
+
+        LedWire *w;
+        if(!(w = calloc(1, sizeof(LedWire))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        w->encoder = encoder;
+        w->type = e;
+
+        return w;
+}
+
+
+/**
+ * free wire encoder and its transmit buffer
+ */
+void _wire_free(LedWire * w)
+{
+        if(!w)
+                return;
+
+        _universes_free(w->own);
+        free(w->buffer);
+        free(w);
+}
+
+
+/**
+ * get type of encoder
+ */
+LedWireEncoder _wire_get_encoder(LedWire * w)
+{
+        if(!w)
+                return LED_WIRE_NONE;
+
+        return w->type;
+}
+
+
+/**
+ * forget layout of transmit buffer (e.g. because the universes of the
+ * hardware changed). It's prepared again by the next _wire_encode().
+ */
+void _wire_invalidate(LedWire * w)
+{
+        if(!w)
+                return;
+
+        w->valid = false;
+}
+
+
+/**
+ * (re)calculate layout of transmit buffer for chain and encode whole chain
+ *
+ * @param w LedWire
+ * @param c chain that will be encoded
+ * @param u universes chain is split into or NULL (only used by DMX512)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _wire_prepare(LedWire * w, LedChain * c, LedUniverses * u)
+{
+        if(!w || !c)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        w->valid = false;
+
+        /* encoders work on u8 components only */
+        LedPixelFormat *f = led_chain_get_format(c);
+        size_t components = led_pixel_format_get_n_components(f);
+        if(components == 0 ||
+           led_pixel_format_get_bytes_per_pixel(f) != components)
+        {
+                NFT_LOG(L_ERROR,
+                        "Wire encoder \"%s\" needs 8 bit components (got \"%s\")",
+                        w->encoder->name, led_pixel_format_to_string(f));
+                return NFT_FAILURE;
+        }
+
+        /* some protocols have a fixed amount of components */
+        if(w->encoder->components && components != w->encoder->components)
+        {
+                NFT_LOG(L_ERROR,
+                        "Wire encoder \"%s\" needs %lu components per pixel (got \"%s\")",
+                        w->encoder->name,
+                        (unsigned long) w->encoder->components,
+                        led_pixel_format_to_string(f));
+                return NFT_FAILURE;
+        }
+
+        /* only complete pixels are in the chain buffer */
+        w->leds = (LedCount) led_chain_get_buffer_size(c);
+
+        /* DMX512 uses the universe layout */
+        if(w->type == LED_WIRE_DMX512 && !_split(w, c, u))
+                return NFT_FAILURE;
+
+        size_t size = w->encoder->size(w);
+
+        /* grow buffer */
+        if(size > w->capacity)
+        {
+                void *buffer;
+                if((errno = posix_memalign(&buffer, WIRE_ALIGNMENT, size)))
+                {
+                        NFT_LOG_PERROR("posix_memalign");
+                        return NFT_FAILURE;
+                }
+                free(w->buffer);
+                w->buffer = buffer;
+                w->capacity = size;
+        }
+
+        w->size = size;
+        w->encoder->prepare(w);
+        w->encoder->encode(w, led_chain_get_buffer(c), 0, w->leds);
+        w->valid = true;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * encode range of chain into transmit buffer
+ *
+ * @param w LedWire
+ * @param c chain to encode
+ * @param u universes chain is split into or NULL (only used by DMX512)
+ * @param count amount of LEDs to encode
+ * @param offset first LED to encode
+ * @param size space to store size of encoded frame
+ * @result complete encoded frame or NULL
+ */
+const void *_wire_encode(LedWire * w, LedChain * c, LedUniverses * u,
+                         LedCount count, LedCount offset, size_t * size)
+{
+        if(!w || !c || !size)
+                NFT_LOG_NULL(NULL);
+
+        /* layout changed since last mapping? (this encodes everything) */
+        if(!w->valid || w->leds != (LedCount) led_chain_get_buffer_size(c))
+        {
+                if(!_wire_prepare(w, c, u))
+                        return NULL;
+        }
+        else
+        {
+                /* an incomplete last pixel isn't part of the chain buffer */
+                if(offset < 0 || offset > w->leds)
+                        offset = w->leds;
+                if(count < 0 || count > w->leds - offset)
+                        count = w->leds - offset;
+
+                w->encoder->encode(w, led_chain_get_buffer(c), offset, count);
+        }
+
+        *size = w->size;
+
+        return w->buffer;
+}
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+/**
+ * get name of wire encoder
+ *
+ * @param e type of encoder
+ * @result name of encoder or NULL
+ */
+const char *led_hardware_wire_encoder_to_string(LedWireEncoder e)
+{
+        if(e == LED_WIRE_NONE)
+                return "none";
+
+        const WireEncoder *encoder;
+        if(!(encoder = _encoder(e)))
+                return NULL;
+
+        return encoder->name;
+}
+
+
+/**
+ * get wire encoder by name
+ *
+ * @param name name of encoder (e.g. "apa102", "ws281x-spi", "dmx512")
+ * @result type of encoder or LED_WIRE_MAX if name is unknown
+ */
+LedWireEncoder led_hardware_wire_encoder_from_string(const char *name)
+{
+        if(!name)
+                NFT_LOG_NULL(LED_WIRE_MAX);
+
+        if(strcmp(name, "none") == 0)
+                return LED_WIRE_NONE;
+
+        LedWireEncoder e;
+        for(e = LED_WIRE_NONE + 1; e < LED_WIRE_MAX; e++)
+        {
+                if(strcmp(name, _encoders[e].name) == 0)
+                        return e;
+        }
+
+        NFT_LOG(L_ERROR, "Unknown wire encoder: \"%s\"", name);
+
+        return LED_WIRE_MAX;
+}
+
+
+/**
+ * @}
+ */
@@ -46,25 +46,51 @@
 #define _LED__LED_H
 
 
-/** model of one single LED  */
-struct _Led
+/**
+ * storage for the LED descriptors of one chain. Every property is kept in
+ * its own array (structure of arrays) so loops that only touch positions and
+ * components (e.g. mapping) stream through compact memory.
+ */
+typedef struct
 {
-        /** position of LED inside pixmap */
-        LedFrameCord x, y;
-        /** component-number this LED has in a pixel
+        /** amount of LEDs in arrays */
+        LedCount count;
+        /** amount of LEDs arrays are allocated for (>= count) */
+        LedCount capacity;
+        /** position of LEDs inside pixmap */
+        LedFrameCord *x, *y;
+        /** component-number each LED has in a pixel
 		    (red, green, blue, cyan, ...) For example, in a RGB system, a red
 			LED would have component number 0, a green one has 1 and a blue one
 			has 2 */
-        LedFrameComponent component;
-        /** 32 bit gain value of this LED - use this to define brightness 
+        LedFrameComponent *component;
+        /** 32 bit gain value of each LED - use this to define brightness 
 		    for LED hardware that supports it. The hardware plugin has to 
 		    scale the 32 bit value so it can be used by the hardware.
 		    0 should be lowest brightness, UINT32_MAX should be maximum brightness */
-        LedGain gain;
-        /** private userdata */
-        void *privdata;
+        LedGain *gain;
+        /** private userdata of each LED (NULL until first led_set_privdata()) */
+        void **privdata;
+        /** chain these LEDs belong to (NULL if none) */
+        LedChain *chain;
+} LedArray;
+
+
+/** model of one single LED (view of one entry in a LedArray) */
+struct _Led
+{
+        /** array holding the properties of this LED */
+        LedArray *array;
+        /** position of this LED inside the array */
+        LedCount pos;
 };
 
 
 
+NftResult                       _array_set_count(LedArray * a, LedCount count);
+void                            _array_free(LedArray * a);
+void                            _array_copy(LedArray * dst, LedCount dpos, LedArray * src, LedCount spos, LedCount count);
+
+
+
 #endif /* _LED__LED_H */
@@ -53,10 +53,16 @@
  */
 
 #include "niftyled-led.h"
+#include "niftyled-chain.h"
 #include "niftyled-frame.h"
 #include "_led.h"
+#include "_chain.h"
+#include "_arena.h"
 
 
+/** helper macro */
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
 
 
 /******************************************************************************/
@@ -68,6 +74,142 @@
 /************************ "private" API FUNCTIONS *****************************/
 /******************************************************************************/
 
+/**
+ * change amount of LEDs in a LedArray. New LEDs are zeroed. Arrays only
+ * get reallocated when count exceeds the capacity and never shrink
+ * (unless count is 0).
+ *
+ * @param a LedArray
+ * @param count new amount of LEDs
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _array_set_count(LedArray * a, LedCount count)
+{
+        if(!a)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(count == 0)
+        {
+                _array_free(a);
+                return NFT_SUCCESS;
+        }
+
+        /* grow arrays geometrically so adding LEDs one by one is cheap */
+        if(count > a->capacity)
+        {
+                LedCount capacity = MAX(count, a->capacity * 2);
+
+                LedFrameCord *x, *y;
+                LedFrameComponent *component;
+                LedGain *gain;
+
+                if(!(x = _arena_realloc(a->x, capacity * sizeof(LedFrameCord))))
+                        goto _lasc_error;
+                a->x = x;
+
+                if(!(y = _arena_realloc(a->y, capacity * sizeof(LedFrameCord))))
+                        goto _lasc_error;
+                a->y = y;
+
+                if(!(component = _arena_realloc(a->component,
+                                                capacity *
+                                                sizeof(LedFrameComponent))))
+                        goto _lasc_error;
+                a->component = component;
+
+                if(!(gain = _arena_realloc(a->gain, capacity * sizeof(LedGain))))
+                        goto _lasc_error;
+                a->gain = gain;
+
+                /* only resize privdata if it has been allocated already */
+                if(a->privdata)
+                {
+                        void **privdata;
+                        if(!(privdata = _arena_realloc(a->privdata,
+                                                       capacity *
+                                                       sizeof(void *))))
+                                goto _lasc_error;
+                        a->privdata = privdata;
+                }
+
+                a->capacity = capacity;
+        }
+
+        /* clear new LEDs */
+        if(count > a->count)
+        {
+                LedCount n = count - a->count;
+                memset(&a->x[a->count], 0, n * sizeof(LedFrameCord));
+                memset(&a->y[a->count], 0, n * sizeof(LedFrameCord));
+                memset(&a->component[a->count], 0,
+                       n * sizeof(LedFrameComponent));
+                memset(&a->gain[a->count], 0, n * sizeof(LedGain));
+                if(a->privdata)
+                        memset(&a->privdata[a->count], 0, n * sizeof(void *));
+        }
+
+        a->count = count;
+
+        return NFT_SUCCESS;
+
+_lasc_error:
+        /* arrays that were resized already stay valid, the old capacity
+         * still fits into all of them */
+        NFT_LOG_PERROR("realloc");
+        return NFT_FAILURE;
+}
+
+
+/**
+ * free all arrays of a LedArray
+ *
+ * @param a LedArray
+ */
+void _array_free(LedArray * a)
+{
+        if(!a)
+                return;
+
+        _arena_free(a->x);
+        _arena_free(a->y);
+        _arena_free(a->component);
+        _arena_free(a->gain);
+        _arena_free(a->privdata);
+
+        /* arrays stay owned by the same chain */
+        LedChain *chain = a->chain;
+        memset(a, 0, sizeof(LedArray));
+        a->chain = chain;
+}
+
+
+/**
+ * copy a range of LEDs from one LedArray to another (arrays may be the same)
+ *
+ * @param dst destination LedArray
+ * @param dpos position of first LED in destination array
+ * @param src source LedArray
+ * @param spos position of first LED in source array
+ * @param count amount of LEDs to copy
+ * @note private userdata will NOT be copied (like led_copy())
+ */
+void _array_copy(LedArray * dst, LedCount dpos, LedArray * src,
+                 LedCount spos, LedCount count)
+{
+        if(!dst || !src)
+                NFT_LOG_NULL();
+
+        if(count <= 0)
+                return;
+
+        memmove(&dst->x[dpos], &src->x[spos], count * sizeof(LedFrameCord));
+        memmove(&dst->y[dpos], &src->y[spos], count * sizeof(LedFrameCord));
+        memmove(&dst->component[dpos], &src->component[spos],
+                count * sizeof(LedFrameComponent));
+        memmove(&dst->gain[dpos], &src->gain[spos], count * sizeof(LedGain));
+}
+
+
 
 /******************************************************************************/
 /**************************** API FUNCTIONS ***********************************/
@@ -86,8 +228,11 @@ NftResult led_set_pos(Led * l, LedFrameCord x, LedFrameCord y)
         if(!l)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        l->x = x;
-        l->y = y;
+        l->array->x[l->pos] = x;
+        l->array->y[l->pos] = y;
+
+        /* cached dimensions of tiles are outdated now */
+        _chain_positions_changed(l->array->chain);
 
         return NFT_SUCCESS;
 }
@@ -107,9 +252,9 @@ NftResult led_get_pos(Led * l, LedFrameCord * x, LedFrameCord * y)
                 NFT_LOG_NULL(NFT_FAILURE);
 
         if(x)
-                *x = l->x;
+                *x = l->array->x[l->pos];
         if(y)
-                *y = l->y;
+                *y = l->array->y[l->pos];
 
         return NFT_SUCCESS;
 }
@@ -127,7 +272,7 @@ NftResult led_set_component(Led * l, LedFrameComponent component)
         if(!l)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        l->component = component;
+        l->array->component[l->pos] = component;
 
         return NFT_SUCCESS;
 }
@@ -144,7 +289,7 @@ LedFrameComponent led_get_component(Led * l)
         if(!l)
                 NFT_LOG_NULL(0);
 
-        return l->component;
+        return l->array->component[l->pos];
 }
 
 
@@ -159,7 +304,7 @@ NftResult led_set_gain(Led * l, LedGain gain)
         if(!l)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        l->gain = gain;
+        l->array->gain[l->pos] = gain;
 
         return NFT_SUCCESS;
 }
@@ -176,7 +321,7 @@ LedGain led_get_gain(Led * l)
         if(!l)
                 NFT_LOG_NULL(0);
 
-        return l->gain;
+        return l->array->gain[l->pos];
 }
 
 
@@ -191,7 +336,11 @@ void *led_get_privdata(Led * l)
         if(!l)
                 NFT_LOG_NULL(NULL);
 
-        return l->privdata;
+        /* no privdata set in this array, yet */
+        if(!l->array->privdata)
+                return NULL;
+
+        return l->array->privdata[l->pos];
 }
 
 
@@ -207,7 +356,22 @@ NftResult led_set_privdata(Led * l, void *privdata)
         if(!l)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        l->privdata = privdata;
+        /* allocate privdata array on first use */
+        if(!l->array->privdata)
+        {
+                /* nothing to do */
+                if(!privdata)
+                        return NFT_SUCCESS;
+
+                if(!(l->array->privdata =
+                     _arena_calloc(l->array->capacity, sizeof(void *))))
+                {
+                        NFT_LOG_PERROR("calloc");
+                        return NFT_FAILURE;
+                }
+        }
+
+        l->array->privdata[l->pos] = privdata;
 
         return NFT_SUCCESS;
 }
@@ -226,14 +390,11 @@ NftResult led_copy(Led * dst, Led * src)
         if(!dst || !src)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        /* save private pointer */
-        void *ptr = dst->privdata;
-
-        /* copy structure */
-        memcpy(dst, src, sizeof(Led));
+        /* copy properties (private pointer of dst will be kept) */
+        _array_copy(dst->array, dst->pos, src->array, src->pos, 1);
 
-        /* copy private pointer back so it will be kept */
-        dst->privdata = ptr;
+        /* cached dimensions of tiles are outdated now */
+        _chain_positions_changed(dst->array->chain);
 
         return NFT_SUCCESS;
 }
@@ -47,7 +47,24 @@
 #include "niftyled-prefs_chain.h"
 
 
+/**
+ * read access to the properties of a node, no matter if it's part of a
+ * NftPrefs document or read by a streaming parser
+ */
+typedef struct
+{
+        /** get property as newly allocated string (NULL if it's not set) */
+        char *(*get) (void *node, const char *name);
+        /** free string returned by get() */
+        void (*release) (void *string);
+        /** node to access */
+        void *node;
+} PrefsProps;
+
+
 NftResult                       _prefs_chain_class_register(NftPrefs * p);
+NftResult                       _prefs_chain_packed_from_props(LedChain * c, PrefsProps * p, bool * found);
+NftResult                       _prefs_chain_layout_from_props(LedChain * c, PrefsProps * p, LedCount * pos);
 
 
 
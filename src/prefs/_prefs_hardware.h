@@ -48,6 +48,7 @@
 
 
 NftResult                       _prefs_hardware_class_register(NftPrefs * p);
+NftResult                       _prefs_hardware_prop_set(LedHardware * h, const char *name, const char *type, const char *value);
 
 
 
@@ -0,0 +1,1037 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file prefs_cache.c
+ *
+ * binary snapshot of a fully loaded LedSetup
+ *
+ * The file starts with a header that holds a hash of the XML source it was
+ * generated from. All records are stored in host byte order and aligned to 8
+ * bytes, so the file can be used directly from a read-only mapping:
+ *
+ * - header
+ * - for every hardware: hardware record, name, plugin, id and pixel-format
+ *   strings, custom properties, tiles
+ * - for every tile: tile record, pixel-format string and x, y, component &
+ *   gain arrays of its chain, child tiles
+ */
+
+
+/**
+ * @addtogroup prefs_cache
+ * @{
+ */
+
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <niftyled.h>
+#include "_chain.h"
+#include "_relation.h"
+
+
+
+/** first bytes of every cache file */
+#define LED_PREFS_CACHE_MAGIC   "NFTLEDC"
+/** increase whenever the layout of the cache changes */
+#define LED_PREFS_CACHE_VERSION 1
+/** used to detect cache files written on a host with different byte order */
+#define LED_PREFS_CACHE_BOM     0x01020304
+/** all records are aligned to this amount of bytes */
+#define LED_PREFS_CACHE_ALIGN   8
+
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+
+/** header of a cache file */
+typedef struct
+{
+        /** LED_PREFS_CACHE_MAGIC */
+        char magic[8];
+        /** LED_PREFS_CACHE_VERSION */
+        uint32_t version;
+        /** LED_PREFS_CACHE_BOM */
+        uint32_t bom;
+        /** sizes of LedFrameCord, LedFrameComponent & LedGain */
+        uint8_t sizes[4];
+        /** amount of hardware records */
+        uint32_t hardware;
+        /** hash of XML source */
+        uint64_t hash;
+        /** size of XML source in bytes */
+        uint64_t srcsize;
+        /** total size of cache file in bytes */
+        uint64_t size;
+} CacheHeader;
+
+/** one LedHardware (followed by name, plugin, id and format strings) */
+typedef struct
+{
+        int64_t stride;
+        /** LEDs of hardware chain (0 if hardware has no chain) */
+        int64_t ledcount;
+        /** amount of custom properties */
+        uint32_t props;
+        /** amount of top-level tiles */
+        uint32_t tiles;
+} CacheHardware;
+
+/** one custom plugin property (followed by name and string value) */
+typedef struct
+{
+        /** LedPluginCustomPropType */
+        uint32_t type;
+        uint32_t pad;
+        union
+        {
+                int64_t i;
+                double f;
+        } value;
+} CacheProp;
+
+/** one LedTile (followed by format string & LED arrays if it has a chain) */
+typedef struct
+{
+        int32_t x, y;
+        double pivot_x, pivot_y;
+        /** rotation in radians */
+        double rotation;
+        /** LEDs of tile chain */
+        int64_t ledcount;
+        /** amount of child tiles */
+        uint32_t children;
+        /** 1 if tile has a chain */
+        uint32_t chain;
+} CacheTile;
+
+
+/** growing buffer a cache is assembled in */
+typedef struct
+{
+        char *data;
+        size_t size;
+        size_t capacity;
+        /** stack used to traverse tiles */
+        RelationStack stack;
+} CacheWriter;
+
+/** cursor to read records from a mapped cache */
+typedef struct
+{
+        const char *data;
+        size_t size;
+        size_t pos;
+} CacheReader;
+
+/** tile that still awaits child tiles while reading */
+typedef struct
+{
+        LedTile *t;
+        /** amount of child tiles still to be read */
+        uint32_t children;
+} CacheParent;
+
+/** stack of tiles awaiting children */
+typedef struct
+{
+        CacheParent *entries;
+        size_t count;
+        size_t size;
+} CacheParentStack;
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** round up to record alignment */
+static size_t _align(size_t size)
+{
+        return (size + LED_PREFS_CACHE_ALIGN - 1) &
+                ~((size_t) LED_PREFS_CACHE_ALIGN - 1);
+}
+
+
+/** 64 bit FNV-1a hash of a buffer */
+static uint64_t _hash(const void *buf, size_t size)
+{
+        const unsigned char *b = buf;
+        uint64_t h = 14695981039346656037ULL;
+
+        size_t i;
+        for(i = 0; i < size; i++)
+        {
+                h ^= b[i];
+                h *= 1099511628211ULL;
+        }
+
+        return h;
+}
+
+
+/** map a whole file read-only (use munmap() to release) */
+static void *_map_file(const char *filename, size_t * size)
+{
+        int fd;
+        if((fd = open(filename, O_RDONLY)) < 0)
+                return NULL;
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || st.st_size <= 0)
+        {
+                close(fd);
+                return NULL;
+        }
+
+        void *map = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE,
+                         fd, 0);
+        close(fd);
+
+        if(map == MAP_FAILED)
+        {
+                NFT_LOG_PERROR("mmap");
+                return NULL;
+        }
+
+        *size = (size_t) st.st_size;
+        return map;
+}
+
+
+/** hash a file */
+static NftResult _hash_file(const char *filename, uint64_t * hash,
+                            uint64_t * size)
+{
+        void *map;
+        size_t s;
+        if(!(map = _map_file(filename, &s)))
+        {
+                NFT_LOG(L_ERROR, "Failed to read \"%s\"", filename);
+                return NFT_FAILURE;
+        }
+
+        *hash = _hash(map, s);
+        *size = s;
+
+        munmap(map, s);
+
+        return NFT_SUCCESS;
+}
+
+
+/** append aligned record to cache */
+static NftResult _put(CacheWriter * w, const void *src, size_t size)
+{
+        size_t aligned = _align(size);
+
+        /* grow buffer geometrically */
+        if(w->size + aligned > w->capacity)
+        {
+                size_t capacity = w->capacity ? w->capacity * 2 : 4096;
+                while(capacity < w->size + aligned)
+                        capacity *= 2;
+
+                char *data;
+                if(!(data = realloc(w->data, capacity)))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+
+                w->data = data;
+                w->capacity = capacity;
+        }
+
+        memcpy(w->data + w->size, src, size);
+        memset(w->data + w->size + size, 0, aligned - size);
+        w->size += aligned;
+
+        return NFT_SUCCESS;
+}
+
+
+/** append string to cache (length incl. terminating 0, then characters) */
+static NftResult _put_string(CacheWriter * w, const char *s)
+{
+        if(!s)
+                s = "";
+
+        uint64_t length = strlen(s) + 1;
+        if(!_put(w, &length, sizeof(length)))
+                return NFT_FAILURE;
+
+        return _put(w, s, length);
+}
+
+
+/** get pointer to next aligned record of "size" bytes or NULL */
+static const void *_get(CacheReader * r, size_t size)
+{
+        size_t aligned = _align(size);
+        if(aligned < size || aligned > r->size - r->pos)
+        {
+                NFT_LOG(L_ERROR, "Cache is truncated");
+                return NULL;
+        }
+
+        const void *p = r->data + r->pos;
+        r->pos += aligned;
+
+        return p;
+}
+
+
+/** get next string from cache or NULL */
+static const char *_get_string(CacheReader * r)
+{
+        const uint64_t *length;
+        if(!(length = _get(r, sizeof(*length))))
+                return NULL;
+
+        if(*length == 0 || *length > r->size)
+        {
+                NFT_LOG(L_ERROR, "Invalid string in cache");
+                return NULL;
+        }
+
+        const char *s;
+        if(!(s = _get(r, (size_t) * length)))
+                return NULL;
+
+        /* string must be terminated */
+        if(s[*length - 1] != '\0')
+        {
+                NFT_LOG(L_ERROR, "Unterminated string in cache");
+                return NULL;
+        }
+
+        return s;
+}
+
+
+/** append LED arrays of chain to cache */
+static NftResult _put_chain(CacheWriter * w, LedChain * c)
+{
+        if(!_put_string(w, led_pixel_format_to_string(led_chain_get_format(c))))
+                return NFT_FAILURE;
+
+        LedArray *a = _chain_get_leds(c);
+        LedCount n = led_chain_get_ledcount(c);
+
+        if(!_put(w, a->x, n * sizeof(LedFrameCord)) ||
+           !_put(w, a->y, n * sizeof(LedFrameCord)) ||
+           !_put(w, a->component, n * sizeof(LedFrameComponent)) ||
+           !_put(w, a->gain, n * sizeof(LedGain)))
+                return NFT_FAILURE;
+
+        return NFT_SUCCESS;
+}
+
+
+/** create chain from cache */
+static LedChain *_get_chain(CacheReader * r, LedCount ledcount)
+{
+        const char *format;
+        if(!(format = _get_string(r)))
+                return NULL;
+
+        if(ledcount <= 0 || (size_t) ledcount > r->size)
+        {
+                NFT_LOG(L_ERROR, "Invalid chain length in cache: %ld",
+                        ledcount);
+                return NULL;
+        }
+
+        /* get LED arrays */
+        const void *x, *y, *component, *gain;
+        if(!(x = _get(r, ledcount * sizeof(LedFrameCord))) ||
+           !(y = _get(r, ledcount * sizeof(LedFrameCord))) ||
+           !(component = _get(r, ledcount * sizeof(LedFrameComponent))) ||
+           !(gain = _get(r, ledcount * sizeof(LedGain))))
+                return NULL;
+
+        LedChain *c;
+        if(!(c = led_chain_new(ledcount, format)))
+                return NULL;
+
+        /* copy LEDs straight into chain */
+        LedArray *a = _chain_get_leds(c);
+        memcpy(a->x, x, ledcount * sizeof(LedFrameCord));
+        memcpy(a->y, y, ledcount * sizeof(LedFrameCord));
+        memcpy(a->component, component, ledcount * sizeof(LedFrameComponent));
+        memcpy(a->gain, gain, ledcount * sizeof(LedGain));
+
+        _chain_positions_changed(c);
+
+        return c;
+}
+
+
+/** append one tile and its chain to cache (foreach function) */
+static NftResult _put_tile(Relation * r, void *userptr)
+{
+        CacheWriter *w = userptr;
+        LedTile *t = (LedTile *) r;
+
+        CacheTile rec;
+        memset(&rec, 0, sizeof(rec));
+
+        LedFrameCord x, y;
+        if(!led_tile_get_pos(t, &x, &y))
+                return NFT_FAILURE;
+        rec.x = x;
+        rec.y = y;
+
+        if(!led_tile_get_pivot(t, &rec.pivot_x, &rec.pivot_y))
+                return NFT_FAILURE;
+        rec.rotation = led_tile_get_rotation(t);
+
+        LedChain *c = led_tile_get_chain(t);
+        if(c)
+        {
+                rec.chain = 1;
+                rec.ledcount = led_chain_get_ledcount(c);
+        }
+
+        LedTile *child;
+        for(child = led_tile_get_child(t); child;
+            child = led_tile_list_get_next(child))
+                rec.children++;
+
+        if(!_put(w, &rec, sizeof(rec)))
+                return NFT_FAILURE;
+
+        /* chain */
+        if(c && !_put_chain(w, c))
+                return NFT_FAILURE;
+
+        return NFT_SUCCESS;
+}
+
+
+/** push tile that still awaits child tiles onto stack */
+static NftResult _parent_push(CacheParentStack * s, LedTile * t,
+                              uint32_t children)
+{
+        /* grow stack geometrically */
+        if(s->count >= s->size)
+        {
+                size_t size = MAX(16, s->size * 2);
+
+                CacheParent *entries;
+                if(!(entries = realloc(s->entries,
+                                       size * sizeof(CacheParent))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+
+                s->entries = entries;
+                s->size = size;
+        }
+
+        s->entries[s->count].t = t;
+        s->entries[s->count].children = children;
+        s->count++;
+
+        return NFT_SUCCESS;
+}
+
+
+/** create one tile and its chain from cache */
+static LedTile *_get_one_tile(CacheReader * r, uint32_t * children)
+{
+        const CacheTile *rec;
+        if(!(rec = _get(r, sizeof(*rec))))
+                return NULL;
+
+        LedTile *t;
+        if(!(t = led_tile_new()))
+                return NULL;
+
+        led_tile_set_pos(t, rec->x, rec->y);
+        led_tile_set_pivot(t, rec->pivot_x, rec->pivot_y);
+        led_tile_set_rotation(t, rec->rotation);
+
+        /* chain */
+        if(rec->chain)
+        {
+                LedChain *c;
+                if(!(c = _get_chain(r, (LedCount) rec->ledcount)))
+                        goto _got_error;
+
+                if(!led_tile_set_chain(t, c))
+                {
+                        led_chain_destroy(c);
+                        goto _got_error;
+                }
+        }
+
+        *children = rec->children;
+        return t;
+
+_got_error:
+        led_tile_destroy(t);
+        return NULL;
+}
+
+
+/**
+ * create tile and all its children from cache. Tiles are stored in
+ * pre-order, so every tile read belongs to the topmost parent on the stack
+ * that still awaits children.
+ */
+static LedTile *_get_tile(CacheReader * r)
+{
+        CacheParentStack s = { NULL, 0, 0 };
+
+        uint32_t children;
+        LedTile *root;
+        if(!(root = _get_one_tile(r, &children)))
+                return NULL;
+
+        if(children > 0 && !_parent_push(&s, root, children))
+                goto _gt_error;
+
+        while(s.count > 0)
+        {
+                CacheParent *p = &s.entries[s.count - 1];
+
+                LedTile *child;
+                if(!(child = _get_one_tile(r, &children)))
+                        goto _gt_error;
+
+                if(!led_tile_list_append_child(p->t, child))
+                {
+                        led_tile_destroy(child);
+                        goto _gt_error;
+                }
+
+                /* parent complete? */
+                if(--p->children == 0)
+                        s.count--;
+
+                if(children > 0 && !_parent_push(&s, child, children))
+                        goto _gt_error;
+        }
+
+        free(s.entries);
+        return root;
+
+_gt_error:
+        free(s.entries);
+        led_tile_destroy(root);
+        return NULL;
+}
+
+
+/** append hardware, its plugin properties and tiles to cache */
+static NftResult _put_hardware(CacheWriter * w, LedHardware * h)
+{
+        CacheHardware rec;
+        memset(&rec, 0, sizeof(rec));
+
+        rec.stride = led_hardware_get_stride(h);
+
+        LedChain *c = led_hardware_get_chain(h);
+        if(c)
+                rec.ledcount = led_chain_get_ledcount(c);
+
+        LedPluginCustomProp *prop;
+        for(prop = led_hardware_plugin_prop_get_nth(h, 0); prop;
+            prop = led_hardware_plugin_prop_get_next(prop))
+                rec.props++;
+
+        LedTile *t;
+        for(t = led_hardware_get_tile(h); t; t = led_tile_list_get_next(t))
+                rec.tiles++;
+
+        if(!_put(w, &rec, sizeof(rec)) ||
+           !_put_string(w, led_hardware_get_name(h)) ||
+           !_put_string(w, led_hardware_plugin_get_family(h)) ||
+           !_put_string(w, led_hardware_get_id(h)) ||
+           !_put_string(w, c ? led_pixel_format_to_string(led_chain_get_format
+                                                          (c)) : ""))
+                return NFT_FAILURE;
+
+        /* custom plugin properties */
+        for(prop = led_hardware_plugin_prop_get_nth(h, 0); prop;
+            prop = led_hardware_plugin_prop_get_next(prop))
+        {
+                const char *name = led_hardware_plugin_prop_get_name(prop);
+
+                CacheProp p;
+                memset(&p, 0, sizeof(p));
+                p.type = led_hardware_plugin_prop_get_type(prop);
+
+                char *string = NULL;
+                switch (p.type)
+                {
+                        case LED_HW_CUSTOM_PROP_STRING:
+                        {
+                                if(!led_hardware_plugin_prop_get_string
+                                   (h, name, &string))
+                                        return NFT_FAILURE;
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_INT:
+                        {
+                                int integer;
+                                if(!led_hardware_plugin_prop_get_int
+                                   (h, name, &integer))
+                                        return NFT_FAILURE;
+                                p.value.i = integer;
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_FLOAT:
+                        {
+                                float fp;
+                                if(!led_hardware_plugin_prop_get_float
+                                   (h, name, &fp))
+                                        return NFT_FAILURE;
+                                p.value.f = fp;
+                                break;
+                        }
+
+                        default:
+                        {
+                                NFT_LOG(L_WARNING,
+                                        "Property \"%s\" is of unsupported type. Ignoring",
+                                        name);
+                                break;
+                        }
+                }
+
+                if(!_put(w, &p, sizeof(p)) ||
+                   !_put_string(w, name) || !_put_string(w, string))
+                        return NFT_FAILURE;
+        }
+
+        /* all tiles and their children in pre-order */
+        if(!_relation_foreach_preorder(RELATION(led_hardware_get_tile(h)),
+                                       &w->stack, _put_tile, w))
+                return NFT_FAILURE;
+
+        return NFT_SUCCESS;
+}
+
+
+/** create hardware from cache */
+static LedHardware *_get_hardware(CacheReader * r)
+{
+        const CacheHardware *rec;
+        const char *name, *plugin, *id, *format;
+        if(!(rec = _get(r, sizeof(*rec))) ||
+           !(name = _get_string(r)) ||
+           !(plugin = _get_string(r)) ||
+           !(id = _get_string(r)) || !(format = _get_string(r)))
+                return NULL;
+
+        LedHardware *h;
+        if(!(h = led_hardware_new(name, plugin)))
+        {
+                NFT_LOG(L_ERROR,
+                        "Failed to initialize \"%s\" from \"%s\" plugin.",
+                        name, plugin);
+                return NULL;
+        }
+
+        if(!led_hardware_set_stride(h, (LedCount) rec->stride) ||
+           !led_hardware_set_id(h, id))
+                goto _gh_error;
+
+        /* custom plugin properties */
+        uint32_t i;
+        for(i = 0; i < rec->props; i++)
+        {
+                const CacheProp *p;
+                const char *pname, *string;
+                if(!(p = _get(r, sizeof(*p))) ||
+                   !(pname = _get_string(r)) || !(string = _get_string(r)))
+                        goto _gh_error;
+
+                NftResult res;
+                switch (p->type)
+                {
+                        case LED_HW_CUSTOM_PROP_STRING:
+                        {
+                                res = led_hardware_plugin_prop_set_string(h,
+                                                                          pname,
+                                                                          string);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_INT:
+                        {
+                                res = led_hardware_plugin_prop_set_int(h,
+                                                                       pname,
+                                                                       (int)
+                                                                       p->value.
+                                                                       i);
+                                break;
+                        }
+
+                        case LED_HW_CUSTOM_PROP_FLOAT:
+                        {
+                                res = led_hardware_plugin_prop_set_float(h,
+                                                                         pname,
+                                                                         (float)
+                                                                         p->
+                                                                         value.
+                                                                         f);
+                                break;
+                        }
+
+                        default:
+                        {
+                                continue;
+                        }
+                }
+
+                if(!res)
+                        NFT_LOG(L_ERROR, "Failed to set \"%s\"", pname);
+        }
+
+        /* initialize hardware (after all hardware has been created) */
+        if(rec->ledcount > 0 &&
+           !led_hardware_init_deferred(h, id, (LedCount) rec->ledcount,
+                                       format))
+        {
+                NFT_LOG(L_WARNING, "Failed to initialize hardware \"%s\"",
+                        name);
+        }
+
+        /* tiles */
+        for(i = 0; i < rec->tiles; i++)
+        {
+                LedTile *t;
+                if(!(t = _get_tile(r)))
+                        goto _gh_error;
+
+                if(!led_hardware_append_tile(h, t))
+                {
+                        led_tile_destroy(t);
+                        goto _gh_error;
+                }
+        }
+
+        return h;
+
+_gh_error:
+        led_hardware_destroy(h);
+        return NULL;
+}
+
+
+/** write snapshot of setup (with given source hash) to file */
+static NftResult _write(LedSetup * s, uint64_t hash, uint64_t srcsize,
+                        const char *filename)
+{
+        NftResult result = NFT_FAILURE;
+        CacheWriter w = { NULL, 0, 0, { NULL, 0, 0 } };
+
+
+        /* header (completed below) */
+        CacheHeader header;
+        memset(&header, 0, sizeof(header));
+        strncpy(header.magic, LED_PREFS_CACHE_MAGIC, sizeof(header.magic));
+        header.version = LED_PREFS_CACHE_VERSION;
+        header.bom = LED_PREFS_CACHE_BOM;
+        header.sizes[0] = sizeof(LedFrameCord);
+        header.sizes[1] = sizeof(LedFrameComponent);
+        header.sizes[2] = sizeof(LedGain);
+        header.hash = hash;
+        header.srcsize = srcsize;
+
+        if(!_put(&w, &header, sizeof(header)))
+                goto _w_end;
+
+        /* all hardware */
+        LedHardware *h;
+        for(h = led_setup_get_hardware(s); h;
+            h = led_hardware_list_get_next(h))
+        {
+                if(!_put_hardware(&w, h))
+                        goto _w_end;
+
+                header.hardware++;
+        }
+
+        header.size = w.size;
+        memcpy(w.data, &header, sizeof(header));
+
+
+        /* write to temporary file and move it in place */
+        char tmp[PATH_MAX];
+        if(snprintf(tmp, sizeof(tmp), "%s.tmp", filename) >= (int) sizeof(tmp))
+        {
+                NFT_LOG(L_ERROR, "Filename too long: \"%s\"", filename);
+                goto _w_end;
+        }
+
+        FILE *f;
+        if(!(f = fopen(tmp, "w")))
+        {
+                NFT_LOG_PERROR("fopen");
+                goto _w_end;
+        }
+
+        size_t written = fwrite(w.data, 1, w.size, f);
+        if(fclose(f) != 0 || written != w.size)
+        {
+                NFT_LOG(L_ERROR, "Failed to write \"%s\"", tmp);
+                unlink(tmp);
+                goto _w_end;
+        }
+
+        if(rename(tmp, filename) != 0)
+        {
+                NFT_LOG_PERROR("rename");
+                unlink(tmp);
+                goto _w_end;
+        }
+
+        NFT_LOG(L_DEBUG, "Wrote %lu bytes of setup cache to \"%s\"",
+                (unsigned long) w.size, filename);
+
+        result = NFT_SUCCESS;
+
+_w_end:
+        _relation_stack_free(&w.stack);
+        free(w.data);
+        return result;
+}
+
+
+/** build setup from mapped cache if it matches source hash */
+static LedSetup *_read(const char *data, size_t size, uint64_t hash,
+                       uint64_t srcsize)
+{
+        CacheReader r = { data, size, 0 };
+
+        /* validate header */
+        const CacheHeader *header;
+        if(!(header = _get(&r, sizeof(*header))))
+                return NULL;
+
+        if(strncmp(header->magic, LED_PREFS_CACHE_MAGIC,
+                   sizeof(header->magic)) != 0 ||
+           header->version != LED_PREFS_CACHE_VERSION ||
+           header->bom != LED_PREFS_CACHE_BOM ||
+           header->sizes[0] != sizeof(LedFrameCord) ||
+           header->sizes[1] != sizeof(LedFrameComponent) ||
+           header->sizes[2] != sizeof(LedGain) || header->size != size)
+        {
+                NFT_LOG(L_INFO, "Incompatible setup cache. Ignoring.");
+                return NULL;
+        }
+
+        if(header->hash != hash || header->srcsize != srcsize)
+        {
+                NFT_LOG(L_INFO, "Setup cache is outdated. Ignoring.");
+                return NULL;
+        }
+
+
+        LedSetup *s;
+        if(!(s = led_setup_new()))
+                return NULL;
+
+        /* create all hardware */
+        uint32_t i;
+        for(i = 0; i < header->hardware; i++)
+        {
+                LedHardware *h;
+                if(!(h = _get_hardware(&r)))
+                {
+                        led_setup_destroy(s);
+                        return NULL;
+                }
+
+                /* register first hardware */
+                if(!led_setup_get_hardware(s))
+                {
+                        led_setup_set_hardware(s, h);
+                }
+                /* attach hardware to list */
+                else if(!led_hardware_list_append_head
+                        (led_setup_get_hardware(s), h))
+                {
+                        led_hardware_destroy(h);
+                        led_setup_destroy(s);
+                        return NULL;
+                }
+        }
+
+        /* initialize all hardware concurrently */
+        if(led_setup_get_hardware(s) &&
+           !led_hardware_list_init_deferred(led_setup_get_hardware(s), 0))
+                NFT_LOG(L_WARNING, "Failed to initialize all hardware");
+
+        return s;
+}
+
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+/**
+ * write binary snapshot of a LedSetup
+ *
+ * @param s LedSetup to save
+ * @param source full path of the XML file the setup was loaded from
+ * @param filename full path of the cache file to write
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_prefs_cache_write(LedSetup * s, const char *source,
+                                const char *filename)
+{
+        if(!s || !source || !filename)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        uint64_t hash, srcsize;
+        if(!_hash_file(source, &hash, &srcsize))
+                return NFT_FAILURE;
+
+        return _write(s, hash, srcsize, filename);
+}
+
+
+/**
+ * create LedSetup from binary snapshot
+ *
+ * @param source full path of the XML file the cache was generated from
+ * @param filename full path of cache file
+ * @result newly created LedSetup or NULL if cache is missing, invalid or
+ * doesn't match the current contents of "source"
+ */
+LedSetup *led_prefs_cache_read(const char *source, const char *filename)
+{
+        if(!source || !filename)
+                NFT_LOG_NULL(NULL);
+
+        uint64_t hash, srcsize;
+        if(!_hash_file(source, &hash, &srcsize))
+                return NULL;
+
+        void *map;
+        size_t size;
+        if(!(map = _map_file(filename, &size)))
+                return NULL;
+
+        LedSetup *s = _read(map, size, hash, srcsize);
+
+        munmap(map, size);
+
+        return s;
+}
+
+
+/**
+ * create LedSetup from XML file using a binary cache. If the cache is valid,
+ * the XML file isn't parsed at all. Otherwise the setup is loaded from the
+ * XML file and the cache is (re-)generated.
+ *
+ * @param p LedPrefs context
+ * @param source full path of XML file
+ * @param filename full path of cache file
+ * @result newly created LedSetup or NULL
+ */
+LedSetup *led_prefs_setup_from_file_cached(LedPrefs * p, const char *source,
+                                           const char *filename)
+{
+        if(!p || !source || !filename)
+                NFT_LOG_NULL(NULL);
+
+        /* hash source before parsing it, so a change while we're loading
+         * makes the cache outdated instead of wrong */
+        uint64_t hash, srcsize;
+        if(!_hash_file(source, &hash, &srcsize))
+                return NULL;
+
+        /* try cache */
+        void *map;
+        size_t size;
+        if((map = _map_file(filename, &size)))
+        {
+                LedSetup *s = _read(map, size, hash, srcsize);
+                munmap(map, size);
+
+                if(s)
+                        return s;
+        }
+
+
+        /* parse XML */
+        LedPrefsNode *n;
+        if(!(n = led_prefs_node_from_file(p, source)))
+                return NULL;
+
+        LedSetup *s = led_prefs_setup_from_node(p, n);
+        led_prefs_node_free(n);
+
+        if(!s)
+                return NULL;
+
+        /* regenerate cache */
+        if(!_write(s, hash, srcsize, filename))
+                NFT_LOG(L_WARNING, "Failed to write setup cache \"%s\"",
+                        filename);
+
+        return s;
+}
+
+
+/**
+ * @}
+ */
@@ -43,6 +43,32 @@
 
 /**
  * @file prefs_chain.c
+ *
+ * LEDs of chains with at least LED_CHAIN_PACKED_MIN_LEDS LEDs are written as
+ * packed arrays - one whitespace separated list per LED property:
+ *
+ * <chain ledcount="3" pixel_format="RGB u8"
+ *        led_x="0 1 2" led_y="0 0 0" led_component="0 1 2" led_gain="0 0 0"/>
+ *
+ * Smaller chains are written in the legacy form with one <led> child node
+ * per LED. Both forms can be read. Note that files holding packed arrays
+ * can't be read by library versions that predate this format.
+ *
+ * Regular arrangements can be described by <layout> child nodes instead that
+ * are expanded straight into the LEDs of the chain when it's loaded. Every
+ * pixel of a layout consists of one LED per entry in "components":
+ *
+ * - <layout type="grid" width="16" height="8" order="rows"/>
+ * - <layout type="serpentine" width="16" height="8" order="columns"/>
+ *   (every other row/column is reversed, "zigzag" is an alias)
+ * - <layout type="ring" count="24" radius="10" angle="90"/>
+ * - <layout type="spiral" count="64" radius="10" turns="3"/>
+ *
+ * Common properties are "x" & "y" (offset or center of layout), "gain" and
+ * "components" (whitespace separated component of each LED in a pixel, one
+ * entry per component of the chain's pixel-format, defaults to all
+ * components in order). Layouts and <led> nodes fill the chain one after
+ * another in the order they appear.
  */
 
 
@@ -51,12 +77,68 @@
  * @{
  */
 
+#include <ctype.h>
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
 #include <niftyled.h>
+#include "_chain.h"
+#include "_prefs_chain.h"
 
 
 
-#define LED_CHAIN_PROP_LEDCOUNT "ledcount"
-#define LED_CHAIN_PROP_FORMAT   "pixel_format"
+/** helper macro */
+#define MIN(a,b) (((a)<(b))?(a):(b))
+
+
+#define LED_CHAIN_PROP_LEDCOUNT  "ledcount"
+#define LED_CHAIN_PROP_FORMAT    "pixel_format"
+#define LED_CHAIN_PROP_X         "led_x"
+#define LED_CHAIN_PROP_Y         "led_y"
+#define LED_CHAIN_PROP_COMPONENT "led_component"
+#define LED_CHAIN_PROP_GAIN      "led_gain"
+
+/** chains with at least this many LEDs are written as packed arrays */
+#define LED_CHAIN_PACKED_MIN_LEDS 256
+
+#define LED_LAYOUT_PROP_TYPE       "type"
+#define LED_LAYOUT_PROP_X          "x"
+#define LED_LAYOUT_PROP_Y          "y"
+#define LED_LAYOUT_PROP_GAIN       "gain"
+#define LED_LAYOUT_PROP_COMPONENTS "components"
+#define LED_LAYOUT_PROP_WIDTH      "width"
+#define LED_LAYOUT_PROP_HEIGHT     "height"
+#define LED_LAYOUT_PROP_ORDER      "order"
+#define LED_LAYOUT_PROP_COUNT      "count"
+#define LED_LAYOUT_PROP_RADIUS     "radius"
+#define LED_LAYOUT_PROP_ANGLE      "angle"
+#define LED_LAYOUT_PROP_TURNS      "turns"
+
+/** maximum amount of LEDs per pixel of a layout */
+#define LED_LAYOUT_MAX_COMPONENTS  64
+
+
+/** LED properties that are stored as packed arrays */
+typedef enum
+{
+        PACKED_X,
+        PACKED_Y,
+        PACKED_COMPONENT,
+        PACKED_GAIN,
+} PackedField;
+
+/** names of packed arrays (must match order of PackedField) */
+static const char *_packed_names[] = {
+        LED_CHAIN_PROP_X,
+        LED_CHAIN_PROP_Y,
+        LED_CHAIN_PROP_COMPONENT,
+        LED_CHAIN_PROP_GAIN,
+};
+
+/** valid range of packed values (must match order of PackedField, gain is
+ * checked when it's set) */
+static const long _packed_min[] = { INT_MIN, INT_MIN, 0, LONG_MIN };
+static const long _packed_max[] = { INT_MAX, INT_MAX, SHRT_MAX, LONG_MAX };
 
 
 
@@ -66,6 +148,644 @@
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
+/** get one LED property from LED storage */
+static long _packed_get(LedArray * a, PackedField field, LedCount i)
+{
+        switch (field)
+        {
+                case PACKED_X:
+                        return a->x[i];
+                case PACKED_Y:
+                        return a->y[i];
+                case PACKED_COMPONENT:
+                        return a->component[i];
+                case PACKED_GAIN:
+                        return a->gain[i];
+        }
+
+        return 0;
+}
+
+
+/** set one LED property in LED storage */
+static void _packed_set(LedArray * a, PackedField field, LedCount i, long v)
+{
+        switch (field)
+        {
+                case PACKED_X:
+                {
+                        a->x[i] = (LedFrameCord) v;
+                        break;
+                }
+
+                case PACKED_Y:
+                {
+                        a->y[i] = (LedFrameCord) v;
+                        break;
+                }
+
+                case PACKED_COMPONENT:
+                {
+                        a->component[i] = (LedFrameComponent) v;
+                        break;
+                }
+
+                case PACKED_GAIN:
+                {
+                        if(v < LED_GAIN_MIN || v > LED_GAIN_MAX)
+                        {
+                                NFT_LOG(L_WARNING,
+                                        "LED %ld has invalid gain: %ld Using 0 instead.",
+                                        i, v);
+                                v = 0;
+                        }
+                        a->gain[i] = (LedGain) v;
+                        break;
+                }
+        }
+}
+
+
+/** write one LED property of all LEDs as packed array to prefs node */
+static NftResult _packed_to_node(NftPrefsNode * n, LedChain * c,
+                                 PackedField field)
+{
+        LedArray *a = _chain_get_leds(c);
+        LedCount count = led_chain_get_ledcount(c);
+
+        /* every value needs 12 characters at most (sign, digits & space) */
+        size_t size = count * 12 + 1;
+        char *buf;
+        if(!(buf = malloc(size)))
+        {
+                NFT_LOG_PERROR("malloc");
+                return NFT_FAILURE;
+        }
+
+        /* print all values */
+        char *p = buf;
+        *p = '\0';
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                p += snprintf(p, size - (p - buf), i ? " %ld" : "%ld",
+                              _packed_get(a, field, i));
+        }
+
+        NftResult r =
+                nft_prefs_node_prop_string_set(n, _packed_names[field], buf);
+
+        free(buf);
+
+        return r;
+}
+
+
+/**
+ * parse one packed array straight into LED storage
+ *
+ * @param c chain to fill
+ * @param field LED property the array holds
+ * @param string whitespace separated list of values
+ * @result NFT_SUCCESS or NFT_FAILURE if array is invalid
+ */
+static NftResult _packed_parse(LedChain * c, PackedField field,
+                               const char *string)
+{
+        LedArray *a = _chain_get_leds(c);
+        LedCount count = led_chain_get_ledcount(c);
+
+        /* parse values one by one */
+        const char *s = string;
+        LedCount i;
+        for(i = 0;; i++)
+        {
+                while(isspace((unsigned char) *s))
+                        s++;
+
+                char *end;
+                errno = 0;
+                long v = strtol(s, &end, 10);
+
+                /* no more values */
+                if(end == s)
+                        break;
+
+                if(errno == ERANGE ||
+                   v < _packed_min[field] || v > _packed_max[field])
+                {
+                        NFT_LOG(L_ERROR,
+                                "Value of LED %ld in \"%s\" property is out of range: \"%.*s\"",
+                                i, _packed_names[field], (int) (end - s), s);
+                        return NFT_FAILURE;
+                }
+
+                if(i < count)
+                        _packed_set(a, field, i, v);
+
+                s = end;
+        }
+
+        /* anything left must be whitespace */
+        while(isspace((unsigned char) *s))
+                s++;
+
+        if(*s != '\0')
+        {
+                NFT_LOG(L_ERROR, "Invalid value in \"%s\" property: \"%.16s\"",
+                        _packed_names[field], s);
+                return NFT_FAILURE;
+        }
+
+        if(i != count)
+        {
+                NFT_LOG(L_WARNING,
+                        "\"%s\" property holds %ld values but chain has %ld LEDs",
+                        _packed_names[field], i, count);
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * parse all packed arrays of a chain node straight into LED storage
+ *
+ * @param n properties of chain node
+ * @param c chain to fill
+ * @param found will be set to true if the node has packed arrays
+ * @result NFT_SUCCESS or NFT_FAILURE if an array is invalid
+ */
+static NftResult _packed_from_props(PrefsProps * n, LedChain * c, bool * found)
+{
+        /* LEDs stored as packed arrays? */
+        char *packed;
+        if(!(packed = n->get(n->node, LED_CHAIN_PROP_X)))
+        {
+                *found = false;
+                return NFT_SUCCESS;
+        }
+
+        *found = true;
+
+        PackedField field;
+        for(field = PACKED_X; field <= PACKED_GAIN; field++)
+        {
+                /* x-array is fetched already */
+                if(field != PACKED_X &&
+                   !(packed = n->get(n->node, _packed_names[field])))
+                {
+                        NFT_LOG(L_WARNING,
+                                "chain has no \"%s\" property. Using 0 as default.",
+                                _packed_names[field]);
+                        continue;
+                }
+
+                NftResult r = _packed_parse(c, field, packed);
+                n->release(packed);
+
+                if(!r)
+                        return NFT_FAILURE;
+        }
+
+        _chain_positions_changed(c);
+
+        return NFT_SUCCESS;
+}
+
+
+/** PrefsProps accessor for NftPrefsNodes */
+static char *_node_prop_get(void *node, const char *name)
+{
+        return nft_prefs_node_prop_string_get(node, name);
+}
+
+
+/** PrefsProps accessor for NftPrefsNodes */
+static void _node_prop_release(void *string)
+{
+        nft_prefs_free(string);
+}
+
+
+/** properties shared by all pixels of one layout */
+typedef struct
+{
+        /** destination chain */
+        LedChain *chain;
+        /** next LED to fill */
+        LedCount pos;
+        /** component of each LED in a pixel */
+        LedFrameComponent components[LED_LAYOUT_MAX_COMPONENTS];
+        /** amount of LEDs per pixel */
+        int n;
+        /** gain of all LEDs */
+        LedGain gain;
+} Layout;
+
+
+/** check if prefs node describes a layout */
+static bool _is_layout_node(NftPrefsNode * n)
+{
+        return (strcmp(nft_prefs_node_get_name(n), LED_CHAIN_LAYOUT_NAME) ==
+                0);
+}
+
+
+/**
+ * get integer property of layout or default
+ *
+ * @param n properties of layout node
+ * @param name name of property
+ * @param def value to use if property is missing
+ * @param v space to store value
+ * @result NFT_SUCCESS or NFT_FAILURE if property is no valid integer
+ */
+static NftResult _layout_int(PrefsProps * n, const char *name, int def,
+                             int *v)
+{
+        char *s;
+        if(!(s = n->get(n->node, name)))
+        {
+                *v = def;
+                return NFT_SUCCESS;
+        }
+
+        char *end;
+        errno = 0;
+        long r = strtol(s, &end, 10);
+
+        /* anything left must be whitespace */
+        const char *rest = end;
+        while(isspace((unsigned char) *rest))
+                rest++;
+
+        if(end == s || *rest != '\0' || errno == ERANGE ||
+           r < INT_MIN || r > INT_MAX)
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" of <%s> is no valid integer: \"%.16s\"",
+                        name, LED_CHAIN_LAYOUT_NAME, s);
+                n->release(s);
+                return NFT_FAILURE;
+        }
+
+        n->release(s);
+
+        *v = (int) r;
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get double property of layout or default
+ *
+ * @param n properties of layout node
+ * @param name name of property
+ * @param def value to use if property is missing
+ * @param v space to store value
+ * @result NFT_SUCCESS or NFT_FAILURE if property is no valid, finite number
+ */
+static NftResult _layout_double(PrefsProps * n, const char *name, double def,
+                                double *v)
+{
+        char *s;
+        if(!(s = n->get(n->node, name)))
+        {
+                *v = def;
+                return NFT_SUCCESS;
+        }
+
+        char *end;
+        errno = 0;
+        double r = strtod(s, &end);
+
+        /* anything left must be whitespace */
+        const char *rest = end;
+        while(isspace((unsigned char) *rest))
+                rest++;
+
+        if(end == s || *rest != '\0' || errno == ERANGE || !isfinite(r))
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" of <%s> is no valid number: \"%.16s\"",
+                        name, LED_CHAIN_LAYOUT_NAME, s);
+                n->release(s);
+                return NFT_FAILURE;
+        }
+
+        n->release(s);
+
+        *v = r;
+        return NFT_SUCCESS;
+}
+
+
+/** add LEDs of one pixel of a layout to the chain */
+static NftResult _layout_pixel(Layout * l, LedFrameCord x, LedFrameCord y)
+{
+        if(l->pos + l->n > led_chain_get_ledcount(l->chain))
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" exceeds \"%s\" of chain (%ld LEDs)",
+                        LED_CHAIN_LAYOUT_NAME, LED_CHAIN_PROP_LEDCOUNT,
+                        led_chain_get_ledcount(l->chain));
+                return NFT_FAILURE;
+        }
+
+        LedArray *a = _chain_get_leds(l->chain);
+        int i;
+        for(i = 0; i < l->n; i++, l->pos++)
+        {
+                a->x[l->pos] = x;
+                a->y[l->pos] = y;
+                a->component[l->pos] = l->components[i];
+                a->gain[l->pos] = l->gain;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** add LEDs of a grid or serpentine layout */
+static NftResult _layout_grid(Layout * l, PrefsProps * n,
+                              LedFrameCord x, LedFrameCord y,
+                              bool serpentine)
+{
+        int width, height;
+        if(!_layout_int(n, LED_LAYOUT_PROP_WIDTH, 0, &width) ||
+           !_layout_int(n, LED_LAYOUT_PROP_HEIGHT, 0, &height))
+                return NFT_FAILURE;
+
+        if(width <= 0 || height <= 0)
+        {
+                NFT_LOG(L_ERROR, "\"%s\" needs positive \"%s\" and \"%s\"",
+                        LED_CHAIN_LAYOUT_NAME, LED_LAYOUT_PROP_WIDTH,
+                        LED_LAYOUT_PROP_HEIGHT);
+                return NFT_FAILURE;
+        }
+
+        /* walk rows or columns first? */
+        bool columns = false;
+        char *order;
+        if((order = n->get(n->node, LED_LAYOUT_PROP_ORDER)))
+        {
+                columns = (strcmp(order, "columns") == 0);
+                n->release(order);
+        }
+
+        /* size of outer & inner loop */
+        int outer = columns ? width : height;
+        int inner = columns ? height : width;
+
+        int o, i;
+        for(o = 0; o < outer; o++)
+        {
+                for(i = 0; i < inner; i++)
+                {
+                        /* reverse every other line of serpentines */
+                        int j = (serpentine && (o & 1)) ? inner - 1 - i : i;
+
+                        if(!_layout_pixel(l,
+                                          x + (columns ? o : j),
+                                          y + (columns ? j : o)))
+                                return NFT_FAILURE;
+                }
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/** add LEDs of a ring or spiral layout (x/y is the center) */
+static NftResult _layout_round(Layout * l, PrefsProps * n,
+                               LedFrameCord x, LedFrameCord y, bool spiral)
+{
+        int count;
+        double radius;
+        if(!_layout_int(n, LED_LAYOUT_PROP_COUNT, 0, &count) ||
+           !_layout_double(n, LED_LAYOUT_PROP_RADIUS, 0, &radius))
+                return NFT_FAILURE;
+
+        if(count <= 0 || radius < 0)
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" needs positive \"%s\" and \"%s\"",
+                        LED_CHAIN_LAYOUT_NAME, LED_LAYOUT_PROP_COUNT,
+                        LED_LAYOUT_PROP_RADIUS);
+                return NFT_FAILURE;
+        }
+
+        /* angle of first pixel (degrees -> radians) */
+        double start;
+        if(!_layout_double(n, LED_LAYOUT_PROP_ANGLE, 0, &start))
+                return NFT_FAILURE;
+        start = start * M_PI / 180;
+
+        /* rings have one turn, spirals grow from the center outwards */
+        double turns = 1;
+        if(spiral && !_layout_double(n, LED_LAYOUT_PROP_TURNS, 1, &turns))
+                return NFT_FAILURE;
+
+        int i;
+        for(i = 0; i < count; i++)
+        {
+                double r = radius;
+                double angle;
+                if(spiral)
+                {
+                        double t = count > 1 ? (double) i / (count - 1) : 0;
+                        r = radius * t;
+                        angle = start + 2 * M_PI * turns * t;
+                }
+                else
+                {
+                        angle = start + 2 * M_PI * i / count;
+                }
+
+                if(!_layout_pixel(l,
+                                  x + (LedFrameCord) lround(r * cos(angle)),
+                                  y + (LedFrameCord) lround(r * sin(angle))))
+                        return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get components of one pixel of a layout
+ *
+ * @param l layout to fill
+ * @param n properties of layout node
+ * @param c chain the layout fills
+ * @result NFT_SUCCESS or NFT_FAILURE if "components" doesn't hold one valid
+ * component for every component of the chain's pixel-format
+ */
+static NftResult _layout_components(Layout * l, PrefsProps * n, LedChain * c)
+{
+        int ncomponents =
+                (int) led_pixel_format_get_n_components(led_chain_get_format(c));
+
+        if(ncomponents > LED_LAYOUT_MAX_COMPONENTS)
+        {
+                NFT_LOG(L_ERROR,
+                        "<%s> supports %d components per pixel at most, pixel-format has %d",
+                        LED_CHAIN_LAYOUT_NAME, LED_LAYOUT_MAX_COMPONENTS,
+                        ncomponents);
+                return NFT_FAILURE;
+        }
+
+        /* default: every component of pixel-format once */
+        char *components;
+        if(!(components = n->get(n->node, LED_LAYOUT_PROP_COMPONENTS)))
+        {
+                for(l->n = 0; l->n < ncomponents; l->n++)
+                        l->components[l->n] = (LedFrameComponent) l->n;
+
+                return NFT_SUCCESS;
+        }
+
+        NftResult r = NFT_FAILURE;
+        const char *s = components;
+        for(l->n = 0;; l->n++)
+        {
+                while(isspace((unsigned char) *s))
+                        s++;
+
+                char *end;
+                errno = 0;
+                long v = strtol(s, &end, 10);
+
+                /* no more values */
+                if(end == s)
+                        break;
+
+                if(l->n >= LED_LAYOUT_MAX_COMPONENTS)
+                {
+                        NFT_LOG(L_ERROR,
+                                "\"%s\" of <%s> holds more than %d components",
+                                LED_LAYOUT_PROP_COMPONENTS,
+                                LED_CHAIN_LAYOUT_NAME,
+                                LED_LAYOUT_MAX_COMPONENTS);
+                        goto _lc_end;
+                }
+
+                if(errno == ERANGE || v < 0 || v >= ncomponents)
+                {
+                        NFT_LOG(L_ERROR,
+                                "\"%s\" of <%s> holds invalid component: \"%.*s\" (pixel-format has %d components)",
+                                LED_LAYOUT_PROP_COMPONENTS,
+                                LED_CHAIN_LAYOUT_NAME, (int) (end - s), s,
+                                ncomponents);
+                        goto _lc_end;
+                }
+
+                l->components[l->n] = (LedFrameComponent) v;
+                s = end;
+        }
+
+        /* anything left must be whitespace */
+        while(isspace((unsigned char) *s))
+                s++;
+
+        if(*s != '\0')
+        {
+                NFT_LOG(L_ERROR, "Invalid value in \"%s\" of <%s>: \"%.16s\"",
+                        LED_LAYOUT_PROP_COMPONENTS, LED_CHAIN_LAYOUT_NAME, s);
+                goto _lc_end;
+        }
+
+        if(l->n != ncomponents)
+        {
+                NFT_LOG(L_ERROR,
+                        "\"%s\" of <%s> holds %d components but pixel-format has %d",
+                        LED_LAYOUT_PROP_COMPONENTS, LED_CHAIN_LAYOUT_NAME,
+                        l->n, ncomponents);
+                goto _lc_end;
+        }
+
+        r = NFT_SUCCESS;
+
+_lc_end:
+        n->release(components);
+        return r;
+}
+
+
+/**
+ * expand a layout node into the LEDs of a chain
+ *
+ * @param n properties of layout node
+ * @param c chain to fill
+ * @param pos position of first LED to fill, will be advanced past the
+ * generated LEDs
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+static NftResult _layout_from_props(PrefsProps * n, LedChain * c,
+                                    LedCount * pos)
+{
+        Layout l;
+        l.chain = c;
+        l.pos = *pos;
+
+        /* gain of all LEDs */
+        int g;
+        if(!_layout_int(n, LED_LAYOUT_PROP_GAIN, 0, &g))
+                return NFT_FAILURE;
+
+        if(g < LED_GAIN_MIN || g > LED_GAIN_MAX)
+        {
+                NFT_LOG(L_WARNING,
+                        "<%s> has invalid gain: %d Using 0 instead.",
+                        LED_CHAIN_LAYOUT_NAME, g);
+                g = 0;
+        }
+        l.gain = (LedGain) g;
+
+        /* components of one pixel */
+        if(!_layout_components(&l, n, c))
+                return NFT_FAILURE;
+
+        /* offset */
+        int x, y;
+        if(!_layout_int(n, LED_LAYOUT_PROP_X, 0, &x) ||
+           !_layout_int(n, LED_LAYOUT_PROP_Y, 0, &y))
+                return NFT_FAILURE;
+
+        /* type of layout */
+        char *type;
+        if(!(type = n->get(n->node, LED_LAYOUT_PROP_TYPE)))
+        {
+                NFT_LOG(L_ERROR, "<%s> has no \"%s\"",
+                        LED_CHAIN_LAYOUT_NAME, LED_LAYOUT_PROP_TYPE);
+                return NFT_FAILURE;
+        }
+
+        NftResult r;
+        if(strcmp(type, "grid") == 0)
+                r = _layout_grid(&l, n, x, y, false);
+        else if(strcmp(type, "serpentine") == 0 || strcmp(type, "zigzag") == 0)
+                r = _layout_grid(&l, n, x, y, true);
+        else if(strcmp(type, "ring") == 0)
+                r = _layout_round(&l, n, x, y, false);
+        else if(strcmp(type, "spiral") == 0)
+                r = _layout_round(&l, n, x, y, true);
+        else
+        {
+                NFT_LOG(L_ERROR, "Unknown <%s> type: \"%s\"",
+                        LED_CHAIN_LAYOUT_NAME, type);
+                r = NFT_FAILURE;
+        }
+
+        n->release(type);
+
+        *pos = l.pos;
+
+        return r;
+}
+
+
 /**
  * Object-to-Config function. 
  * Creates a config-node (and subnodes) from a LedHardware model
@@ -99,6 +819,19 @@ static NftResult _prefs_from_chain(NftPrefs * p, NftPrefsNode * n, void *obj,
                 return NFT_FAILURE;
 
 
+        /* add all LEDs of large chains as packed arrays */
+        if(led_chain_get_ledcount(c) >= LED_CHAIN_PACKED_MIN_LEDS)
+        {
+                PackedField field;
+                for(field = PACKED_X; field <= PACKED_GAIN; field++)
+                {
+                        if(!_packed_to_node(n, c, field))
+                                return NFT_FAILURE;
+                }
+
+                return NFT_SUCCESS;
+        }
+
         /* add all LEDs in this chain */
         LedCount i;
         for(i = 0; i < led_chain_get_ledcount(c); i++)
@@ -185,18 +918,45 @@ static NftResult _prefs_to_chain(LedPrefs * p, void **newObj,
         /* free string */
         nft_prefs_free(format);
 
-        /* process child nodes (LEDs) */
+        /* LEDs stored as packed arrays? */
+        PrefsProps props = { _node_prop_get, _node_prop_release, n };
+        bool packed;
+        if(!_packed_from_props(&props, c, &packed))
+                goto _ptc_error;
+
+        if(packed)
+        {
+                /* save new chain-object to "newObj" pointer */
+                *newObj = c;
+
+                return NFT_SUCCESS;
+        }
+
+        /* process child nodes (one node per LED or layouts) */
         NftPrefsNode *child;
         LedCount i = 0;
         for(child = nft_prefs_node_get_first_child(n);
             child; child = nft_prefs_node_get_next(child))
         {
+                /* expand layout */
+                if(_is_layout_node(child))
+                {
+                        PrefsProps layout =
+                                { _node_prop_get, _node_prop_release, child };
+                        if(!_layout_from_props(&layout, c, &i))
+                                goto _ptc_error;
+
+                        _chain_positions_changed(c);
+                        continue;
+                }
+
                 /* check if node describes a Led object */
                 if(!led_prefs_is_led_node(child))
                 {
                         NFT_LOG(L_ERROR,
-                                "\"chain\" may only contain \"%s\" children. Skipping \"%s\".",
-                                LED_LED_NAME, nft_prefs_node_get_name(child));
+                                "\"chain\" may only contain \"%s\" or \"%s\" children. Skipping \"%s\".",
+                                LED_LED_NAME, LED_CHAIN_LAYOUT_NAME,
+                                nft_prefs_node_get_name(child));
                         continue;
                 }
 
@@ -228,6 +988,48 @@ _ptc_error:
 /******************************************************************************/
 
 
+/**
+ * fill LEDs of a chain from the packed arrays of a chain node
+ *
+ * @param c chain to fill
+ * @param p properties of chain node
+ * @param found will be set to true if the node has packed arrays
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _prefs_chain_packed_from_props(LedChain * c, PrefsProps * p,
+                                         bool * found)
+{
+        if(!c || !p || !found)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        return _packed_from_props(p, c, found);
+}
+
+
+/**
+ * expand a layout node into the LEDs of a chain
+ *
+ * @param c chain to fill
+ * @param p properties of layout node
+ * @param pos position of first LED to fill, will be advanced past the
+ * generated LEDs
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _prefs_chain_layout_from_props(LedChain * c, PrefsProps * p,
+                                         LedCount * pos)
+{
+        if(!c || !p || !pos)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(!_layout_from_props(p, c, pos))
+                return NFT_FAILURE;
+
+        _chain_positions_changed(c);
+
+        return NFT_SUCCESS;
+}
+
+
 /**
  * register "chain" prefs class (called once for initialization)
  */
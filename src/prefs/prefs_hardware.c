@@ -55,6 +55,7 @@
 #include "niftyled-prefs_hardware.h"
 #include "niftyled-prefs_chain.h"
 #include "niftyled-prefs_tile.h"
+#include "_prefs_hardware.h"
 
 
 
@@ -394,7 +395,9 @@ static NftResult _prefs_to_hardware(LedPrefs * p, void **newObj,
                                 goto _pth_end;
                         }
 
-                        if(!led_hardware_init
+                        /* hardware is initialized after all hardware of
+                         * the setup has been created */
+                        if(!led_hardware_init_deferred
                            (h, id, led_chain_get_ledcount(c),
                             led_pixel_format_to_string(led_chain_get_format
                                                        (c))))
@@ -457,86 +460,8 @@ static NftResult _prefs_to_hardware(LedPrefs * p, void **newObj,
                         }
 
 
-                        /* decide about type */
-                        switch (led_hardware_plugin_prop_type_from_string
-                                (type))
-                        {
-                                /* int */
-                                case LED_HW_CUSTOM_PROP_INT:
-                                {
-                                        long int parsed_int = strtol(value, NULL, 10);
-                                        if(parsed_int == LONG_MAX ||
-                                           parsed_int == LONG_MIN ||
-                                           parsed_int < INT_MIN ||
-                                           parsed_int > INT_MAX)
-                                        {
-                                                NFT_LOG(L_ERROR, "int-type property \"%s\" out of range.", LED_HARDWARE_PROPERTY_PROP_VALUE);
-                                                goto _pthp_end;
-                                        }
-
-                                        int integer = (int) parsed_int;
-
-                                        if(!led_hardware_plugin_prop_set_int
-                                           (h, name, integer))
-                                        {
-                                                NFT_LOG(L_ERROR,
-                                                        "Failed to set \"%s\" = %d)",
-                                                        name, integer);
-                                                goto _pthp_end;
-                                        }
-                                        break;
-                                }
-
-                                        /* float */
-                                case LED_HW_CUSTOM_PROP_FLOAT:
-                                {
-                                        char *endptr = NULL;
-                                        double parsed_val = strtod(value, &endptr);
-                                        if(endptr == value)
-                                        {
-                                                NFT_LOG(L_ERROR,
-                                                        "Failed to parse float from \"%s\" property (\"%s\")",
-                                                        LED_HARDWARE_PROPERTY_PROP_VALUE,
-                                                        value);
-                                                goto _pthp_end;
-                                        }
-
-                                        float f = (float) parsed_val;
-
-
-                                        if(!led_hardware_plugin_prop_set_float
-                                           (h, name, f))
-                                        {
-                                                NFT_LOG(L_ERROR,
-                                                        "Failed to set \"%s\" = %f)",
-                                                        name, f);
-                                                goto _pthp_end;
-                                        }
-                                        break;
-                                }
-
-                                        /* string */
-                                case LED_HW_CUSTOM_PROP_STRING:
-                                {
-                                        if(!led_hardware_plugin_prop_set_string(h, name, value))
-                                        {
-                                                NFT_LOG(L_ERROR,
-                                                        "Failed to set \"%s\" = \"%s\")",
-                                                        name, value);
-                                                goto _pthp_end;
-                                        }
-                                        break;
-                                }
-
-                                        /* huh? */
-                                default:
-                                {
-                                        NFT_LOG(L_ERROR,
-                                                "Invalid plugin property type: \"%s\"",
-                                                type);
-                                        break;
-                                }
-                        }
+                        /* set property */
+                        _prefs_hardware_prop_set(h, name, type, value);
 
 _pthp_end:
                         nft_prefs_free(name);
@@ -574,6 +499,105 @@ _pth_end:
 /************************ "private" API FUNCTIONS *****************************/
 /******************************************************************************/
 
+/**
+ * set plugin-property of hardware from its string representation
+ *
+ * @param h LedHardware
+ * @param name name of property
+ * @param type type of property ("int", "float" or "string")
+ * @param value value of property
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _prefs_hardware_prop_set(LedHardware * h, const char *name,
+                                   const char *type, const char *value)
+{
+        if(!h || !name || !type || !value)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* decide about type */
+        switch (led_hardware_plugin_prop_type_from_string(type))
+        {
+                /* int */
+                case LED_HW_CUSTOM_PROP_INT:
+                {
+                        long int parsed_int = strtol(value, NULL, 10);
+                        if(parsed_int == LONG_MAX ||
+                           parsed_int == LONG_MIN ||
+                           parsed_int < INT_MIN ||
+                           parsed_int > INT_MAX)
+                        {
+                                NFT_LOG(L_ERROR, "int-type property \"%s\" out of range.", LED_HARDWARE_PROPERTY_PROP_VALUE);
+                                return NFT_FAILURE;
+                        }
+
+                        int integer = (int) parsed_int;
+
+                        if(!led_hardware_plugin_prop_set_int
+                           (h, name, integer))
+                        {
+                                NFT_LOG(L_ERROR,
+                                        "Failed to set \"%s\" = %d)",
+                                        name, integer);
+                                return NFT_FAILURE;
+                        }
+                        break;
+                }
+
+                        /* float */
+                case LED_HW_CUSTOM_PROP_FLOAT:
+                {
+                        char *endptr = NULL;
+                        double parsed_val = strtod(value, &endptr);
+                        if(endptr == value)
+                        {
+                                NFT_LOG(L_ERROR,
+                                        "Failed to parse float from \"%s\" property (\"%s\")",
+                                        LED_HARDWARE_PROPERTY_PROP_VALUE,
+                                        value);
+                                return NFT_FAILURE;
+                        }
+
+                        float f = (float) parsed_val;
+
+
+                        if(!led_hardware_plugin_prop_set_float
+                           (h, name, f))
+                        {
+                                NFT_LOG(L_ERROR,
+                                        "Failed to set \"%s\" = %f)",
+                                        name, f);
+                                return NFT_FAILURE;
+                        }
+                        break;
+                }
+
+                        /* string */
+                case LED_HW_CUSTOM_PROP_STRING:
+                {
+                        if(!led_hardware_plugin_prop_set_string(h, name, value))
+                        {
+                                NFT_LOG(L_ERROR,
+                                        "Failed to set \"%s\" = \"%s\")",
+                                        name, value);
+                                return NFT_FAILURE;
+                        }
+                        break;
+                }
+
+                        /* huh? */
+                default:
+                {
+                        NFT_LOG(L_ERROR,
+                                "Invalid plugin property type: \"%s\"",
+                                type);
+                        return NFT_FAILURE;
+                }
+        }
+
+        return NFT_SUCCESS;
+}
+
+
 /**
  * register "hardware" prefs class (called once for initialization)
  */
@@ -627,7 +651,16 @@ LedHardware *led_prefs_hardware_from_node(LedPrefs * p, LedPrefsNode * n)
                 return NULL;
         }
 
-        return nft_prefs_obj_from_node(p, n, NULL);
+        LedHardware *h;
+        if(!(h = nft_prefs_obj_from_node(p, n, NULL)))
+                return NULL;
+
+        /* initialize hardware */
+        if(!led_hardware_list_init_deferred(h, 1))
+                NFT_LOG(L_WARNING, "Failed to initialize hardware \"%s\"",
+                        led_hardware_get_name(h));
+
+        return h;
 }
 
 
@@ -53,6 +53,7 @@
 
 #include "niftyled-prefs_setup.h"
 #include "niftyled-prefs_hardware.h"
+#include "_setup.h"
 
 
 
@@ -167,6 +168,11 @@ static NftResult _prefs_to_setup(LedPrefs * p, void **newObj,
                 }
         }
 
+        /* initialize all hardware concurrently */
+        if(led_setup_get_hardware(s) &&
+           !led_hardware_list_init_deferred(led_setup_get_hardware(s), 0))
+                NFT_LOG(L_WARNING, "Failed to initialize all hardware");
+
         /* save new setup-object to "newObj" pointer */
         *newObj = s;
 
@@ -224,6 +230,57 @@ LedSetup *led_prefs_setup_from_node(LedPrefs * p, LedPrefsNode * n)
 }
 
 
+/**
+ * generate LedSetup from LedPrefsNode and allocate all of its hardware, tiles
+ * and chains from one arena owned by the setup. This is much faster for large
+ * setups and led_setup_destroy() releases the memory at once.
+ *
+ * @param p LedPrefs context
+ * @param n LedPrefsNode 
+ * @result newly created LedSetup
+ * @note objects of this setup must not be used after led_setup_destroy()
+ * (e.g. by removing a LedHardware from the setup before destroying it)
+ */
+LedSetup *led_prefs_setup_from_node_arena(LedPrefs * p, LedPrefsNode * n)
+{
+        if(!p || !n)
+                NFT_LOG_NULL(NULL);
+
+        /* check if node is of expected class */
+        if(strcmp(nft_prefs_node_get_name(n), LED_SETUP_NAME) != 0)
+        {
+                NFT_LOG(L_ERROR,
+                        "got wrong LedPrefsNode class. Expected \"%s\" but got \"%s\"",
+                        LED_SETUP_NAME, nft_prefs_node_get_name(n));
+                return NULL;
+        }
+
+        /* new arena */
+        Arena *a;
+        if(!(a = _arena_new(0)))
+                return NULL;
+
+        /* allocate all objects from arena while parsing */
+        Arena *prev = _arena_set_current(a);
+        LedSetup *s = nft_prefs_obj_from_node(p, n, NULL);
+        _arena_set_current(prev);
+
+        if(!s)
+        {
+                _arena_destroy(a);
+                return NULL;
+        }
+
+        NFT_LOG(L_DEBUG, "Setup allocated %lu bytes from arena",
+                (unsigned long) _arena_get_size(a));
+
+        /* setup owns arena from now on */
+        _setup_set_arena(s, a);
+
+        return s;
+}
+
+
 /**
  * generate LedPrefsNode from LedSetup object
  *
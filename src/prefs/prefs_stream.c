@@ -0,0 +1,720 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file prefs_stream.c
+ *
+ * streaming setup loader
+ *
+ * Builds a LedSetup while the XML file is read by a libxml2 text-reader,
+ * so only the element that is currently processed is held in memory instead
+ * of the whole document tree. Hardware, tiles & chains are created as soon as
+ * their start element is seen. LEDs of a hardware chain are skipped
+ * completely since only ledcount and pixel-format are needed to initialize
+ * the hardware.
+ */
+
+
+#include <math.h>
+#include <errno.h>
+#include <limits.h>
+#include <libxml/xmlreader.h>
+#include <niftyled.h>
+#include "_prefs_chain.h"
+#include "_prefs_hardware.h"
+
+
+
+/** libxml2 options for our reader */
+#define LED_STREAM_XML_OPTIONS  (XML_PARSE_NONET | XML_PARSE_NOBLANKS | \
+                                 XML_PARSE_COMPACT | XML_PARSE_HUGE)
+
+
+#define LED_STREAM_CHAIN_DEFAULT_FORMAT  "RGB u8"
+
+
+
+/** state of one streaming parser run */
+typedef struct
+{
+        /** libxml2 text-reader */
+        xmlTextReaderPtr reader;
+        /** filename (for log messages) */
+        const char *filename;
+        /** an attribute had an invalid value, loading fails */
+        bool invalid;
+} Stream;
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** PrefsProps accessor for attributes of the current reader element */
+static char *_attr_get(void *node, const char *name)
+{
+        return (char *) xmlTextReaderGetAttribute(node, (const xmlChar *) name);
+}
+
+
+/** PrefsProps accessor for attributes of the current reader element */
+static void _attr_release(void *string)
+{
+        xmlFree(string);
+}
+
+
+/**
+ * get integer attribute of current element
+ *
+ * @param s current stream
+ * @param name name of attribute
+ * @param min smallest valid value
+ * @param max largest valid value
+ * @param v space to store value
+ * @result 1 if value was parsed, 0 if attribute is missing, -1 if it's not
+ * an integer between min and max (loading will fail)
+ */
+static int _attr_long(Stream * s, const char *name, long min, long max,
+                      long *v)
+{
+        char *a;
+        if(!(a = _attr_get(s->reader, name)))
+                return 0;
+
+        char *end;
+        errno = 0;
+        long r = strtol(a, &end, 10);
+        bool valid = (errno == 0 && end != a && *end == '\0' &&
+                      r >= min && r <= max);
+
+        if(!valid)
+        {
+                NFT_LOG(L_ERROR, "%s:%d: invalid value \"%s\" for \"%s\" "
+                        "(expected integer between %ld and %ld)",
+                        s->filename,
+                        xmlTextReaderGetParserLineNumber(s->reader), a, name,
+                        min, max);
+                s->invalid = true;
+        }
+
+        xmlFree(a);
+
+        if(!valid)
+                return -1;
+
+        *v = r;
+        return 1;
+}
+
+
+/** get integer attribute of current element or warn and use default */
+static int _attr_int_default(Stream * s, const char *element,
+                             const char *name, int def)
+{
+        long v;
+        int r;
+        if((r = _attr_long(s, name, INT_MIN, INT_MAX, &v)) == 0)
+        {
+                NFT_LOG(L_WARNING,
+                        "\"%s\" has no \"%s\" prop. Using %d as default.",
+                        element, name, def);
+        }
+
+        return r == 1 ? (int) v : def;
+}
+
+
+/** get floating point attribute of current element or warn and use default */
+static double _attr_double_default(Stream * s, const char *element,
+                                   const char *name, double def)
+{
+        char *a;
+        if(!(a = _attr_get(s->reader, name)))
+        {
+                NFT_LOG(L_WARNING,
+                        "\"%s\" has no \"%s\" prop. Using %f as default.",
+                        element, name, def);
+                return def;
+        }
+
+        double v = strtod(a, NULL);
+        xmlFree(a);
+
+        return v;
+}
+
+
+/** name of current element */
+static const char *_name(Stream * s)
+{
+        return (const char *) xmlTextReaderConstName(s->reader);
+}
+
+
+/** log a parser error including the current position */
+static void _error(Stream * s, const char *msg)
+{
+        NFT_LOG(L_ERROR, "%s:%d: %s", s->filename,
+                xmlTextReaderGetParserLineNumber(s->reader), msg);
+}
+
+
+/**
+ * advance to the next child element of the element at depth
+ *
+ * Descendants of children that weren't processed by the caller are skipped.
+ *
+ * @param s current stream
+ * @param depth depth of parent element
+ * @result 1 if reader is positioned at a child element, 0 if end of parent
+ * element was reached, -1 on error
+ */
+static int _next_child(Stream * s, int depth)
+{
+        int r;
+        while((r = xmlTextReaderRead(s->reader)) == 1)
+        {
+                int type = xmlTextReaderNodeType(s->reader);
+                int d = xmlTextReaderDepth(s->reader);
+
+                /* end of parent? */
+                if(type == XML_READER_TYPE_END_ELEMENT && d == depth)
+                        return 0;
+
+                /* direct child */
+                if(type == XML_READER_TYPE_ELEMENT && d == depth + 1)
+                        return 1;
+        }
+
+        _error(s, r == 0 ? "unexpected end of document" : "parser error");
+        return -1;
+}
+
+
+/** fill one LED of a chain from a <led> element */
+static NftResult _led(Stream * s, LedChain * c, LedCount i)
+{
+        Led *l;
+        if(!(l = led_chain_get_nth(c, i)))
+        {
+                _error(s, "chain has more \"led\" elements than \"ledcount\"");
+                return NFT_FAILURE;
+        }
+
+        int x = _attr_int_default(s, LED_LED_NAME, "x", 0);
+        int y = _attr_int_default(s, LED_LED_NAME, "y", 0);
+        if(!led_set_pos(l, x, y))
+                return NFT_FAILURE;
+
+        int g = _attr_int_default(s, LED_LED_NAME, "gain", 0);
+        if(g < LED_GAIN_MIN || g > LED_GAIN_MAX)
+        {
+                NFT_LOG(L_WARNING,
+                        "<led> config has invalid gain: %d Using 0 instead.",
+                        g);
+                g = 0;
+        }
+        led_set_gain(l, (LedGain) g);
+
+        led_set_component(l, (LedFrameComponent)
+                          _attr_int_default(s, LED_LED_NAME, "component", 0));
+
+        return NFT_SUCCESS;
+}
+
+
+/** create chain from current <chain> element */
+static LedChain *_chain(Stream * s)
+{
+        int depth = xmlTextReaderDepth(s->reader);
+        bool empty = xmlTextReaderIsEmptyElement(s->reader);
+
+        int ledcount =
+                _attr_int_default(s, LED_CHAIN_NAME, "ledcount", 0);
+
+        /* create chain */
+        LedChain *c;
+        char *format;
+        if(!(format = _attr_get(s->reader, "pixel_format")))
+        {
+                NFT_LOG(L_WARNING,
+                        "chain has no \"pixel_format\" property. Using \"%s\" as default.",
+                        LED_STREAM_CHAIN_DEFAULT_FORMAT);
+                c = led_chain_new(ledcount, LED_STREAM_CHAIN_DEFAULT_FORMAT);
+        }
+        else
+        {
+                c = led_chain_new(ledcount, format);
+                xmlFree(format);
+        }
+
+        if(!c)
+        {
+                _error(s, "Failed to create new LedChain object");
+                return NULL;
+        }
+
+        /* LEDs stored as packed arrays? */
+        PrefsProps props = { _attr_get, _attr_release, s->reader };
+        bool packed;
+        if(!_prefs_chain_packed_from_props(c, &props, &packed))
+                goto _c_error;
+
+        if(empty)
+                return c;
+
+        /* process child elements (skipped if we got packed arrays) */
+        LedCount i = 0;
+        int r;
+        while((r = _next_child(s, depth)) == 1)
+        {
+                if(packed)
+                        continue;
+
+                const char *name = _name(s);
+
+                /* expand layout */
+                if(strcmp(name, LED_CHAIN_LAYOUT_NAME) == 0)
+                {
+                        if(!_prefs_chain_layout_from_props(c, &props, &i))
+                                goto _c_error;
+                }
+                /* single LED */
+                else if(strcmp(name, LED_LED_NAME) == 0)
+                {
+                        if(!_led(s, c, i++))
+                                goto _c_error;
+                }
+                else
+                {
+                        NFT_LOG(L_ERROR,
+                                "\"chain\" may only contain \"%s\" or \"%s\" children. Skipping \"%s\".",
+                                LED_LED_NAME, LED_CHAIN_LAYOUT_NAME, name);
+                }
+        }
+
+        if(r < 0)
+                goto _c_error;
+
+        return c;
+
+_c_error:
+        led_chain_destroy(c);
+        return NULL;
+}
+
+
+/** create tile (including children) from current <tile> element */
+static LedTile *_tile(Stream * s)
+{
+        int depth = xmlTextReaderDepth(s->reader);
+        bool empty = xmlTextReaderIsEmptyElement(s->reader);
+
+        /* create new tile */
+        LedTile *t;
+        if(!(t = led_tile_new()))
+                return NULL;
+
+        LedFrameCord x = _attr_int_default(s, LED_TILE_NAME, "x", 0);
+        LedFrameCord y = _attr_int_default(s, LED_TILE_NAME, "y", 0);
+        double rot_x = _attr_double_default(s, LED_TILE_NAME, "pivot_x", 0);
+        double rot_y = _attr_double_default(s, LED_TILE_NAME, "pivot_y", 0);
+        double rotation =
+                _attr_double_default(s, LED_TILE_NAME, "rotation", 0);
+
+        led_tile_set_pos(t, x, y);
+        led_tile_set_pivot(t, rot_x, rot_y);
+        /* convert degrees to radians */
+        led_tile_set_rotation(t, (rotation * M_PI) / 180);
+
+        if(empty)
+                return t;
+
+        /* process child elements */
+        int r;
+        while((r = _next_child(s, depth)) == 1)
+        {
+                const char *name = _name(s);
+
+                /* chain of this tile */
+                if(strcmp(name, LED_CHAIN_NAME) == 0)
+                {
+                        /* only one chain for every tile */
+                        if(led_tile_get_chain(t))
+                        {
+                                NFT_LOG(L_WARNING,
+                                        "preferences contain more than one \"chain\" for \"tile\" node (only one allowed -> ignoring node)");
+                                continue;
+                        }
+
+                        LedChain *c;
+                        if(!(c = _chain(s)))
+                                goto _t_error;
+
+                        if(!led_tile_set_chain(t, c))
+                        {
+                                _error(s,
+                                       "Failed to add \"chain\" to \"tile\". Aborting.");
+                                led_chain_destroy(c);
+                                goto _t_error;
+                        }
+                }
+                /* child tile */
+                else if(strcmp(name, LED_TILE_NAME) == 0)
+                {
+                        LedTile *child;
+                        if(!(child = _tile(s)))
+                                goto _t_error;
+
+                        if(!led_tile_list_append_child(t, child))
+                        {
+                                _error(s,
+                                       "Failed to add \"tile\" to \"tile\". Aborting.");
+                                led_tile_destroy(child);
+                                goto _t_error;
+                        }
+                }
+                else
+                {
+                        NFT_LOG(L_WARNING,
+                                "Attempt to add \"%s\" node to tile. Only \"chain\" and \"tile\" allowed. (Ignoring node)",
+                                name);
+                }
+        }
+
+        if(r < 0)
+                goto _t_error;
+
+        return t;
+
+_t_error:
+        led_tile_destroy(t);
+        return NULL;
+}
+
+
+/** set plugin-property from current <plugin-property> element */
+static void _hardware_prop(Stream * s, LedHardware * h)
+{
+        char *name = _attr_get(s->reader, "name");
+        char *type = _attr_get(s->reader, "type");
+        char *value = _attr_get(s->reader, "value");
+
+        if(!name || !type || !value)
+                _error(s, "\"" LED_HARDWARE_PROPERTY_NAME
+                       "\" needs \"name\", \"type\" and \"value\"");
+        else
+                _prefs_hardware_prop_set(h, name, type, value);
+
+        xmlFree(name);
+        xmlFree(type);
+        xmlFree(value);
+}
+
+
+/**
+ * remember initialization parameters of hardware from current <chain>
+ * element
+ *
+ * Only ledcount & pixel-format are needed. The LEDs of this chain are never
+ * looked at.
+ */
+static void _hardware_chain(Stream * s, LedHardware * h, const char *id)
+{
+        int ledcount = _attr_int_default(s, LED_CHAIN_NAME, "ledcount", 0);
+
+        char *format;
+        if(!(format = _attr_get(s->reader, "pixel_format")))
+        {
+                NFT_LOG(L_WARNING,
+                        "chain has no \"pixel_format\" property. Using \"%s\" as default.",
+                        LED_STREAM_CHAIN_DEFAULT_FORMAT);
+        }
+
+        /* hardware is initialized after all hardware has been created */
+        if(!led_hardware_init_deferred(h, id, ledcount,
+                                       format ? format :
+                                       LED_STREAM_CHAIN_DEFAULT_FORMAT))
+        {
+                NFT_LOG(L_WARNING, "Failed to initialize hardware \"%s\"",
+                        led_hardware_get_name(h));
+        }
+
+        xmlFree(format);
+}
+
+
+/** create hardware (including tiles) from current <hardware> element */
+static LedHardware *_hardware(Stream * s)
+{
+        int depth = xmlTextReaderDepth(s->reader);
+        bool empty = xmlTextReaderIsEmptyElement(s->reader);
+
+        LedHardware *h = NULL;
+        char *name = _attr_get(s->reader, "name");
+        char *plugin = _attr_get(s->reader, "plugin");
+        char *id = _attr_get(s->reader, "id");
+
+        if(!name || !plugin || !id)
+        {
+                _error(s, "\"hardware\" needs \"name\", \"plugin\" and \"id\"");
+                goto _h_end;
+        }
+
+        long stride = 0;
+        switch (_attr_long(s, "stride", 0, LONG_MAX, &stride))
+        {
+                case 0:
+                        NFT_LOG(L_WARNING,
+                                "\"hardware\" has no \"stride\". Using 0 as default.");
+                        break;
+                case -1:
+                        goto _h_end;
+        }
+
+        /* create new hardware object */
+        if(!(h = led_hardware_new(name, plugin)))
+        {
+                NFT_LOG(L_ERROR,
+                        "Failed to initialize \"%s\" from \"%s\" plugin.",
+                        name, plugin);
+                goto _h_end;
+        }
+
+        if(!led_hardware_set_stride(h, stride))
+        {
+                NFT_LOG(L_ERROR,
+                        "Failed to set stride (%ld) of hardware \"%s\"",
+                        stride, name);
+                goto _h_error;
+        }
+
+        if(!led_hardware_set_id(h, id))
+        {
+                NFT_LOG(L_ERROR, "Failed to set ID \"%s\" of hardware \"%s\"",
+                        id, name);
+                goto _h_error;
+        }
+
+        if(empty)
+                goto _h_end;
+
+        /* process child elements */
+        int r;
+        while((r = _next_child(s, depth)) == 1)
+        {
+                const char *child = _name(s);
+
+                if(strcmp(child, LED_TILE_NAME) == 0)
+                {
+                        LedTile *t;
+                        if(!(t = _tile(s)))
+                                goto _h_error;
+
+                        if(!led_hardware_append_tile(h, t))
+                        {
+                                NFT_LOG(L_ERROR,
+                                        "Failed to add \"tile\" to \"%s\". Aborting.",
+                                        name);
+                                led_tile_destroy(t);
+                                goto _h_error;
+                        }
+                }
+                else if(strcmp(child, LED_CHAIN_NAME) == 0)
+                {
+                        _hardware_chain(s, h, id);
+                }
+                else if(strcmp(child, LED_HARDWARE_PROPERTY_NAME) == 0)
+                {
+                        _hardware_prop(s, h);
+                }
+                else
+                {
+                        NFT_LOG(L_WARNING,
+                                "Attempt to add \"%s\" node to hardware. Not allowed. (Ignoring node)",
+                                child);
+                }
+        }
+
+        if(r == 0)
+                goto _h_end;
+
+_h_error:
+        led_hardware_destroy(h);
+        h = NULL;
+
+_h_end:
+        xmlFree(name);
+        xmlFree(plugin);
+        xmlFree(id);
+
+        return h;
+}
+
+
+/** create setup from current (root) element */
+static LedSetup *_setup(Stream * s)
+{
+        if(strcmp(_name(s), LED_SETUP_NAME) != 0)
+        {
+                NFT_LOG(L_ERROR,
+                        "%s: root element is \"%s\" but \"%s\" was expected",
+                        s->filename, _name(s), LED_SETUP_NAME);
+                return NULL;
+        }
+
+        LedSetup *setup;
+        if(!(setup = led_setup_new()))
+        {
+                NFT_LOG(L_ERROR, "Failed to create new LedSetup object");
+                return NULL;
+        }
+
+        if(xmlTextReaderIsEmptyElement(s->reader))
+                return setup;
+
+        /* every child is a hardware */
+        int depth = xmlTextReaderDepth(s->reader);
+        int r;
+        while((r = _next_child(s, depth)) == 1)
+        {
+                if(strcmp(_name(s), LED_HARDWARE_NAME) != 0)
+                {
+                        NFT_LOG(L_ERROR,
+                                "\"%s\" object may only contain \"%s\" children but got \"%s\"",
+                                LED_SETUP_NAME, LED_HARDWARE_NAME, _name(s));
+                        goto _s_error;
+                }
+
+                LedHardware *h;
+                if(!(h = _hardware(s)))
+                        goto _s_error;
+
+                /* register first hardware */
+                if(!led_setup_get_hardware(setup))
+                {
+                        led_setup_set_hardware(setup, h);
+                }
+                /* attach hardware to list */
+                else if(!led_hardware_list_append_head
+                        (led_setup_get_hardware(setup), h))
+                {
+                        NFT_LOG(L_ERROR,
+                                "Failed to append LedHardware as sibling");
+                        led_hardware_destroy(h);
+                        goto _s_error;
+                }
+        }
+
+        if(r < 0)
+                goto _s_error;
+
+        /* initialize all hardware concurrently */
+        if(led_setup_get_hardware(setup) &&
+           !led_hardware_list_init_deferred(led_setup_get_hardware(setup), 0))
+                NFT_LOG(L_WARNING, "Failed to initialize all hardware");
+
+        return setup;
+
+_s_error:
+        led_setup_destroy(setup);
+        return NULL;
+}
+
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+
+/**
+ * create LedSetup from an XML file without building a document tree
+ *
+ * In contrast to led_prefs_node_from_file() + led_prefs_setup_from_node()
+ * the file is parsed as a stream and objects are created while it's read,
+ * so peak memory usage stays close to the size of the resulting LedSetup.
+ *
+ * @param filename full path of XML file
+ * @result newly created LedSetup or NULL upon error
+ */
+LedSetup *led_prefs_setup_from_file_stream(const char *filename)
+{
+        if(!filename)
+                NFT_LOG_NULL(NULL);
+
+        Stream s;
+        s.filename = filename;
+        s.invalid = false;
+
+        if(!(s.reader =
+             xmlReaderForFile(filename, NULL, LED_STREAM_XML_OPTIONS)))
+        {
+                NFT_LOG(L_ERROR, "Failed to open \"%s\"", filename);
+                return NULL;
+        }
+
+        /* advance to root element */
+        LedSetup *setup = NULL;
+        int r;
+        while((r = xmlTextReaderRead(s.reader)) == 1 &&
+              xmlTextReaderNodeType(s.reader) != XML_READER_TYPE_ELEMENT);
+
+        if(r != 1)
+                _error(&s, "no root element found");
+        else
+                setup = _setup(&s);
+
+        xmlFreeTextReader(s.reader);
+
+        /* don't return a setup built from invalid values */
+        if(setup && s.invalid)
+        {
+                led_setup_destroy(setup);
+                return NULL;
+        }
+
+        return setup;
+}
@@ -44,6 +44,12 @@
 #ifndef _LED__SETUP_H
 #define _LED__SETUP_H
 
+#include "niftyled-setup.h"
+#include "_arena.h"
+
+
+void                            _setup_set_arena(LedSetup * s, Arena * a);
+void                            _setup_invalidate(LedSetup * s);
 
 
 
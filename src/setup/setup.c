@@ -53,6 +53,8 @@
 
 #include "niftyled-setup.h"
 #include "_hardware.h"
+#include "_setup.h"
+#include "_relation.h"
 
 
 /** helper macro */
@@ -69,6 +71,16 @@ struct _LedSetup
 {
             /** first hardware in setup or NULL */
         LedHardware *firstHw;
+            /** arena all objects of this setup were allocated from or NULL */
+        Arena *arena;
+            /** cached result of led_setup_get_dim() (valid if flag is set
+                and no relation changed since it was calculated) */
+        struct
+        {
+                LedFrameCord width, height;
+                bool valid;
+                unsigned long generation;
+        } dim;
 };
 
 
@@ -80,11 +92,112 @@ struct _LedSetup
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
+/** qsort() helper to order spans by row, then by column */
+static int _span_compare(const void *a, const void *b)
+{
+        const LedFrameSpan *sa = a;
+        const LedFrameSpan *sb = b;
+
+        if(sa->y != sb->y)
+                return (sa->y < sb->y) ? -1 : 1;
+
+        if(sa->x != sb->x)
+                return (sa->x < sb->x) ? -1 : 1;
+
+        return 0;
+}
+
+
+/**
+ * collect positions of all mapped LEDs in setup as spans of width 1
+ *
+ * @param s LedSetup
+ * @param[out] count amount of entries in resulting array
+ * @result newly allocated array (free() it) or NULL
+ */
+static LedFrameSpan *_collect_pixels(LedSetup * s, LedCount * count)
+{
+        *count = 0;
+
+        /* count LEDs of all hardware chains */
+        LedCount total = 0;
+        LedHardware *h;
+        for(h = s->firstHw; h; h = led_hardware_list_get_next(h))
+        {
+                LedChain *c;
+                if((c = led_hardware_get_chain(h)))
+                        total += led_chain_get_ledcount(c);
+        }
+
+        /* allocate at least one element so empty setups don't look like
+         * errors */
+        LedFrameSpan *r;
+        if(!(r = calloc(total > 0 ? total : 1, sizeof(LedFrameSpan))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        /* walk all mapped LEDs */
+        LedCount n = 0;
+        for(h = s->firstHw; h; h = led_hardware_list_get_next(h))
+        {
+                LedChain *c;
+                if(!(c = led_hardware_get_chain(h)))
+                        continue;
+
+                LedCount i;
+                for(i = 0; i < led_chain_get_ledcount(c); i++)
+                {
+                        if(!led_get_pos(led_chain_get_nth(c, i),
+                                        &r[n].x, &r[n].y))
+                        {
+                                free(r);
+                                return NULL;
+                        }
+
+                        r[n++].width = 1;
+                }
+        }
+
+        *count = n;
+        return r;
+}
+
 
 /******************************************************************************/
 /************************ "private" API FUNCTIONS *****************************/
 /******************************************************************************/
 
+/**
+ * drop cached dimensions of a setup
+ *
+ * @param s LedSetup or NULL
+ */
+void _setup_invalidate(LedSetup * s)
+{
+        if(!s)
+                return;
+
+        s->dim.valid = false;
+}
+
+
+/**
+ * hand over an arena to a setup. The arena will be destroyed together with
+ * the setup.
+ *
+ * @param s LedSetup
+ * @param a Arena the objects of this setup were allocated from
+ */
+void _setup_set_arena(LedSetup * s, Arena * a)
+{
+        if(!s)
+                NFT_LOG_NULL();
+
+        s->arena = a;
+}
+
 
 /******************************************************************************/
 /**************************** API FUNCTIONS ***********************************/
@@ -127,6 +240,10 @@ void led_setup_destroy(LedSetup * s)
         /* be really tidy :) */
         s->firstHw = NULL;
 
+        /* release memory of all objects allocated from our arena at once */
+        _arena_destroy(s->arena);
+        s->arena = NULL;
+
         /* free descriptor */
         free(s);
 }
@@ -145,6 +262,9 @@ void led_setup_set_hardware(LedSetup * s, LedHardware * h)
 
         s->firstHw = h;
 
+        /* dimensions changed */
+        _setup_invalidate(s);
+
         if(h)
         {
                 hardware_set_parent_setup(h, s);
@@ -191,6 +311,19 @@ NftResult led_setup_get_dim(LedSetup * s, LedFrameCord * width,
         if(!s->firstHw)
                 return NFT_SUCCESS;
 
+        /* use cached result if nothing changed */
+        unsigned long generation = _relation_generation();
+        if(s->dim.valid && s->dim.generation == generation)
+        {
+                if(width)
+                        *width = s->dim.width;
+                if(height)
+                        *height = s->dim.height;
+                return NFT_SUCCESS;
+        }
+
+        LedFrameCord rw = 0, rh = 0;
+
         /* walk all registered Hardware descriptors */
         LedHardware *h;
         for(h = s->firstHw; h; h = led_hardware_list_get_next(h))
@@ -212,10 +345,82 @@ NftResult led_setup_get_dim(LedSetup * s, LedFrameCord * width,
 
                         /* if this tile is wider/higher than the current
                          * dimensions, take as new width/height */
-                        if(width)
-                                *width = MAX(*width, w + x);
-                        if(height)
-                                *height = MAX(*height, h + y);
+                        rw = MAX(rw, w + x);
+                        rh = MAX(rh, h + y);
+                }
+        }
+
+        /* cache result */
+        s->dim.width = rw;
+        s->dim.height = rh;
+        s->dim.valid = true;
+        s->dim.generation = generation;
+
+        if(width)
+                *width = rw;
+        if(height)
+                *height = rh;
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * get bounding box of all pixels that are sampled by at least one LED of this
+ * setup. Unlike led_setup_get_dim() this only covers pixels that are actually
+ * used. Coordinates are taken from the mapped hardware chains, so call
+ * led_hardware_list_refresh_mapping() before.
+ *
+ * @param[in] s LedSetup descriptor
+ * @param[out] x1 x coordinate of bounding box corner
+ * @param[out] y1 y coordinate of bounding box corner
+ * @param[out] x2 x coordinate of opposite bounding box corner
+ * @param[out] y2 y coordinate of opposite bounding box corner
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_setup_get_bounding_box(LedSetup * s, LedFrameCord * x1,
+                                     LedFrameCord * y1, LedFrameCord * x2,
+                                     LedFrameCord * y2)
+{
+        if(!s || !x1 || !y1 || !x2 || !y2)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        *x1 = *y1 = *x2 = *y2 = 0;
+
+        bool empty = true;
+
+        /* walk all registered Hardware descriptors */
+        LedHardware *h;
+        for(h = s->firstHw; h; h = led_hardware_list_get_next(h))
+        {
+                LedChain *c;
+                if(!(c = led_hardware_get_chain(h)))
+                        continue;
+
+                /* walk all LEDs of this hardware */
+                LedCount i;
+                for(i = 0; i < led_chain_get_ledcount(c); i++)
+                {
+                        LedFrameCord x, y;
+                        if(!led_get_pos(led_chain_get_nth(c, i), &x, &y))
+                                return NFT_FAILURE;
+
+                        /* first LED initializes bounding box */
+                        if(empty)
+                        {
+                                *x1 = x;
+                                *y1 = y;
+                                *x2 = x + 1;
+                                *y2 = y + 1;
+                                empty = false;
+                                continue;
+                        }
+
+                        /* bounding box is max+1 */
+                        *x1 = MIN(*x1, x);
+                        *y1 = MIN(*y1, y);
+                        *x2 = MAX(*x2, x + 1);
+                        *y2 = MAX(*y2, y + 1);
                 }
         }
 
@@ -223,6 +428,76 @@ NftResult led_setup_get_dim(LedSetup * s, LedFrameCord * width,
 }
 
 
+/**
+ * get sparse layout of all pixels that are sampled by the LEDs of this setup.
+ * The result is a list of horizontal spans ordered by row and column. Spans
+ * never overlap and pixels used by more than one LED (e.g. the components of
+ * one RGB pixel) only appear once. Renderers can use this to only produce
+ * pixels that will be sampled. Coordinates are taken from the mapped hardware
+ * chains, so call led_hardware_list_refresh_mapping() before.
+ *
+ * @param[in] s LedSetup descriptor
+ * @param[out] count amount of spans in resulting array
+ * @result newly allocated array of spans (free with led_setup_spans_free())
+ * or NULL upon error
+ */
+LedFrameSpan *led_setup_get_spans(LedSetup * s, LedCount * count)
+{
+        if(!s || !count)
+                NFT_LOG_NULL(NULL);
+
+        /* get one span per LED */
+        LedFrameSpan *r;
+        LedCount n;
+        if(!(r = _collect_pixels(s, &n)))
+                return NULL;
+
+        /* order by row, then by column */
+        qsort(r, n, sizeof(LedFrameSpan), _span_compare);
+
+        /* merge duplicate and adjacent pixels in place */
+        LedCount i, spans = 0;
+        for(i = 0; i < n; i++)
+        {
+                if(spans > 0)
+                {
+                        LedFrameSpan *last = &r[spans - 1];
+
+                        if(last->y == r[i].y &&
+                           r[i].x <= last->x + last->width)
+                        {
+                                last->width = MAX(last->width,
+                                                  r[i].x - last->x + 1);
+                                continue;
+                        }
+                }
+
+                r[spans++] = r[i];
+        }
+
+        /* shrink to resulting size */
+        LedFrameSpan *t;
+        if(spans > 0 && (t = realloc(r, spans * sizeof(LedFrameSpan))))
+                r = t;
+
+        NFT_LOG(L_DEBUG, "%ld LEDs of setup sample %ld spans", n, spans);
+
+        *count = spans;
+        return r;
+}
+
+
+/**
+ * free array of spans created by led_setup_get_spans()
+ *
+ * @param spans array of spans
+ */
+void led_setup_spans_free(LedFrameSpan * spans)
+{
+        free(spans);
+}
+
+
 
 
 /**
@@ -0,0 +1,666 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file space.c
+ */
+
+
+/**
+ * @addtogroup space
+ * @{
+ */
+
+#include <math.h>
+#include <limits.h>
+#include "niftyled-space.h"
+#include "_chain.h"
+
+
+
+
+/**
+ * model of all mapped LEDs of a setup as structure of arrays
+ */
+struct _LedSpace
+{
+        /** setup this space was created from */
+        LedSetup *setup;
+        /** total amount of LEDs */
+        LedCount ledcount;
+        /** x-coordinate of every LED */
+        LedFrameCord *x;
+        /** y-coordinate of every LED */
+        LedFrameCord *y;
+        /** component of every LED */
+        LedFrameComponent *component;
+        /** amount of hardware chains */
+        int chaincount;
+        /** chain of every hardware in setup */
+        LedChain **chains;
+        /** position of first LED of every chain in our arrays */
+        LedCount *offsets;
+        /** spatial index: LEDs sorted into a grid of square cells */
+        struct
+        {
+                /** frame-coordinates of upper left corner of first cell */
+                LedFrameCord x, y;
+                /** width & height of one cell in pixels */
+                LedFrameCord cellsize;
+                /** amount of cells horizontally & vertically */
+                int columns, rows;
+                /** position of first LED of every cell in entries
+                    (columns * rows + 1 entries) */
+                LedCount *cells;
+                /** all LEDs sorted by cell */
+                LedCount *entries;
+        } grid;
+};
+
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** free arrays of a LedSpace */
+static void _space_clear(LedSpace * sp)
+{
+        free(sp->x);
+        free(sp->y);
+        free(sp->component);
+        free(sp->chains);
+        free(sp->offsets);
+        free(sp->grid.cells);
+        free(sp->grid.entries);
+
+        sp->x = NULL;
+        sp->y = NULL;
+        sp->component = NULL;
+        sp->chains = NULL;
+        sp->offsets = NULL;
+        sp->ledcount = 0;
+        sp->chaincount = 0;
+        memset(&sp->grid, 0, sizeof(sp->grid));
+}
+
+
+/** get position of chain a LED belongs to */
+static int _chain_of(LedSpace * sp, LedCount n)
+{
+        int lo = 0, hi = sp->chaincount - 1;
+        while(lo < hi)
+        {
+                int mid = (lo + hi + 1) / 2;
+                if(sp->offsets[mid] <= n)
+                        lo = mid;
+                else
+                        hi = mid - 1;
+        }
+
+        return lo;
+}
+
+
+/** get column/row of a coordinate (not clipped to grid) */
+static long long _cell(long long v, LedFrameCord origin,
+                       LedFrameCord cellsize)
+{
+        long long d = v - origin;
+
+        /* round towards negative infinity */
+        if(d < 0)
+                return -((-d + cellsize - 1) / cellsize);
+
+        return d / cellsize;
+}
+
+
+/** sort all LEDs of a LedSpace into grid */
+static NftResult _grid_build(LedSpace * sp)
+{
+        if(sp->ledcount == 0)
+                return NFT_SUCCESS;
+
+        /* bounding box of all LEDs */
+        LedFrameCord x1 = sp->x[0], y1 = sp->y[0];
+        LedFrameCord x2 = sp->x[0], y2 = sp->y[0];
+        LedCount n;
+        for(n = 1; n < sp->ledcount; n++)
+        {
+                if(sp->x[n] < x1)
+                        x1 = sp->x[n];
+                if(sp->x[n] > x2)
+                        x2 = sp->x[n];
+                if(sp->y[n] < y1)
+                        y1 = sp->y[n];
+                if(sp->y[n] > y2)
+                        y2 = sp->y[n];
+        }
+
+        /* choose cellsize so there are ~2 LEDs per cell in average */
+        double width = (double) x2 - x1 + 1;
+        double height = (double) y2 - y1 + 1;
+        double cellsize = ceil(sqrt(width * height /
+                                    ((sp->ledcount + 1) / 2)));
+
+        /* don't create much more cells than LEDs for long, thin setups */
+        double cellmin = ceil(fmax(width, height) / (4.0 * sp->ledcount));
+        cellsize = fmax(fmax(cellsize, cellmin), 1);
+        cellsize = fmin(cellsize, INT_MAX);
+
+        sp->grid.x = x1;
+        sp->grid.y = y1;
+        sp->grid.cellsize = (LedFrameCord) cellsize;
+        sp->grid.columns = (int) ceil(width / sp->grid.cellsize);
+        sp->grid.rows = (int) ceil(height / sp->grid.cellsize);
+
+        size_t cellcount = (size_t) sp->grid.columns * sp->grid.rows;
+        if(!(sp->grid.cells = calloc(cellcount + 1, sizeof(LedCount))) ||
+           !(sp->grid.entries = calloc(sp->ledcount, sizeof(LedCount))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NFT_FAILURE;
+        }
+
+        /* count LEDs per cell */
+        for(n = 0; n < sp->ledcount; n++)
+        {
+                size_t c = _cell(sp->y[n], y1, sp->grid.cellsize) *
+                        sp->grid.columns + _cell(sp->x[n], x1,
+                                                 sp->grid.cellsize);
+                sp->grid.cells[c + 1]++;
+        }
+
+        /* position of first LED of every cell */
+        size_t c;
+        for(c = 1; c <= cellcount; c++)
+                sp->grid.cells[c] += sp->grid.cells[c - 1];
+
+        /* sort LEDs into cells (keeps order of LEDs inside a cell) */
+        for(n = 0; n < sp->ledcount; n++)
+        {
+                c = _cell(sp->y[n], y1, sp->grid.cellsize) *
+                        sp->grid.columns + _cell(sp->x[n], x1,
+                                                 sp->grid.cellsize);
+                sp->grid.entries[sp->grid.cells[c]++] = n;
+        }
+
+        /* cells now contain position of last LED + 1 */
+        for(c = cellcount; c > 0; c--)
+                sp->grid.cells[c] = sp->grid.cells[c - 1];
+        sp->grid.cells[0] = 0;
+
+        return NFT_SUCCESS;
+}
+
+
+/** compare hits by chain & LED */
+static int _hit_compare(const void *a, const void *b)
+{
+        const LedSpaceHit *ha = a;
+        const LedSpaceHit *hb = b;
+
+        if(ha->chain != hb->chain)
+                return ha->chain < hb->chain ? -1 : 1;
+
+        return (ha->led > hb->led) - (ha->led < hb->led);
+}
+
+
+/**
+ * find all LEDs inside rectangle x1 <= x < x2, y1 <= y < y2 that also are
+ * inside the circle around (cx,cy) if radius2 >= 0 (bounds are long long
+ * so they can reach beyond the range of LedFrameCord)
+ */
+static LedCount _find(LedSpace * sp,
+                      long long x1, long long y1,
+                      long long x2, long long y2,
+                      LedFrameCord cx, LedFrameCord cy, long long radius2,
+                      LedSpaceHit * hits, LedCount size)
+{
+        if(sp->ledcount == 0 || x2 <= x1 || y2 <= y1)
+                return 0;
+
+        /* cells covered by rectangle */
+        long long c1 = _cell(x1, sp->grid.x, sp->grid.cellsize);
+        long long r1 = _cell(y1, sp->grid.y, sp->grid.cellsize);
+        long long c2 = _cell(x2 - 1, sp->grid.x, sp->grid.cellsize);
+        long long r2 = _cell(y2 - 1, sp->grid.y, sp->grid.cellsize);
+
+        /* rectangle outside of grid? */
+        if(c2 < 0 || r2 < 0 ||
+           c1 >= sp->grid.columns || r1 >= sp->grid.rows)
+                return 0;
+
+        /* clip to grid */
+        if(c1 < 0)
+                c1 = 0;
+        if(r1 < 0)
+                r1 = 0;
+        if(c2 >= sp->grid.columns)
+                c2 = sp->grid.columns - 1;
+        if(r2 >= sp->grid.rows)
+                r2 = sp->grid.rows - 1;
+
+        /* test all LEDs of all covered cells */
+        LedCount found = 0;
+        long long row, col;
+        for(row = r1; row <= r2; row++)
+        {
+                for(col = c1; col <= c2; col++)
+                {
+                        size_t c = row * sp->grid.columns + col;
+                        LedCount e;
+                        for(e = sp->grid.cells[c]; e < sp->grid.cells[c + 1];
+                            e++)
+                        {
+                                LedCount n = sp->grid.entries[e];
+                                LedFrameCord x = sp->x[n], y = sp->y[n];
+
+                                if(x < x1 || x >= x2 || y < y1 || y >= y2)
+                                        continue;
+
+                                if(radius2 >= 0)
+                                {
+                                        long long dx = (long long) x - cx;
+                                        long long dy = (long long) y - cy;
+                                        if(dx * dx + dy * dy > radius2)
+                                                continue;
+                                }
+
+                                if(found < size)
+                                {
+                                        int i = _chain_of(sp, n);
+                                        hits[found].chain = i;
+                                        hits[found].led = n - sp->offsets[i];
+                                }
+                                found++;
+                        }
+                }
+        }
+
+        /* sort complete results by hardware */
+        if(found <= size)
+                qsort(hits, found, sizeof(LedSpaceHit), _hit_compare);
+
+        return found;
+}
+
+
+/******************************************************************************/
+/**************************** API FUNCTIONS ***********************************/
+/******************************************************************************/
+
+/**
+ * create new LedSpace from the mapped hardware chains of a setup
+ *
+ * @param s LedSetup (call led_hardware_list_refresh_mapping() before)
+ * @result newly created LedSpace or NULL
+ */
+LedSpace *led_space_new(LedSetup * s)
+{
+        if(!s)
+                NFT_LOG_NULL(NULL);
+
+        LedSpace *r;
+        if(!(r = calloc(1, sizeof(LedSpace))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        r->setup = s;
+
+        /* collect LEDs */
+        if(!led_space_refresh(r))
+        {
+                led_space_destroy(r);
+                return NULL;
+        }
+
+        return r;
+}
+
+
+/**
+ * free all resources of a LedSpace
+ *
+ * @param sp LedSpace
+ */
+void led_space_destroy(LedSpace * sp)
+{
+        if(!sp)
+                return;
+
+        _space_clear(sp);
+        free(sp);
+}
+
+
+/**
+ * re-read LED positions from setup (call this after the mapping of the setup
+ * changed)
+ *
+ * @param sp LedSpace
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_space_refresh(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        _space_clear(sp);
+
+        /* count chains and LEDs */
+        LedHardware *h;
+        LedCount ledcount = 0;
+        int chaincount = 0;
+        for(h = led_setup_get_hardware(sp->setup); h;
+            h = led_hardware_list_get_next(h))
+        {
+                LedChain *c;
+                if(!(c = led_hardware_get_chain(h)))
+                        continue;
+
+                ledcount += led_chain_get_ledcount(c);
+                chaincount++;
+        }
+
+        /* nothing to do? */
+        if(chaincount == 0)
+                return NFT_SUCCESS;
+
+        /* allocate arrays */
+        if(!(sp->chains = calloc(chaincount, sizeof(LedChain *))) ||
+           !(sp->offsets = calloc(chaincount, sizeof(LedCount))))
+        {
+                NFT_LOG_PERROR("calloc");
+                goto _lsr_error;
+        }
+
+        if(ledcount > 0 &&
+           (!(sp->x = calloc(ledcount, sizeof(LedFrameCord))) ||
+            !(sp->y = calloc(ledcount, sizeof(LedFrameCord))) ||
+            !(sp->component = calloc(ledcount, sizeof(LedFrameComponent)))))
+        {
+                NFT_LOG_PERROR("calloc");
+                goto _lsr_error;
+        }
+
+        /* fill arrays */
+        LedCount n = 0;
+        int i = 0;
+        for(h = led_setup_get_hardware(sp->setup); h;
+            h = led_hardware_list_get_next(h))
+        {
+                LedChain *c;
+                if(!(c = led_hardware_get_chain(h)))
+                        continue;
+
+                sp->chains[i] = c;
+                sp->offsets[i] = n;
+                i++;
+
+                /* copy properties of all LEDs in this chain */
+                LedArray *leds = _chain_get_leds(c);
+                LedCount count = led_chain_get_ledcount(c);
+                memcpy(&sp->x[n], leds->x, count * sizeof(LedFrameCord));
+                memcpy(&sp->y[n], leds->y, count * sizeof(LedFrameCord));
+                memcpy(&sp->component[n], leds->component,
+                       count * sizeof(LedFrameComponent));
+                n += count;
+        }
+
+        sp->ledcount = ledcount;
+        sp->chaincount = chaincount;
+
+        /* build spatial index */
+        if(!_grid_build(sp))
+                goto _lsr_error;
+
+        return NFT_SUCCESS;
+
+_lsr_error:
+        _space_clear(sp);
+        return NFT_FAILURE;
+}
+
+
+/**
+ * get total amount of LEDs in a LedSpace
+ *
+ * @param sp LedSpace
+ * @result amount of LEDs
+ */
+LedCount led_space_get_ledcount(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(0);
+
+        return sp->ledcount;
+}
+
+
+/**
+ * get x-coordinates of all LEDs
+ *
+ * @param sp LedSpace
+ * @result array of led_space_get_ledcount() coordinates
+ */
+const LedFrameCord *led_space_get_x(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(NULL);
+
+        return sp->x;
+}
+
+
+/**
+ * get y-coordinates of all LEDs
+ *
+ * @param sp LedSpace
+ * @result array of led_space_get_ledcount() coordinates
+ */
+const LedFrameCord *led_space_get_y(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(NULL);
+
+        return sp->y;
+}
+
+
+/**
+ * get components of all LEDs
+ *
+ * @param sp LedSpace
+ * @result array of led_space_get_ledcount() components
+ */
+const LedFrameComponent *led_space_get_component(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(NULL);
+
+        return sp->component;
+}
+
+
+/**
+ * get amount of hardware chains covered by a LedSpace
+ *
+ * @param sp LedSpace
+ * @result amount of chains
+ */
+int led_space_get_chain_count(LedSpace * sp)
+{
+        if(!sp)
+                NFT_LOG_NULL(0);
+
+        return sp->chaincount;
+}
+
+
+/**
+ * get n-th hardware chain of a LedSpace. Effects can use this to write values
+ * of a whole chain at once (e.g. using led_chain_get_buffer())
+ *
+ * @param[in] sp LedSpace
+ * @param[in] n number of chain
+ * @param[out] offset position of first LED of this chain in the LedSpace
+ * arrays or NULL
+ * @result LedChain or NULL
+ */
+LedChain *led_space_get_chain(LedSpace * sp, int n, LedCount * offset)
+{
+        if(!sp)
+                NFT_LOG_NULL(NULL);
+
+        if(n < 0 || n >= sp->chaincount)
+        {
+                NFT_LOG(L_ERROR, "n >= chaincount (%d >= %d)", n,
+                        sp->chaincount);
+                return NULL;
+        }
+
+        if(offset)
+                *offset = sp->offsets[n];
+
+        return sp->chains[n];
+}
+
+
+/**
+ * write greyscale value of one LED directly to the hardware chain it belongs
+ * to
+ *
+ * @param sp LedSpace
+ * @param n position of LED in LedSpace arrays
+ * @param value new greyscale-value cast to long long int
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult led_space_set_greyscale(LedSpace * sp, LedCount n,
+                                  long long int value)
+{
+        if(!sp)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(n < 0 || n >= sp->ledcount)
+        {
+                NFT_LOG(L_ERROR, "n >= ledcount (%ld >= %ld)", n,
+                        sp->ledcount);
+                return NFT_FAILURE;
+        }
+
+        /* find chain this LED belongs to */
+        int i = _chain_of(sp, n);
+
+        return led_chain_set_greyscale(sp->chains[i], n - sp->offsets[i],
+                                       value);
+}
+
+
+/**
+ * find all LEDs inside a rectangle (uses the spatial index of the LedSpace)
+ *
+ * @param[in] sp LedSpace
+ * @param[in] x1 x coordinate of rectangle corner
+ * @param[in] y1 y coordinate of rectangle corner
+ * @param[in] x2 x coordinate of opposite rectangle corner (exclusive)
+ * @param[in] y2 y coordinate of opposite rectangle corner (exclusive)
+ * @param[out] hits array of at least size elements that will receive the
+ * found LEDs sorted by hardware chain & position in chain
+ * @param[in] size amount of elements hits can hold
+ * @result total amount of LEDs found. If this is larger than size, only size
+ * (unsorted) LEDs were stored and the call should be repeated with a larger
+ * array.
+ */
+LedCount led_space_find_rect(LedSpace * sp,
+                             LedFrameCord x1, LedFrameCord y1,
+                             LedFrameCord x2, LedFrameCord y2,
+                             LedSpaceHit * hits, LedCount size)
+{
+        if(!sp || (!hits && size > 0))
+                NFT_LOG_NULL(0);
+
+        return _find(sp, x1, y1, x2, y2, 0, 0, -1, hits, size);
+}
+
+
+/**
+ * find all LEDs with a distance <= radius to a point (uses the spatial index
+ * of the LedSpace)
+ *
+ * @param[in] sp LedSpace
+ * @param[in] x x coordinate of center
+ * @param[in] y y coordinate of center
+ * @param[in] radius radius in pixels
+ * @param[out] hits array of at least size elements that will receive the
+ * found LEDs sorted by hardware chain & position in chain
+ * @param[in] size amount of elements hits can hold
+ * @result total amount of LEDs found. If this is larger than size, only size
+ * (unsorted) LEDs were stored and the call should be repeated with a larger
+ * array.
+ */
+LedCount led_space_find_radius(LedSpace * sp,
+                               LedFrameCord x, LedFrameCord y,
+                               LedFrameCord radius,
+                               LedSpaceHit * hits, LedCount size)
+{
+        if(!sp || (!hits && size > 0))
+                NFT_LOG_NULL(0);
+
+        if(radius < 0)
+                return 0;
+
+        return _find(sp, (long long) x - radius, (long long) y - radius,
+                     (long long) x + radius + 1, (long long) y + radius + 1,
+                     x, y, (long long) radius * radius, hits, size);
+}
+
+
+/**
+ * @}
+ */
@@ -46,6 +46,7 @@
 
 
 NftResult                       _tile_set_parent_hardware(LedTile * t, LedHardware * h);
+void                            _tile_invalidate(LedTile * t);
 
 
 #endif /* _LED__TILE_H */
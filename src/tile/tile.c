@@ -58,7 +58,11 @@
 //#include <niftyled.h>
 #include "niftyled-chain.h"
 #include "_chain.h"
+#include "_tile.h"
+#include "_hardware.h"
+#include "_setup.h"
 #include "_relation.h"
+#include "_arena.h"
 
 
 /** casting macro @todo add type validty check */
@@ -123,6 +127,25 @@ struct _LedTile
                 /** rotation center of this tile (in pixels) */
                 double pivot_x, pivot_y;
         } geometry;
+        /** this tile and all its children flattened for linear iteration */
+        RelationTree tree;
+        /** scratch buffer for calculations over tree */
+        void *scratch;
+        /** size of scratch buffer in bytes */
+        size_t scratchsize;
+        /** aggregates of this tile and its children (valid if flag is set
+            and no relation changed since they were calculated) */
+        struct
+        {
+                /** total amount of LEDs */
+                LedCount ledcount;
+                bool ledcount_valid;
+                unsigned long ledcount_generation;
+                /** untransformed bounding box (x1, y1, x2, y2) */
+                LedFrameCord box[4];
+                bool box_valid;
+                unsigned long box_generation;
+        } cache;
 };
 
 
@@ -303,53 +326,125 @@ static NftResult _append_child(Relation * r, void *u)
 }
 
 
-/** foreach helper */
-static NftResult _bounding_box_helper(Relation * r, void *u)
+/** foreach helper to set parent hardware */
+static NftResult _set_parent_hw(Relation * r, void *u)
 {
-        LedTile *t = TILE(r);
-        LedFrameCord **dim = u;
-        LedFrameCord *x1 = dim[0];
-        LedFrameCord *y1 = dim[1];
-        LedFrameCord *x2 = dim[2];
-        LedFrameCord *y2 = dim[3];
+        TILE(r)->parent_hw = u;
+        return NFT_SUCCESS;
+}
 
 
-        LedFrameCord xt1, yt1, xt2, yt2;
-        if(!led_tile_get_transformed_bounding_box(t, &xt1, &yt1, &xt2, &yt2))
-                return NFT_FAILURE;
+/** get flattened tree of a tile (refreshed if tiles were relinked) */
+static RelationTree *_tree(LedTile * m)
+{
+        if(!_relation_tree_flatten(&m->tree, RELATION(m)))
+                return NULL;
 
-        /* add child offset */
-        xt1 += t->geometry.x;
-        yt1 += t->geometry.y;
-        xt2 += t->geometry.x;
-        yt2 += t->geometry.y;
+        return &m->tree;
+}
 
-        *x1 = MIN(*x1, MIN(*x2, MIN(xt2, xt1)));
-        *y1 = MIN(*y1, MIN(*y2, MIN(yt2, yt1)));
-        *x2 = MAX(*x1, MAX(*x2, MAX(xt2, xt1)));
-        *y2 = MAX(*y1, MAX(*y2, MAX(yt2, yt1)));
 
-        return NFT_SUCCESS;
+/** get scratch buffer of tile that holds at least size bytes */
+static void *_scratch(LedTile * m, size_t size)
+{
+        if(size <= m->scratchsize)
+                return m->scratch;
+
+        void *scratch;
+        if(!(scratch = realloc(m->scratch, size)))
+        {
+                NFT_LOG_PERROR("realloc");
+                return NULL;
+        }
+
+        m->scratch = scratch;
+        m->scratchsize = size;
+
+        return scratch;
 }
 
 
-/** foreach helper to set parent hardware */
-static NftResult _set_parent_hw(Relation * r, void *u)
+/** get bounding box of the chain of a tile (without children) */
+static NftResult _chain_bounding_box(LedTile * t, LedFrameCord box[4])
 {
-        TILE(r)->parent_hw = u;
+        box[0] = box[1] = box[2] = box[3] = 0;
+
+        if(!t->chain)
+                return NFT_SUCCESS;
+
+        if(!led_chain_get_min_pos(t->chain, &box[0], &box[1]))
+                return NFT_FAILURE;
+        if(!led_chain_get_max_pos(t->chain, &box[2], &box[3]))
+                return NFT_FAILURE;
+
+        /* bounding box is max+1 */
+        box[2]++;
+        box[3]++;
+
         return NFT_SUCCESS;
 }
 
 
-/** foreach helper to count LEDs of tile */
-static NftResult _ledcount(Relation * r, void *u)
+/**
+ * copy LEDs of the chain of one tile (without children) to dst-chain
+ *
+ * @result amount of LEDs written to dst
+ */
+static LedCount _chain_to_chain(LedTile * m, LedChain * dst, LedCount offset)
 {
-        LedCount *c = u;
-        LedCount t;
-        t = led_tile_get_ledcount(TILE(r));
-        *c += t;
+        if(!m->chain)
+                return 0;
 
-        return NFT_SUCCESS;
+        /* calculate complex transformation matrix for this tile */
+        double matrix[3][3];
+        _identity_matrix(matrix);
+        LedTile *p;
+        for(p = m; p; p = TILE_PARENT(p))
+        {
+                _matrix_mul_3(matrix, p->matrix);
+        }
+
+        /* amount of LEDs that fit into dst-chain */
+        LedCount count = led_chain_get_ledcount(m->chain);
+        if(offset + count > led_chain_get_ledcount(dst))
+        {
+                NFT_LOG(L_WARNING,
+                        "Destination chain is not large enough to map all LEDs of all tiles");
+                count = led_chain_get_ledcount(dst) - offset;
+                if(count < 0)
+                        count = 0;
+        }
+
+        /* copy all LEDs of this tile to dst-chain & shift according
+         * to offset */
+        LedArray *leds = _chain_get_leds(dst);
+        _array_copy(leds, offset, _chain_get_leds(m->chain), 0, count);
+
+        LedCount i;
+        for(i = 0; i < count; i++)
+        {
+                /* copy greyscale value */
+                long long int greyscale = 0;
+                led_chain_get_greyscale(m->chain, i, &greyscale);
+                led_chain_set_greyscale(dst, offset + i, greyscale);
+
+                /* transform position according to complex transform
+                 * matrix */
+                double vector[3] = {
+                        (double) leds->x[offset + i] + 0.5,
+                        (double) leds->y[offset + i] + 0.5, 1
+                };
+                _matrix_mul_1(vector, matrix);
+
+                leds->x[offset + i] = (LedFrameCord) (round(vector[0] - 0.5));
+                leds->y[offset + i] = (LedFrameCord) (round(vector[1] - 0.5));
+        }
+
+        NFT_LOG(L_VERBOSE,
+                "Copied %d LEDs from tile to to dest chain (%d LEDs) with offset %d",
+                count, led_chain_get_ledcount(dst), offset);
+
+        return count;
 }
 
 
@@ -382,6 +477,32 @@ NftResult _tile_set_parent_hardware(LedTile * t, LedHardware * h)
 }
 
 
+/**
+ * drop cached aggregates of a tile and all its parents. Must be called
+ * whenever something changes that influences the amount of LEDs or the
+ * dimensions of a tile.
+ *
+ * @param t LedTile descriptor
+ */
+void _tile_invalidate(LedTile * t)
+{
+        for(; t; t = TILE_PARENT(t))
+        {
+                /* if nothing is cached here, nothing is cached in our parents
+                 * either (they always cache their children) */
+                if(!t->cache.ledcount_valid && !t->cache.box_valid)
+                        return;
+
+                t->cache.ledcount_valid = false;
+                t->cache.box_valid = false;
+
+                /* dimensions of setup contain this tile */
+                if(!TILE_PARENT(t) && t->parent_hw)
+                        _setup_invalidate(_hardware_get_setup(t->parent_hw));
+        }
+}
+
+
 /******************************************************************************/
 /****************************** API FUNCTIONS *********************************/
 /******************************************************************************/
@@ -394,7 +515,7 @@ NftResult _tile_set_parent_hardware(LedTile * t, LedHardware * h)
 LedTile *led_tile_new()
 {
         LedTile *m;
-        if(!(m = calloc(1, sizeof(LedTile))))
+        if(!(m = _arena_calloc(1, sizeof(LedTile))))
         {
                 NFT_LOG_PERROR("calloc");
                 return NULL;
@@ -414,8 +535,9 @@ void led_tile_destroy(LedTile * m)
         if(!m)
                 return;
 
-        /* free children recursively */
-        TILE_FOREACH(TILE_CHILD(m), _destroy, NULL);
+        /* free children (deepest first) */
+        _relation_foreach_postorder(RELATION(TILE_CHILD(m)), &m->tree.stack,
+                                    _destroy, NULL);
 
         /* unlink from parent hardware */
         if(m->parent_hw)
@@ -435,13 +557,18 @@ void led_tile_destroy(LedTile * m)
         if(m->chain)
                 led_chain_destroy(m->chain);
 
+        /* free flattened tree */
+        _relation_tree_free(&m->tree);
+        free(m->scratch);
+
         /* clear old pointers */
         m->parent_hw = NULL;
         m->chain = NULL;
         m->privdata = NULL;
+        m->scratch = NULL;
 
         /* free descriptor */
-        free(m);
+        _arena_free(m);
 }
 
 
@@ -482,6 +609,10 @@ LedTile *led_tile_dup(LedTile * m)
 
         /* clear fields we don't want to duplicate */
         _relation_clear(RELATION(r));
+        memset(&r->tree, 0, sizeof(RelationTree));
+        memset(&r->cache, 0, sizeof(r->cache));
+        r->scratch = NULL;
+        r->scratchsize = 0;
         r->parent_hw = NULL;
 
         /* copy chain */
@@ -554,6 +685,9 @@ NftResult led_tile_set_pos(LedTile * t, LedFrameCord x, LedFrameCord y)
         /* refresh mapping matrix */
         _map_matrix(t);
 
+        /* dimensions of parents changed */
+        _tile_invalidate(t);
+
         return NFT_SUCCESS;
 }
 
@@ -596,6 +730,9 @@ NftResult led_tile_set_rotation(LedTile * m, double angle)
 
         _map_matrix(m);
 
+        /* dimensions of parents changed */
+        _tile_invalidate(m);
+
         return NFT_SUCCESS;
 }
 
@@ -634,6 +771,9 @@ NftResult led_tile_set_pivot(LedTile * t, double x, double y)
         /* refresh mapping matrix */
         _map_matrix(t);
 
+        /* dimensions of parents changed */
+        _tile_invalidate(t);
+
         return NFT_SUCCESS;
 }
 
@@ -758,24 +898,70 @@ NftResult led_tile_get_bounding_box(LedTile * t,
 
         *x1 = *y1 = *x2 = *y2 = 0;
 
+        /* use cached result if nothing changed */
+        unsigned long generation = _relation_generation();
+        if(t->cache.box_valid && t->cache.box_generation == generation)
+        {
+                *x1 = t->cache.box[0];
+                *y1 = t->cache.box[1];
+                *x2 = t->cache.box[2];
+                *y2 = t->cache.box[3];
+                return NFT_SUCCESS;
+        }
+
+        RelationTree *tree;
+        if(!(tree = _tree(t)))
+                return NFT_FAILURE;
+
+        LedFrameCord(*box)[4];
+        if(!(box = _scratch(t, tree->count * sizeof(*box))))
+                return NFT_FAILURE;
 
-        /* find bounding box of our chain */
-        if(t->chain)
+        /* find bounding box of every chain */
+        int i;
+        for(i = 0; i < tree->count; i++)
         {
-                if(!led_chain_get_min_pos(t->chain, x1, y1))
+                if(!_chain_bounding_box(TILE(tree->nodes[i]), box[i]))
                         return NFT_FAILURE;
-                if(!led_chain_get_max_pos(t->chain, x2, y2))
-                        return NFT_FAILURE;
-
-                /* bounding box is max+1 */
-                (*x2)++;
-                (*y2)++;
         }
 
-        /* process all children */
-        LedFrameCord *dim[4] = { x1, y1, x2, y2 };
-        TILE_FOREACH(TILE_CHILD(t), _bounding_box_helper, dim);
+        /* merge boxes of children into their parents (children come after
+         * their parents, so box of a tile is complete when we reach it) */
+        for(i = tree->count - 1; i >= 0; i--)
+        {
+                LedTile *c = TILE(tree->nodes[i]);
+
+                /* cache result for every tile */
+                memcpy(c->cache.box, box[i], sizeof(c->cache.box));
+                c->cache.box_valid = true;
+                c->cache.box_generation = generation;
 
+                if(i == 0)
+                        break;
+
+                LedFrameCord *b = box[tree->parents[i]];
+
+                /* rotate child box */
+                LedFrameCord xt1 = box[i][0], yt1 = box[i][1];
+                LedFrameCord xt2 = box[i][2], yt2 = box[i][3];
+                _transform_tile_box(c, &xt1, &yt1, &xt2, &yt2);
+
+                /* add child offset */
+                xt1 += c->geometry.x;
+                yt1 += c->geometry.y;
+                xt2 += c->geometry.x;
+                yt2 += c->geometry.y;
+
+                b[0] = MIN(b[0], MIN(b[2], MIN(xt2, xt1)));
+                b[1] = MIN(b[1], MIN(b[3], MIN(yt2, yt1)));
+                b[2] = MAX(b[0], MAX(b[2], MAX(xt2, xt1)));
+                b[3] = MAX(b[1], MAX(b[3], MAX(yt2, yt1)));
+        }
+
+        *x1 = box[0][0];
+        *y1 = box[0][1];
+        *x2 = box[0][2];
+        *y2 = box[0][3];
 
 
         return NFT_SUCCESS;
@@ -842,6 +1028,9 @@ NftResult led_tile_set_chain(LedTile * m, LedChain * c)
         /* register chain to tile */
         m->chain = c;
 
+        /* amount of LEDs & dimensions changed */
+        _tile_invalidate(m);
+
         /* register tile to chain */
         if(c)
                 _chain_set_parent_tile(c, m);
@@ -895,16 +1084,43 @@ LedCount led_tile_get_ledcount(LedTile * m)
                 NFT_LOG_NULL(0);
 
 
-        LedCount r = 0;
+        /* use cached result if nothing changed */
+        unsigned long generation = _relation_generation();
+        if(m->cache.ledcount_valid &&
+           m->cache.ledcount_generation == generation)
+                return m->cache.ledcount;
 
-        TILE_FOREACH(TILE_CHILD(m), _ledcount, &r);
+        RelationTree *tree;
+        if(!(tree = _tree(m)))
+                return 0;
 
-        if((m->chain))
+        LedCount *count;
+        if(!(count = _scratch(m, tree->count * sizeof(LedCount))))
+                return 0;
+
+        /* LEDs of every chain */
+        int i;
+        for(i = 0; i < tree->count; i++)
         {
-                r += led_chain_get_ledcount(m->chain);
+                LedTile *t = TILE(tree->nodes[i]);
+                count[i] = t->chain ? led_chain_get_ledcount(t->chain) : 0;
         }
 
-        return r;
+        /* sum up children (children come after their parents) */
+        for(i = tree->count - 1; i >= 0; i--)
+        {
+                LedTile *t = TILE(tree->nodes[i]);
+
+                /* cache result for every tile */
+                t->cache.ledcount = count[i];
+                t->cache.ledcount_valid = true;
+                t->cache.ledcount_generation = generation;
+
+                if(i > 0)
+                        count[tree->parents[i]] += count[i];
+        }
+
+        return count[0];
 }
 
 
@@ -1027,24 +1243,6 @@ LedHardware *led_tile_get_parent_hardware(LedTile * t)
 }
 
 
-/** foreach helper to translate children of a tile */
-NftResult _to_chain(Relation * r, void *u)
-{
-        struct
-        {
-                LedCount *total;
-                LedChain *dst;
-                LedCount *offset;
-        } *desc = u;
-
-        *desc->total +=
-                led_tile_to_chain(TILE(r), desc->dst,
-                                  *desc->offset + *desc->total);
-
-        return NFT_SUCCESS;
-}
-
-
 /**
  * translate the chain of a tile (or subtile(s)) to a
  * LedChain with respect to the offset, rotation and pivot of
@@ -1063,85 +1261,42 @@ LedCount led_tile_to_chain(LedTile * m, LedChain * dst, LedCount offset)
                 NFT_LOG_NULL(0);
 
 
+        RelationTree *tree;
+        if(!(tree = _tree(m)))
+                return 0;
+
+        /* LEDs processed so far by each tile and its children */
+        LedCount *total;
+        if(!(total = _scratch(m, tree->count * sizeof(LedCount))))
+                return 0;
+        memset(total, 0, tree->count * sizeof(LedCount));
+
         /* result will be the amount of total LEDs processed */
         LedCount leds_total = 0;
 
-        /* process children recursively (if there are any) */
-        struct
-        {
-                LedCount *total;
-                LedChain *dst;
-                LedCount *offset;
-        }
-        desc =
+        /* process children before their parent. Every tile starts at the
+         * offset of its parent + LEDs processed by its previous siblings */
+        int i;
+        for(i = 0; i < tree->count; i++)
         {
-        .total = &leds_total,.dst = dst,.offset = &offset};
+                int n = tree->post[i];
 
-        TILE_FOREACH(TILE_CHILD(m), _to_chain, &desc);
+                LedCount o = offset;
+                int p;
+                for(p = tree->parents[n]; p >= 0; p = tree->parents[p])
+                        o += total[p];
 
-        /* if there's a chain in this tile, process it */
-        if(m->chain)
-        {
-                /* calculate complex transformation matrix for this tile */
-                double matrix[3][3];
-                _identity_matrix(matrix);
-                LedTile *p;
-                for(p = m; p; p = TILE_PARENT(p))
-                {
-                        _matrix_mul_3(matrix, p->matrix);
-                }
-
-                /* copy all LEDs of this tile to dst-chain one by one & shift
-                 * according to offset */
-                LedCount i;
-                for(i = 0; i < led_chain_get_ledcount(m->chain); i++)
-                {
-                        if(i + offset >= led_chain_get_ledcount(dst))
-                        {
-                                NFT_LOG(L_WARNING,
-                                        "Destination chain is not large enough to map all LEDs of all tiles");
-                                break;
-                        }
-
-                        /* get destination LED */
-                        Led *led = led_chain_get_nth(dst, offset + i);
-
-                        /* copy current LED of this chain to dest */
-                        led_copy(led, led_chain_get_nth(m->chain, i));
-
-                        /* copy greyscale value */
-                        long long int greyscale = 0;
-                        led_chain_get_greyscale(m->chain, i, &greyscale);
-                        led_chain_set_greyscale(dst, offset + i, greyscale);
-
-                        /* get led position */
-                        LedFrameCord x, y;
-                        if(!led_get_pos(led, &x, &y))
-                        {
-                                NFT_LOG(L_WARNING,
-                                        "Corrupted LED found in chain");
-                        }
-
-                        /* transform position according to complex transform
-                         * matrix */
-                        double vector[3] = {
-                                (double) x + 0.5,
-                                (double) y + 0.5, 1
-                        };
-                        _matrix_mul_1(vector, matrix);
-
-                        led_set_pos(led,
-                                    (LedFrameCord) (round(vector[0] - 0.5)),
-                                    (LedFrameCord) (round(vector[1] - 0.5)));
-
-                        leds_total++;
-                }
+                LedCount leds = total[n] +
+                        _chain_to_chain(TILE(tree->nodes[n]), dst, o);
 
-                NFT_LOG(L_VERBOSE,
-                        "Copied %d LEDs from tile to to dest chain (%d LEDs) with offset %d",
-                        leds_total, led_chain_get_ledcount(dst), offset);
+                if(tree->parents[n] >= 0)
+                        total[tree->parents[n]] += leds;
+                else
+                        leds_total = leds;
         }
 
+        /* positions in dst-chain changed */
+        _chain_positions_changed(dst);
 
         return leds_total;
 }
@@ -0,0 +1,90 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file _arena.h
+ * @brief region allocator for object graphs
+ */
+
+/**
+ * @defgroup arena Arena
+ * @brief region allocator for object graphs
+ *
+ * An Arena hands out memory from a few large chunks and releases all of it at
+ * once in _arena_destroy(). Internal objects (hardware, tiles, chains and
+ * their buffers) are allocated with _arena_calloc() & co. which carve from the
+ * arena that is currently active for the calling thread (s.
+ * _arena_set_current()) or fall back to the heap if there is none.
+ * _arena_free() knows where a block came from and does nothing for arena
+ * blocks, so objects can still be destroyed one by one.
+ * @{
+ */
+
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+
+
+/** region allocator */
+typedef struct _Arena           Arena;
+
+
+Arena                          *_arena_new(size_t chunksize);
+void                            _arena_destroy(Arena * a);
+Arena                          *_arena_set_current(Arena * a);
+size_t                          _arena_get_size(Arena * a);
+
+void                           *_arena_malloc(size_t size);
+void                           *_arena_calloc(size_t nmemb, size_t size);
+void                           *_arena_realloc(void *ptr, size_t size);
+void                            _arena_free(void *ptr);
+
+
+
+#endif /* _ARENA_H */
+
+
+/**
+ * @}
+ */
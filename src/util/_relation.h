@@ -57,21 +57,89 @@
 #ifndef _RELATION_H
 #define _RELATION_H
 
+#include <stdbool.h>
+
+
 #define RELATION(a) ((Relation *) a)
 
 
 
 /** include this at the beginning of a struct to relate it to other structs */
 typedef struct _Relation        Relation;
+
+/** bookkeeping shared by all siblings of one list */
+typedef struct _RelationList    RelationList;
+struct _RelationList
+{
+        /** first sibling */
+        Relation                       *head;
+        /** last sibling */
+        Relation                       *last;
+        /** amount of siblings in list */
+        int                             count;
+        /** array of all siblings in order (rebuilt lazily) */
+        Relation                      **index;
+        /** amount of entries index is allocated for */
+        int                             indexsize;
+        /** false if list changed since index was built */
+        bool                            indexvalid;
+};
+
 struct _Relation
 {
         Relation                       *next;
         Relation                       *prev;
         Relation                       *child;
         Relation                       *parent;
+        /** list this object is part of or NULL if it has no siblings */
+        RelationList                   *list;
+        /** position in list (valid when index of list is valid) */
+        int                             pos;
 };
 
 
+/** one pending object of an iterative traversal */
+typedef struct
+{
+        /** object */
+        Relation                       *r;
+        /** index of parent in RelationTree (when flattening a tree) */
+        int                             parent;
+        /** true if children of object have been pushed already */
+        bool                            expanded;
+} RelationStackEntry;
+
+/** explicit stack for iterative traversals (can be reused between calls) */
+typedef struct
+{
+        /** pending objects */
+        RelationStackEntry             *entries;
+        /** amount of pending objects */
+        int                             count;
+        /** amount of entries allocated */
+        int                             size;
+} RelationStack;
+
+/** flattened copy of a tree of objects that can be iterated linearly */
+typedef struct
+{
+        /** root and all its descendants in pre-order */
+        Relation                      **nodes;
+        /** index of parent of each node (-1 for root) */
+        int                            *parents;
+        /** indices of nodes in post-order */
+        int                            *post;
+        /** amount of nodes */
+        int                             count;
+        /** amount of nodes arrays are allocated for */
+        int                             size;
+        /** generation of relations when tree was flattened */
+        unsigned long                   generation;
+        /** stack used while flattening */
+        RelationStack                   stack;
+} RelationTree;
+
+
 Relation                       *_relation_next(Relation * r);
 Relation                       *_relation_prev(Relation * r);
 Relation                       *_relation_child(Relation * r);
@@ -85,7 +153,13 @@ NftResult                       _relation_append_child(Relation * p, Relation *
 void                            _relation_unlink(Relation * r);
 int                             _relation_sibling_count(Relation * r);
 NftResult                       _relation_foreach(Relation * r, NftResult (*func) (Relation * r, void *userptr), void *userptr);
-NftResult                       _relation_foreach_recursive(Relation * r, NftResult (*func) (Relation * r, void *userptr));
+NftResult                       _relation_foreach_recursive(Relation * r, NftResult (*func) (Relation * r, void *userptr), void *userptr);
+NftResult                       _relation_foreach_preorder(Relation * r, RelationStack * s, NftResult (*func) (Relation * r, void *userptr), void *userptr);
+NftResult                       _relation_foreach_postorder(Relation * r, RelationStack * s, NftResult (*func) (Relation * r, void *userptr), void *userptr);
+void                            _relation_stack_free(RelationStack * s);
+NftResult                       _relation_tree_flatten(RelationTree * t, Relation * root);
+void                            _relation_tree_free(RelationTree * t);
+unsigned long                   _relation_generation();
 void                            _relation_clear(Relation * r);
 
 
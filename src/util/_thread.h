@@ -56,12 +56,58 @@
 #define _THREAD_H
 
 
+#define THREAD_MODEL_POSIX 1
+#define HAVE_THREADS 1
+
+
+#ifdef HAVE_THREADS
+#ifdef THREAD_MODEL_POSIX
+#include <pthread.h>
+#elif defined(THREAD_MODEL_GTHREAD2)    /* !THREAD_MODEL_POSIX */
+#include <glib/gthread.h>
+#endif
+#endif /* HAVE_THREADS */
+
+
+
 /** mutex to synchronize data between threads */
 typedef struct _Mutex           Mutex;
 
+/** condition variable to wait for changes of data protected by a Mutex */
+typedef struct _Cond            Cond;
+
 /** thread to wrap different threading mechanisms */
 typedef struct _Thread          Thread;
 
+
+/**
+ * The Mutex data structure and the Mutex subsystem is a wrapper system for native
+ * thread locking implementations. It's defined here, so mutexes with static
+ * storage can be initialized with THREAD_MUTEX_INITIALIZER.
+ */
+struct _Mutex
+{
+#ifdef HAVE_THREADS
+#ifdef THREAD_MODEL_POSIX
+        pthread_mutex_t mutex;
+#elif defined(THREAD_MODEL_WIN32)       /* !THREAD_MODEL_POSIX */
+
+#elif defined(THREAD_MODEL_GTHREAD)     /* !THREAD_MODEL_WIN32 */
+        GMutex *mutex;
+        GStaticMutex static_mutex;
+        int static_mutex_used;
+#endif
+#endif /* HAVE_THREADS */
+};
+
+
+/** initializer for a Mutex with static storage (never freed) */
+#if defined(THREAD_MODEL_POSIX)
+#define THREAD_MUTEX_INITIALIZER { PTHREAD_MUTEX_INITIALIZER }
+#else
+#define THREAD_MUTEX_INITIALIZER { 0 }
+#endif
+
 /**
  * The function defination for a function that forms the base of a new Thread when
  * thread_create is used.
@@ -74,12 +120,32 @@ typedef struct _Thread          Thread;
  */
 typedef void                   *(*ThreadFunc) (void *data);
 
+/**
+ * function that processes one job of _thread_pool_run()
+ *
+ * @arg job number of job (0..jobs-1)
+ * @arg data userdata from _thread_pool_run()
+ */
+typedef void                    (*ThreadJob) (size_t job, void *data);
+
+
+Thread                         *_thread_create(ThreadFunc func, void *data, bool joinable);
+void                           *_thread_join(Thread * thread);
+void                            _thread_free(Thread * thread);
+NftResult                       _thread_pool_run(ThreadJob func, void *data, size_t jobs, size_t threads);
 
 Mutex                          *_thread_mutex_new(void);
 NftResult                       _thread_mutex_free(Mutex * mutex);
 NftResult                       _thread_mutex_lock(Mutex * mutex);
 NftResult                       _thread_mutex_unlock(Mutex * mutex);
 
+Cond                           *_thread_cond_new(void);
+void                            _thread_cond_free(Cond * cond);
+NftResult                       _thread_cond_wait(Cond * cond, Mutex * mutex);
+NftResult                       _thread_cond_timedwait(Cond * cond, Mutex * mutex, long long deadline);
+NftResult                       _thread_cond_signal(Cond * cond);
+long long                       _thread_now(void);
+
 
 
 #endif /* _THREAD_H */
@@ -0,0 +1,418 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/**
+ * @file arena.c
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <niftylog.h>
+#include "_arena.h"
+
+
+
+/** default size of the first chunk of an arena */
+#define ARENA_DEFAULT_CHUNKSIZE (64*1024)
+
+
+/** one chunk of memory of an arena */
+typedef struct _ArenaChunk
+{
+        /** previously allocated chunk or NULL */
+        struct _ArenaChunk *prev;
+        /** usable size of this chunk in bytes */
+        size_t size;
+        /** bytes of this chunk handed out already */
+        size_t used;
+} ArenaChunk;
+
+
+/** region allocator */
+struct _Arena
+{
+        /** chunk we currently allocate from */
+        ArenaChunk *chunk;
+        /** size of next chunk */
+        size_t chunksize;
+        /** total bytes handed out */
+        size_t allocated;
+};
+
+
+/** types with the strictest alignment a block may have to satisfy */
+typedef union
+{
+        long double align_ld;
+        double align_d;
+        void *align_ptr;
+        long long int align_ll;
+} ArenaAlign;
+
+/** alignment of every block, chunk header & chunksize (a power of two) */
+#define ARENA_ALIGN             __alignof__(ArenaAlign)
+
+
+/** header in front of every block handed out by _arena_*alloc() */
+typedef struct
+{
+        struct
+        {
+                /** arena this block was carved from or NULL for heap blocks */
+                Arena *arena;
+                /** usable size of this block */
+                size_t size;
+        } block;
+} ArenaBlock;
+
+/** size of block header padded to ARENA_ALIGN */
+#define ARENA_BLOCK_HEADER      _align(sizeof(ArenaBlock))
+/** size of chunk header padded to ARENA_ALIGN */
+#define ARENA_CHUNK_HEADER      _align(sizeof(ArenaChunk))
+
+
+/** arena currently used by this thread (NULL = use heap) */
+static __thread Arena *_current;
+
+
+
+/******************************************************************************/
+/**************************** STATIC FUNCTIONS ********************************/
+/******************************************************************************/
+
+/** round size up to ARENA_ALIGN */
+static size_t _align(size_t size)
+{
+        return (size + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+}
+
+
+/** get start of usable memory of a chunk */
+static char *_chunk_data(ArenaChunk * c)
+{
+        return (char *) c + ARENA_CHUNK_HEADER;
+}
+
+
+/** get header of a block */
+static ArenaBlock *_block(void *ptr)
+{
+        return (ArenaBlock *) ((char *) ptr - ARENA_BLOCK_HEADER);
+}
+
+
+/** get usable memory of a block */
+static void *_block_data(ArenaBlock * b)
+{
+        return (char *) b + ARENA_BLOCK_HEADER;
+}
+
+
+/** allocate a new chunk that holds at least "size" bytes */
+static NftResult _arena_grow(Arena * a, size_t size)
+{
+        /* grow geometrically so large setups need few chunks */
+        size_t chunksize = a->chunksize;
+        while(chunksize < size)
+                chunksize *= 2;
+
+        ArenaChunk *c;
+        if(!(c = malloc(ARENA_CHUNK_HEADER + chunksize)))
+        {
+                NFT_LOG_PERROR("malloc");
+                return NFT_FAILURE;
+        }
+
+        c->prev = a->chunk;
+        c->size = chunksize;
+        c->used = 0;
+
+        a->chunk = c;
+        a->chunksize = chunksize * 2;
+
+        return NFT_SUCCESS;
+}
+
+
+/** carve block from arena */
+static void *_arena_alloc(Arena * a, size_t size)
+{
+        size_t total = ARENA_BLOCK_HEADER + _align(size);
+
+        /* not enough space left in current chunk? */
+        if(!a->chunk || a->chunk->size - a->chunk->used < total)
+        {
+                if(!_arena_grow(a, total))
+                        return NULL;
+        }
+
+        ArenaBlock *b =
+                (ArenaBlock *) (_chunk_data(a->chunk) + a->chunk->used);
+        a->chunk->used += total;
+        a->allocated += total;
+
+        /* chunks come from malloc() so clear block */
+        memset(b, 0, total);
+        b->block.arena = a;
+        b->block.size = _align(size);
+
+        return _block_data(b);
+}
+
+
+/** allocate block from heap */
+static void *_heap_alloc(size_t size)
+{
+        ArenaBlock *b;
+        if(!(b = calloc(1, ARENA_BLOCK_HEADER + size)))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        b->block.arena = NULL;
+        b->block.size = size;
+
+        return _block_data(b);
+}
+
+
+/******************************************************************************/
+/************************ "private" API FUNCTIONS *****************************/
+/******************************************************************************/
+
+/**
+ * create new arena
+ *
+ * @param chunksize size of first chunk in bytes (0 for default)
+ * @result new Arena or NULL
+ */
+Arena *_arena_new(size_t chunksize)
+{
+        Arena *a;
+        if(!(a = calloc(1, sizeof(Arena))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        a->chunksize = chunksize ? _align(chunksize) : ARENA_DEFAULT_CHUNKSIZE;
+
+        return a;
+}
+
+
+/**
+ * free arena and every block ever allocated from it
+ *
+ * @param a Arena
+ */
+void _arena_destroy(Arena * a)
+{
+        if(!a)
+                return;
+
+        NFT_LOG(L_DEBUG, "Destroying arena with %lu bytes allocated",
+                (unsigned long) a->allocated);
+
+        /* don't leave a dangling pointer to this arena */
+        if(_current == a)
+                _current = NULL;
+
+        ArenaChunk *c, *prev;
+        for(c = a->chunk; c; c = prev)
+        {
+                prev = c->prev;
+                free(c);
+        }
+
+        free(a);
+}
+
+
+/**
+ * set arena that allocations of the calling thread should be carved from
+ *
+ * @param a Arena or NULL to allocate from heap
+ * @result previously active Arena (or NULL)
+ */
+Arena *_arena_set_current(Arena * a)
+{
+        Arena *r = _current;
+        _current = a;
+        return r;
+}
+
+
+/**
+ * get amount of bytes handed out by an arena
+ *
+ * @param a Arena
+ * @result bytes allocated
+ */
+size_t _arena_get_size(Arena * a)
+{
+        if(!a)
+                NFT_LOG_NULL(0);
+
+        return a->allocated;
+}
+
+
+/**
+ * malloc() replacement (block will be zeroed)
+ *
+ * @param size size in bytes
+ * @result pointer to new block or NULL
+ */
+void *_arena_malloc(size_t size)
+{
+        if(_current)
+                return _arena_alloc(_current, size);
+
+        return _heap_alloc(size);
+}
+
+
+/**
+ * calloc() replacement
+ *
+ * @param nmemb amount of elements
+ * @param size size of one element
+ * @result pointer to new block or NULL
+ */
+void *_arena_calloc(size_t nmemb, size_t size)
+{
+        if(size && nmemb > SIZE_MAX / size)
+        {
+                NFT_LOG(L_ERROR, "allocation size overflow");
+                return NULL;
+        }
+
+        return _arena_malloc(nmemb * size);
+}
+
+
+/**
+ * realloc() replacement for blocks allocated by _arena_*alloc()
+ *
+ * @param ptr block to resize or NULL
+ * @param size new size in bytes
+ * @result pointer to resized block or NULL (ptr stays valid in that case)
+ * @note new memory is zeroed
+ */
+void *_arena_realloc(void *ptr, size_t size)
+{
+        if(!ptr)
+                return _arena_malloc(size);
+
+        ArenaBlock *b = _block(ptr);
+        size_t old = b->block.size;
+
+        /* block still large enough? */
+        if(size <= old)
+                return ptr;
+
+        /* heap blocks are resized by the system allocator */
+        if(!b->block.arena)
+        {
+                ArenaBlock *n;
+                if(!(n = realloc(b, ARENA_BLOCK_HEADER + size)))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NULL;
+                }
+
+                memset((char *) _block_data(n) + old, 0, size - old);
+                n->block.size = size;
+
+                return _block_data(n);
+        }
+
+        /* last block of current chunk can grow in place */
+        Arena *a = b->block.arena;
+        ArenaChunk *c = a->chunk;
+        char *end = (char *) ptr + old;
+        size_t grow = _align(size) - old;
+        if(end == _chunk_data(c) + c->used && c->size - c->used >= grow)
+        {
+                memset(end, 0, grow);
+                c->used += grow;
+                a->allocated += grow;
+                b->block.size += grow;
+                return ptr;
+        }
+
+        /* copy to a new block of the same arena (old block is released
+         * with the arena) */
+        void *r;
+        if(!(r = _arena_alloc(a, size)))
+                return NULL;
+
+        memcpy(r, ptr, old);
+
+        return r;
+}
+
+
+/**
+ * free() replacement for blocks allocated by _arena_*alloc()
+ *
+ * @param ptr block or NULL
+ * @note blocks carved from an arena are released by _arena_destroy()
+ */
+void _arena_free(void *ptr)
+{
+        if(!ptr)
+                return;
+
+        ArenaBlock *b = _block(ptr);
+
+        /* arena block? */
+        if(b->block.arena)
+                return;
+
+        free(b);
+}
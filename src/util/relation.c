@@ -46,16 +46,214 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
 #include <niftylog.h>
 #include "_relation.h"
 
 
 
+/** helper macro */
+#define MAX(a,b) (((a)>(b))?(a):(b))
+
+
+/** relaxed atomic increment of generation counter */
+#define GENERATION_BUMP()       __atomic_add_fetch(&_generation, 1, __ATOMIC_RELAXED)
+/** relaxed atomic read of generation counter */
+#define GENERATION()            __atomic_load_n(&_generation, __ATOMIC_RELAXED)
+
+
+/**
+ * incremented whenever any relation changes (invalidates RelationTrees).
+ * Objects of all setups share it and may be (un)linked from different
+ * threads, so it's only accessed atomically.
+ */
+static unsigned long _generation;
+
 
 /******************************************************************************/
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
+/** get list descriptor of an object, create it if object has none, yet */
+static RelationList *_list(Relation * r)
+{
+        if(r->list)
+                return r->list;
+
+        /* object has no siblings, yet */
+        RelationList *l;
+        if(!(l = calloc(1, sizeof(RelationList))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+        l->head = r;
+        l->last = r;
+        l->count = 1;
+
+        r->list = l;
+        r->pos = 0;
+
+        return l;
+}
+
+
+/** free list descriptor */
+static void _list_free(RelationList * l)
+{
+        if(!l)
+                return;
+
+        free(l->index);
+        free(l);
+}
+
+
+/**
+ * detach object and all following siblings from the list it's part of.
+ * Preceding siblings keep the list.
+ */
+static void _list_detach(Relation * r)
+{
+        RelationList *l = r->list;
+
+        /* split linked-list */
+        r->prev->next = NULL;
+        l->last = r->prev;
+        r->prev = NULL;
+
+        Relation *t;
+        for(t = r; t; t = t->next)
+        {
+                t->list = NULL;
+                l->count--;
+        }
+
+        l->indexvalid = false;
+
+        /* remaining sibling doesn't need a list anymore */
+        if(l->count <= 1)
+        {
+                l->head->list = NULL;
+                _list_free(l);
+        }
+}
+
+
+/** make sure index of list matches the linked-list */
+static NftResult _list_index(RelationList * l)
+{
+        if(l->indexvalid)
+                return NFT_SUCCESS;
+
+        /* grow index geometrically */
+        if(l->count > l->indexsize)
+        {
+                int size = MAX(l->count, l->indexsize * 2);
+
+                Relation **index;
+                if(!(index = realloc(l->index, size * sizeof(Relation *))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+
+                l->index = index;
+                l->indexsize = size;
+        }
+
+        /* register all siblings */
+        Relation *t;
+        int i;
+        for(t = l->head, i = 0; t; t = t->next, i++)
+        {
+                l->index[i] = t;
+                t->pos = i;
+        }
+
+        l->indexvalid = true;
+
+        return NFT_SUCCESS;
+}
+
+
+/** push object onto traversal stack */
+static NftResult _stack_push(RelationStack * s, Relation * r, int parent)
+{
+        /* grow stack geometrically */
+        if(s->count >= s->size)
+        {
+                int size = MAX(16, s->size * 2);
+
+                RelationStackEntry *entries;
+                if(!(entries = realloc(s->entries,
+                                       size * sizeof(RelationStackEntry))))
+                {
+                        NFT_LOG_PERROR("realloc");
+                        return NFT_FAILURE;
+                }
+
+                s->entries = entries;
+                s->size = size;
+        }
+
+        s->entries[s->count].r = r;
+        s->entries[s->count].parent = parent;
+        s->entries[s->count].expanded = false;
+        s->count++;
+
+        return NFT_SUCCESS;
+}
+
+
+/** grow arrays of a RelationTree so it can hold count nodes */
+static NftResult _tree_resize(RelationTree * t, int count)
+{
+        if(count <= t->size)
+                return NFT_SUCCESS;
+
+        int size = MAX(count, t->size * 2);
+
+        Relation **nodes;
+        if(!(nodes = realloc(t->nodes, size * sizeof(Relation *))))
+                goto _tr_error;
+        t->nodes = nodes;
+
+        int *parents;
+        if(!(parents = realloc(t->parents, size * sizeof(int))))
+                goto _tr_error;
+        t->parents = parents;
+
+        int *post;
+        if(!(post = realloc(t->post, size * sizeof(int))))
+                goto _tr_error;
+        t->post = post;
+
+        t->size = size;
+
+        return NFT_SUCCESS;
+
+_tr_error:
+        NFT_LOG_PERROR("realloc");
+        return NFT_FAILURE;
+}
+
+
+/** get position of object in its list or -1 upon error */
+static int _position(Relation * r)
+{
+        /* object without siblings */
+        if(!r->list)
+                return 0;
+
+        if(!_list_index(r->list))
+                return -1;
+
+        return r->pos;
+}
+
 
 /******************************************************************************/
 /************************ "private" API FUNCTIONS *****************************/
@@ -132,15 +330,11 @@ Relation *_relation_first(Relation * r)
         if(!r)
                 NFT_LOG_NULL(NULL);
 
-        /* take the shortcut? */
-        if(r->parent)
-                /* first child of parent == head of this list */
-                return r->parent->child;
-
-        Relation *first;
-        for(first = r; first->prev; first = first->prev);
+        /* object without siblings */
+        if(!r->list)
+                return r;
 
-        return first;
+        return r->list->head;
 }
 
 
@@ -155,17 +349,18 @@ Relation *_relation_last(Relation * r)
         if(!r)
                 NFT_LOG_NULL(NULL);
 
-        Relation *last;
-        for(last = r; last->next; last = last->next);
+        /* object without siblings */
+        if(!r->list)
+                return r;
 
-        return last;
+        return r->list->last;
 }
 
 
 /**
  * get nth sibling of this object
  *
- * @param h a LedHardware (probably the head of a linked list ;)
+ * @param r a relation (probably the head of a linked list ;)
  * @param n position in list (starting from 0)
  * @result object at position n in list starting from r or NULL upon error
  */
@@ -177,7 +372,19 @@ Relation *_relation_nth(Relation * r, int n)
         if(n == 0)
                 return r;
 
-        return _relation_nth(r, n - 1);
+        /* object without siblings */
+        if(!r->list || n < 0)
+                return NULL;
+
+        /* get position of r in list */
+        int pos;
+        if((pos = _position(r)) < 0)
+                return NULL;
+
+        if(pos + n >= r->list->count)
+                return NULL;
+
+        return r->list->index[pos + n];
 }
 
 
@@ -193,26 +400,67 @@ NftResult _relation_append(Relation * p, Relation * s)
         if(!p)
                 NFT_LOG_NULL(NFT_FAILURE);
 
-        Relation *last;
-        if(!(last = _relation_last(p)))
+        RelationList *l;
+        if(!(l = _list(p)))
                 return NFT_FAILURE;
 
+        Relation *last = l->last;
         if(last == s)
         {
                 NFT_LOG(L_ERROR, "Attempt to make us our own child");
                 return NFT_FAILURE;
         }
 
+        /* nothing to append */
+        if(!s)
+                return NFT_SUCCESS;
+
+        if(s->list == l)
+        {
+                NFT_LOG(L_ERROR, "Object is already part of this list");
+                return NFT_FAILURE;
+        }
+
+        GENERATION_BUMP();
+
+        /* s and its following siblings leave their list. The list is only
+         * freed below if no preceding sibling keeps using it */
+        RelationList *old = s->list;
+        if(old && s->prev)
+        {
+                _list_detach(s);
+                old = NULL;
+        }
+
         /* register next */
         last->next = s;
 
         /* register previous */
-        if(s)
+        s->prev = last;
+
+        /* s and its siblings become part of our list */
+        Relation *t;
+        for(t = s; t; t = t->next)
         {
-                s->prev = last;
-                s->parent = last->parent;
+                t->list = l;
+                t->parent = last->parent;
+                l->last = t;
+                l->count++;
+
+                /* keep index valid if it's large enough */
+                if(l->indexvalid && l->count <= l->indexsize)
+                {
+                        l->index[l->count - 1] = t;
+                        t->pos = l->count - 1;
+                }
+                else
+                {
+                        l->indexvalid = false;
+                }
         }
 
+        _list_free(old);
+
         return NFT_SUCCESS;
 }
 
@@ -246,6 +494,8 @@ NftResult _relation_append_child(Relation * p, Relation * c)
         /* set parent */
         c->parent = p;
 
+        GENERATION_BUMP();
+
         return NFT_SUCCESS;
 }
 
@@ -274,6 +524,29 @@ void _relation_unlink(Relation * r)
         if(!r)
                 NFT_LOG_NULL();
 
+        /* update list bookkeeping */
+        RelationList *l;
+        if((l = r->list))
+        {
+                /* last sibling left? */
+                if(--l->count <= 1)
+                {
+                        /* remaining sibling doesn't need a list anymore */
+                        Relation *other = r->next ? r->next : r->prev;
+                        if(other)
+                                other->list = NULL;
+                        _list_free(l);
+                }
+                else
+                {
+                        if(l->head == r)
+                                l->head = r->next;
+                        if(l->last == r)
+                                l->last = r->prev;
+                        l->indexvalid = false;
+                }
+        }
+
         /* unlink from linked-list of siblings */
         if(r->next)
                 r->next->prev = r->prev;
@@ -292,23 +565,31 @@ void _relation_unlink(Relation * r)
         /* clear structure */
         _relation_clear(r);
 
+        GENERATION_BUMP();
 }
 
 
 /**
- * get amount of siblings this object has
+ * get amount of siblings following this object
  *
  * @param r object relation
  * @result amount of siblings r has
  */
 int _relation_sibling_count(Relation * r)
 {
-        Relation *t = r;
-        int i;
-        for(i = 0; t; i++)
-                t = t->next;
+        if(!r)
+                return -1;
+
+        /* object without siblings */
+        if(!r->list)
+                return 0;
 
-        return i - 1;
+        /* position of head is always 0 */
+        int pos = 0;
+        if(r != r->list->head && (pos = _position(r)) < 0)
+                return -1;
+
+        return r->list->count - pos - 1;
 }
 
 
@@ -339,9 +620,268 @@ NftResult _relation_foreach(Relation * r,
 }
 
 
+/**
+ * do something for this object, all siblings and all their descendants
+ * (pre-order)
+ *
+ * @param r object
+ * @param func foreach function
+ * @param userptr arbitrary pointer passed to func
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
 NftResult _relation_foreach_recursive(Relation * r,
                                       NftResult(*func) (Relation * r,
-                                                        void *userptr));
+                                                        void *userptr),
+                                      void *userptr)
+{
+        RelationStack s = { 0 };
+
+        NftResult result = _relation_foreach_preorder(r, &s, func, userptr);
+
+        _relation_stack_free(&s);
+
+        return result;
+}
+
+
+/**
+ * iteratively do something for this object, all siblings and all their
+ * descendants. Every object is processed before its children.
+ *
+ * @param r object
+ * @param s stack to use for traversal (keep it to avoid reallocations)
+ * @param func foreach function
+ * @param userptr arbitrary pointer passed to func
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _relation_foreach_preorder(Relation * r, RelationStack * s,
+                                     NftResult(*func) (Relation * r,
+                                                       void *userptr),
+                                     void *userptr)
+{
+        if(!s || !func)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(!r)
+                return NFT_SUCCESS;
+
+        s->count = 0;
+        if(!_stack_push(s, r, -1))
+                return NFT_FAILURE;
+
+        while(s->count > 0)
+        {
+                Relation *t = s->entries[--s->count].r;
+
+                if(!func(t, userptr))
+                        return NFT_FAILURE;
+
+                /* next sibling is processed after all descendants */
+                if(t->next && !_stack_push(s, t->next, -1))
+                        return NFT_FAILURE;
+
+                if(t->child && !_stack_push(s, t->child, -1))
+                        return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * iteratively do something for this object, all siblings and all their
+ * descendants. Every object is processed after its children, so func may
+ * unlink or destroy the object it's called for.
+ *
+ * @param r object
+ * @param s stack to use for traversal (keep it to avoid reallocations)
+ * @param func foreach function
+ * @param userptr arbitrary pointer passed to func
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _relation_foreach_postorder(Relation * r, RelationStack * s,
+                                      NftResult(*func) (Relation * r,
+                                                        void *userptr),
+                                      void *userptr)
+{
+        if(!s || !func)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        if(!r)
+                return NFT_SUCCESS;
+
+        s->count = 0;
+        if(!_stack_push(s, r, -1))
+                return NFT_FAILURE;
+
+        while(s->count > 0)
+        {
+                RelationStackEntry *e = &s->entries[s->count - 1];
+
+                /* process children first */
+                if(!e->expanded)
+                {
+                        e->expanded = true;
+                        if(e->r->child && !_stack_push(s, e->r->child, -1))
+                                return NFT_FAILURE;
+                        continue;
+                }
+
+                /* all children processed */
+                Relation *t = e->r;
+                Relation *next = t->next;
+                s->count--;
+
+                if(!func(t, userptr))
+                        return NFT_FAILURE;
+
+                if(next && !_stack_push(s, next, -1))
+                        return NFT_FAILURE;
+        }
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * free resources of a RelationStack
+ *
+ * @param s RelationStack
+ */
+void _relation_stack_free(RelationStack * s)
+{
+        if(!s)
+                return;
+
+        free(s->entries);
+        memset(s, 0, sizeof(RelationStack));
+}
+
+
+/**
+ * flatten an object and all its descendants (but not its siblings) into a
+ * RelationTree. Nothing is done if no relation changed since the tree was
+ * flattened last time.
+ *
+ * @param t RelationTree
+ * @param root object
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _relation_tree_flatten(RelationTree * t, Relation * root)
+{
+        if(!t || !root)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        /* tree still valid? */
+        unsigned long generation = GENERATION();
+        if(t->count > 0 && t->nodes[0] == root && t->generation == generation)
+                return NFT_SUCCESS;
+
+        t->count = 0;
+
+        /* collect nodes in pre-order */
+        RelationStack *s = &t->stack;
+        s->count = 0;
+        if(!_stack_push(s, root, -1))
+                return NFT_FAILURE;
+
+        while(s->count > 0)
+        {
+                RelationStackEntry e = s->entries[--s->count];
+
+                if(!_tree_resize(t, t->count + 1))
+                        goto _rtf_error;
+
+                int i = t->count++;
+                t->nodes[i] = e.r;
+                t->parents[i] = e.parent;
+
+                /* siblings of root are not part of the tree */
+                if(e.r->next && i > 0 &&
+                   !_stack_push(s, e.r->next, e.parent))
+                        goto _rtf_error;
+
+                if(e.r->child && !_stack_push(s, e.r->child, i))
+                        goto _rtf_error;
+        }
+
+        /* calculate subtree sizes (children come after their parents) */
+        int i;
+        for(i = 0; i < t->count; i++)
+                t->post[i] = 1;
+        for(i = t->count - 1; i > 0; i--)
+                t->post[t->parents[i]] += t->post[i];
+
+        /* post-order position of a node is the last position of its
+         * subtree. Subtrees of earlier siblings come first, so start holds
+         * the position where the subtree of the next child begins. */
+        int *start;
+        if(!(start = malloc(t->count * sizeof(int))))
+        {
+                NFT_LOG_PERROR("malloc");
+                goto _rtf_error;
+        }
+
+        start[0] = 0;
+        for(i = 0; i < t->count; i++)
+        {
+                int size = t->post[i];
+
+                if(i > 0)
+                {
+                        int p = t->parents[i];
+                        start[i] = start[p];
+                        start[p] += size;
+                }
+
+                /* remember end of subtree, children begin at our start */
+                t->post[i] = start[i] + size - 1;
+        }
+
+        /* invert positions */
+        for(i = 0; i < t->count; i++)
+                start[t->post[i]] = i;
+        memcpy(t->post, start, t->count * sizeof(int));
+        free(start);
+
+        t->generation = generation;
+
+        return NFT_SUCCESS;
+
+_rtf_error:
+        t->count = 0;
+        return NFT_FAILURE;
+}
+
+
+/**
+ * free resources of a RelationTree
+ *
+ * @param t RelationTree
+ */
+void _relation_tree_free(RelationTree * t)
+{
+        if(!t)
+                return;
+
+        free(t->nodes);
+        free(t->parents);
+        free(t->post);
+        _relation_stack_free(&t->stack);
+        memset(t, 0, sizeof(RelationTree));
+}
+
+
+/**
+ * get current generation of relations. It changes whenever an object is
+ * linked or unlinked.
+ *
+ * @result generation counter
+ */
+unsigned long _relation_generation()
+{
+        return GENERATION();
+}
 
 
 /******************************************************************************/
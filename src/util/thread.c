@@ -48,25 +48,14 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <time.h>
 #include <niftylog.h>
 #include "_thread.h"
 
 
-#define THREAD_MODEL_POSIX 1
-#define HAVE_THREADS 1
 
-
-
-#ifdef HAVE_THREADS
-#ifdef THREAD_MODEL_POSIX
-#include <pthread.h>
-#elif defined(THREAD_MODEL_GTHREAD2)    /* !THREAD_MODEL_POSIX */
-#include <glib/gthread.h>
-#else /* !THREAD_MODEL_GTHREAD2 */
-
-
-#endif
-#endif /* HAVE_THREADS */
+/** nanoseconds per second */
+#define NSEC_PER_SEC    1000000000LL
 
 
 
@@ -91,30 +80,64 @@ struct _Thread
 
 
 /**
- * The Mutex data structure and the Mutex subsystem is a wrapper system for native
- * thread locking implementations.
+ * The Cond data structure wraps native condition variables. Timeouts are
+ * measured with a monotonic clock (s. _thread_now()).
  */
-struct _Mutex
+struct _Cond
 {
 #ifdef HAVE_THREADS
 #ifdef THREAD_MODEL_POSIX
-        pthread_mutex_t mutex;
-#elif defined(THREAD_MODEL_WIN32)       /* !THREAD_MODEL_POSIX */
-
-#elif defined(THREAD_MODEL_GTHREAD)     /* !THREAD_MODEL_WIN32 */
-        GMutex *mutex;
-        GStaticMutex static_mutex;
-        int static_mutex_used;
+        pthread_cond_t cond;
+#elif defined(THREAD_MODEL_GTHREAD)     /* !THREAD_MODEL_POSIX */
+        GCond *cond;
 #endif
 #endif /* HAVE_THREADS */
 };
 
 
 
+/** state shared by all workers of one _thread_pool_run() */
+typedef struct
+{
+        /** function to run for every job */
+        ThreadJob func;
+        /** userdata for func */
+        void *data;
+        /** total amount of jobs */
+        size_t jobs;
+        /** next job that hasn't been picked by a worker */
+        size_t next;
+        /** protects "next" */
+        Mutex *mutex;
+} Pool;
+
+
+
 /******************************************************************************/
 /**************************** STATIC FUNCTIONS ********************************/
 /******************************************************************************/
 
+/** worker: run jobs until there are none left */
+static void *_pool_worker(void *data)
+{
+        Pool *p = data;
+
+        while(1)
+        {
+                /* pick next job */
+                _thread_mutex_lock(p->mutex);
+                size_t job = p->next++;
+                _thread_mutex_unlock(p->mutex);
+
+                if(job >= p->jobs)
+                        break;
+
+                p->func(job, p->data);
+        }
+
+        return NULL;
+}
+
 
 /******************************************************************************/
 /************************ "private" API FUNCTIONS *****************************/
@@ -124,7 +147,7 @@ Thread *_thread_create(ThreadFunc func, void *data, bool joinable)
 {
         Thread *thread = NULL;
 
-        if(!(thread = calloc(0, sizeof(Thread))))
+        if(!(thread = calloc(1, sizeof(Thread))))
         {
                 NFT_LOG_PERROR("calloc");
                 return NULL;
@@ -270,6 +293,204 @@ NftResult _thread_mutex_unlock(Mutex * mutex)
 }
 
 
+/**
+ * Creates a new condition variable. Timeouts of _thread_cond_timedwait()
+ * are measured with the monotonic clock of _thread_now().
+ *
+ * @note use _thread_cond_free() to finalize the Cond
+ * @result newly allocated Cond or NULL on failure
+ */
+Cond *_thread_cond_new(void)
+{
+        Cond *r;
+        if(!(r = calloc(1, sizeof(Cond))))
+        {
+                NFT_LOG_PERROR("calloc");
+                return NULL;
+        }
+
+#if defined(THREAD_MODEL_POSIX)
+        pthread_condattr_t attr;
+        int res;
+        pthread_condattr_init(&attr);
+        if((res = pthread_condattr_setclock(&attr, CLOCK_MONOTONIC)) == 0)
+                res = pthread_cond_init(&r->cond, &attr);
+        pthread_condattr_destroy(&attr);
+
+        if(res != 0)
+        {
+                NFT_LOG(L_ERROR, "failed to init condition variable");
+                free(r);
+                return NULL;
+        }
+#endif
+
+        return r;
+}
+
+
+/**
+ * free condition variable (no thread may wait for it anymore)
+ *
+ * @param cond Cond to free
+ */
+void _thread_cond_free(Cond * cond)
+{
+        if(!cond)
+                return;
+
+#if defined(THREAD_MODEL_POSIX)
+        pthread_cond_destroy(&cond->cond);
+#endif
+
+        free(cond);
+}
+
+
+/**
+ * unlock mutex, wait until cond is signalled & lock mutex again
+ *
+ * @param cond Cond to wait for
+ * @param mutex locked Mutex that protects the condition
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _thread_cond_wait(Cond * cond, Mutex * mutex)
+{
+#if defined(THREAD_MODEL_POSIX)
+        if(pthread_cond_wait(&cond->cond, &mutex->mutex) != 0)
+                return NFT_FAILURE;
+#endif
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * like _thread_cond_wait() but return at "deadline" at the latest
+ *
+ * @param cond Cond to wait for
+ * @param mutex locked Mutex that protects the condition
+ * @param deadline absolute time in ns (s. _thread_now())
+ * @result NFT_SUCCESS if cond was signalled, NFT_FAILURE upon timeout or
+ * error (mutex is locked in any case)
+ */
+NftResult _thread_cond_timedwait(Cond * cond, Mutex * mutex,
+                                 long long deadline)
+{
+#if defined(THREAD_MODEL_POSIX)
+        struct timespec t = {
+                .tv_sec = deadline / NSEC_PER_SEC,
+                .tv_nsec = deadline % NSEC_PER_SEC
+        };
+
+        if(pthread_cond_timedwait(&cond->cond, &mutex->mutex, &t) != 0)
+                return NFT_FAILURE;
+#endif
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * wake up one thread waiting for cond
+ *
+ * @param cond Cond to signal
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _thread_cond_signal(Cond * cond)
+{
+#if defined(THREAD_MODEL_POSIX)
+        if(pthread_cond_signal(&cond->cond) != 0)
+                return NFT_FAILURE;
+#endif
+
+        return NFT_SUCCESS;
+}
+
+
+/**
+ * current time of the clock used by _thread_cond_timedwait()
+ *
+ * @result nanoseconds of monotonic clock
+ */
+long long _thread_now(void)
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (long long) t.tv_sec * NSEC_PER_SEC + t.tv_nsec;
+}
+
+
+/**
+ * run func(job, data) for every job = 0..jobs-1 on up to "threads" threads
+ * and return after all jobs finished.
+ *
+ * Jobs are picked in ascending order but may finish in any order. The
+ * calling thread works on jobs as well, so this never fails to make
+ * progress even if no thread could be created.
+ *
+ * @param func function to run for every job
+ * @param data userdata passed to func
+ * @param jobs amount of jobs
+ * @param threads maximum amount of threads to use (including caller)
+ * @result NFT_SUCCESS or NFT_FAILURE
+ */
+NftResult _thread_pool_run(ThreadJob func, void *data, size_t jobs,
+                           size_t threads)
+{
+        if(!func)
+                NFT_LOG_NULL(NFT_FAILURE);
+
+        Pool p = {.func = func,.data = data,.jobs = jobs,.next = 0 };
+
+        if(!(p.mutex = _thread_mutex_new()))
+                return NFT_FAILURE;
+
+        /* never start more threads than jobs */
+        if(threads > jobs)
+                threads = jobs;
+
+        /* start additional workers */
+        Thread **workers = NULL;
+        size_t started = 0;
+        if(threads > 1)
+        {
+                if(!(workers = calloc(threads - 1, sizeof(Thread *))))
+                {
+                        NFT_LOG_PERROR("calloc");
+                }
+                else
+                {
+                        for(started = 0; started < threads - 1; started++)
+                        {
+                                if(!(workers[started] =
+                                     _thread_create(_pool_worker, &p, true)))
+                                        break;
+                        }
+                }
+        }
+
+        /* work in this thread as well */
+        _pool_worker(&p);
+
+        /* wait for all workers */
+        size_t i;
+        for(i = 0; i < started; i++)
+        {
+                _thread_join(workers[i]);
+                _thread_free(workers[i]);
+        }
+
+        free(workers);
+
+        /* _thread_mutex_free() expects a locked mutex */
+        _thread_mutex_lock(p.mutex);
+        _thread_mutex_free(p.mutex);
+
+        return NFT_SUCCESS;
+}
+
+
 /******************************************************************************/
 /**************************** API FUNCTIONS ***********************************/
 /******************************************************************************/
@@ -0,0 +1,357 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <time.h>
+#include <pthread.h>
+#include <niftyled.h>
+
+
+/**
+ * check order of frames & counters of every LedFrameQueue policy, waiting
+ * in led_frame_queue_take() and rejection of frames that are passed back in
+ * the wrong state.
+ */
+
+
+/** maximum amount of pending frames */
+#define DEPTH           2
+/** frames submitted in a row */
+#define FRAMES          5
+/** delay of producer thread (ns) */
+#define DELAY           20000000LL
+
+
+
+/** current time of monotonic clock in ns */
+static long long _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+/** new queue of tiny frames */
+static LedFrameQueue *_queue(LedFrameQueuePolicy policy)
+{
+        return led_frame_queue_new(2, 2,
+                                   led_pixel_format_from_string("RGB u8"),
+                                   DEPTH, policy);
+}
+
+
+/** acquire frame, mark it with "id" & submit it */
+static bool _put(LedFrameQueue * q, unsigned char id)
+{
+        LedFrame *f;
+        if(!(f = led_frame_queue_acquire(q)))
+                return false;
+
+        *(unsigned char *) led_frame_get_buffer(f) = id;
+
+        return led_frame_queue_submit(q, f);
+}
+
+
+/** id of a frame */
+static int _id(LedFrame * f)
+{
+        return *(unsigned char *) led_frame_get_buffer(f);
+}
+
+
+/** check counters of queue */
+static bool _counters(LedFrameQueue * q, int pending,
+                      unsigned long long submitted,
+                      unsigned long long presented,
+                      unsigned long long dropped)
+{
+        if(led_frame_queue_get_pending(q) != pending ||
+           led_frame_queue_get_submitted(q) != submitted ||
+           led_frame_queue_get_presented(q) != presented ||
+           led_frame_queue_get_dropped(q) != dropped)
+        {
+                fprintf(stderr, "got pending=%d submitted=%llu "
+                        "presented=%llu dropped=%llu, expected %d %llu %llu "
+                        "%llu\n", led_frame_queue_get_pending(q),
+                        led_frame_queue_get_submitted(q),
+                        led_frame_queue_get_presented(q),
+                        led_frame_queue_get_dropped(q), pending, submitted,
+                        presented, dropped);
+                return false;
+        }
+
+        return true;
+}
+
+
+/** submit frames 1..FRAMES, then take all & compare order with "expected" */
+static bool _policy(LedFrameQueuePolicy policy, const int *expected,
+                    int n)
+{
+        LedFrameQueue *q;
+        if(!(q = _queue(policy)))
+                return false;
+
+        bool result = false;
+
+        int i;
+        for(i = 1; i <= FRAMES; i++)
+        {
+                if(!_put(q, i))
+                        goto _p_end;
+        }
+
+        if(!_counters(q, DEPTH, FRAMES, 0, FRAMES - DEPTH))
+                goto _p_end;
+
+        LedFrame *f;
+        for(i = 0; (f = led_frame_queue_take(q, 0)); i++)
+        {
+                if(i >= n || _id(f) != expected[i])
+                {
+                        fprintf(stderr, "policy %d: frame %d is %d\n",
+                                policy, i, _id(f));
+                        goto _p_end;
+                }
+
+                if(!led_frame_queue_release(q, f))
+                        goto _p_end;
+        }
+
+        if(i != n || !_counters(q, 0, FRAMES, n, FRAMES - n))
+                goto _p_end;
+
+        result = true;
+
+_p_end:
+        led_frame_queue_destroy(q);
+        return result;
+}
+
+
+/** thread that submits a frame after DELAY */
+static void *_producer(void *data)
+{
+        struct timespec t = {.tv_sec = 0,.tv_nsec = DELAY };
+        nanosleep(&t, NULL);
+
+        _put(data, 42);
+
+        return NULL;
+}
+
+
+/** take() with timeout while another thread submits a frame */
+static bool _take_wait(long long timeout)
+{
+        LedFrameQueue *q;
+        if(!(q = _queue(LED_FRAME_QUEUE_DROP_OLDEST)))
+                return false;
+
+        pthread_t t;
+        if(pthread_create(&t, NULL, _producer, q) != 0)
+        {
+                led_frame_queue_destroy(q);
+                return false;
+        }
+
+        long long start = _now();
+        LedFrame *f = led_frame_queue_take(q, timeout);
+        long long waited = _now() - start;
+
+        pthread_join(t, NULL);
+
+        bool result = (f && _id(f) == 42 && waited >= DELAY / 2);
+        if(!result)
+                fprintf(stderr, "take(%lld) got %p after %lld ns\n",
+                        timeout, (void *) f, waited);
+
+        led_frame_queue_release(q, f);
+        led_frame_queue_destroy(q);
+
+        return result;
+}
+
+
+/** take() with timeout on empty queue */
+static bool _take_timeout()
+{
+        LedFrameQueue *q;
+        if(!(q = _queue(LED_FRAME_QUEUE_DROP_OLDEST)))
+                return false;
+
+        bool result = false;
+
+        /* don't wait */
+        long long start = _now();
+        if(led_frame_queue_take(q, 0) || _now() - start >= DELAY)
+        {
+                fprintf(stderr, "take(0) waited or returned a frame\n");
+                goto _tt_end;
+        }
+
+        /* wait until timeout */
+        start = _now();
+        if(led_frame_queue_take(q, DELAY) || _now() - start < DELAY)
+        {
+                fprintf(stderr, "take(%lld) returned too early\n", DELAY);
+                goto _tt_end;
+        }
+
+        result = true;
+
+_tt_end:
+        led_frame_queue_destroy(q);
+        return result;
+}
+
+
+/** frames passed back in the wrong state are rejected */
+static bool _states()
+{
+        LedFrameQueue *q, *other;
+        if(!(q = _queue(LED_FRAME_QUEUE_DROP_NEWEST)))
+                return false;
+        if(!(other = _queue(LED_FRAME_QUEUE_DROP_NEWEST)))
+        {
+                led_frame_queue_destroy(q);
+                return false;
+        }
+
+        bool result = false;
+
+        LedFrame *a, *b, *foreign;
+        if(!(a = led_frame_queue_acquire(q)) ||
+           !(foreign = led_frame_queue_acquire(other)))
+                goto _s_end;
+
+        /* acquired frame can't be released & foreign frame not submitted */
+        if(led_frame_queue_release(q, a) ||
+           led_frame_queue_submit(q, foreign))
+        {
+                fprintf(stderr, "frame in wrong state accepted\n");
+                goto _s_end;
+        }
+
+        /* submit once */
+        if(!led_frame_queue_submit(q, a) || led_frame_queue_submit(q, a))
+        {
+                fprintf(stderr, "frame submitted twice\n");
+                goto _s_end;
+        }
+
+        /* pending frame can't be released */
+        if(led_frame_queue_release(q, a))
+        {
+                fprintf(stderr, "pending frame released\n");
+                goto _s_end;
+        }
+
+        /* release once */
+        if(!(b = led_frame_queue_take(q, 0)) || b != a ||
+           !led_frame_queue_release(q, b) || led_frame_queue_release(q, b))
+        {
+                fprintf(stderr, "frame released twice\n");
+                goto _s_end;
+        }
+
+        if(!_counters(q, 0, 1, 1, 0))
+                goto _s_end;
+
+        /* rejected frames didn't end up in the pool: only DEPTH + 2 frames
+         * can be acquired */
+        int i;
+        for(i = 0; i < DEPTH + 2; i++)
+        {
+                if(!led_frame_queue_acquire(q))
+                        goto _s_end;
+        }
+        if(led_frame_queue_acquire(q))
+        {
+                fprintf(stderr, "acquired more frames than queue owns\n");
+                goto _s_end;
+        }
+
+        result = true;
+
+_s_end:
+        led_frame_queue_destroy(other);
+        led_frame_queue_destroy(q);
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        /* rejected frames log errors, only show fatal ones */
+        if(!nft_log_level_set(L_FATAL))
+                return EXIT_FAILURE;
+
+        const int oldest[] = { 4, 5 };
+        const int newest[] = { 1, 2 };
+        const int mailbox[] = { 5 };
+
+        if(!_policy(LED_FRAME_QUEUE_DROP_OLDEST, oldest, 2) ||
+           !_policy(LED_FRAME_QUEUE_DROP_NEWEST, newest, 2) ||
+           !_policy(LED_FRAME_QUEUE_MAILBOX, mailbox, 1))
+                return EXIT_FAILURE;
+
+        if(!_take_timeout() ||
+           !_take_wait(-1) ||
+           !_take_wait(DELAY * 50) ||
+           !_take_wait(LLONG_MAX))
+                return EXIT_FAILURE;
+
+        if(!_states())
+                return EXIT_FAILURE;
+
+        return EXIT_SUCCESS;
+}
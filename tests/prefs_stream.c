@@ -0,0 +1,432 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <niftyled.h>
+
+
+/**
+ * generate a setup with 100k LEDs, load it with the DOM based loader and
+ * with the streaming loader, compare both setups and print how long each
+ * loader took. Also checks that the streaming loader rejects attributes
+ * that are no valid integers.
+ */
+
+
+/** config file that's generated */
+#define CONFIG          "prefs_stream.xml"
+/** amount of hardware in generated setup */
+#define HARDWARE        4
+/** LEDs per hardware */
+#define LEDS            25000
+/** width of LED matrix of one hardware */
+#define WIDTH           250
+
+
+
+/** current time in seconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec + (double) t.tv_nsec / 1e9;
+}
+
+
+/** write setup with HARDWARE * LEDS LEDs */
+static bool _generate(const char *filename)
+{
+        FILE *f;
+        if(!(f = fopen(filename, "w")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        fprintf(f, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                "<niftyled>\n");
+
+        int h;
+        for(h = 0; h < HARDWARE; h++)
+        {
+                fprintf(f, "<hardware name=\"hw%d\" plugin=\"capture\" "
+                        "id=\"capture%d\" stride=\"%d\">\n"
+                        "<chain ledcount=\"%d\" pixel_format=\"RGB u8\"/>\n"
+                        "<tile x=\"%d\" y=\"0\" rotation=\"%d\" "
+                        "pivot_x=\"0.5\" pivot_y=\"0.5\">\n"
+                        "<tile x=\"0\" y=\"1\" rotation=\"0\" "
+                        "pivot_x=\"0\" pivot_y=\"0\">\n"
+                        "<chain ledcount=\"%d\" pixel_format=\"RGB u8\">\n",
+                        h, h, h, LEDS, h * WIDTH, h * 90, LEDS);
+
+                int i;
+                for(i = 0; i < LEDS; i++)
+                        fprintf(f, "<led x=\"%d\" y=\"%d\" component=\"%d\" "
+                                "gain=\"%d\"/>\n", i % WIDTH, i / WIDTH,
+                                i % 3, (i * 7) % 65536);
+
+                fprintf(f, "</chain>\n</tile>\n</tile>\n</hardware>\n");
+        }
+
+        fprintf(f, "</niftyled>\n");
+
+        if(fclose(f) != 0)
+        {
+                perror("fclose");
+                return false;
+        }
+
+        return true;
+}
+
+
+/** compare two chains */
+static bool _chain_equal(LedChain * a, LedChain * b)
+{
+        if(!a || !b)
+                return a == b;
+
+        if(led_chain_get_ledcount(a) != led_chain_get_ledcount(b))
+                return false;
+
+        LedCount i;
+        for(i = 0; i < led_chain_get_ledcount(a); i++)
+        {
+                Led *la = led_chain_get_nth(a, i);
+                Led *lb = led_chain_get_nth(b, i);
+                LedFrameCord xa, ya, xb, yb;
+                led_get_pos(la, &xa, &ya);
+                led_get_pos(lb, &xb, &yb);
+
+                if(xa != xb || ya != yb ||
+                   led_get_component(la) != led_get_component(lb) ||
+                   led_get_gain(la) != led_get_gain(lb))
+                {
+                        fprintf(stderr, "LED %ld differs\n", i);
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
+/** compare two lists of tiles (including children) */
+static bool _tiles_equal(LedTile * a, LedTile * b)
+{
+        for(; a && b;
+            a = led_tile_list_get_next(a), b = led_tile_list_get_next(b))
+        {
+                LedFrameCord xa, ya, xb, yb;
+                double pxa, pya, pxb, pyb;
+                led_tile_get_pos(a, &xa, &ya);
+                led_tile_get_pos(b, &xb, &yb);
+                led_tile_get_pivot(a, &pxa, &pya);
+                led_tile_get_pivot(b, &pxb, &pyb);
+
+                if(xa != xb || ya != yb || pxa != pxb || pya != pyb ||
+                   led_tile_get_rotation(a) != led_tile_get_rotation(b))
+                {
+                        fprintf(stderr, "tile differs\n");
+                        return false;
+                }
+
+                if(!_chain_equal(led_tile_get_chain(a), led_tile_get_chain(b))
+                   || !_tiles_equal(led_tile_get_child(a),
+                                    led_tile_get_child(b)))
+                        return false;
+        }
+
+        return !a && !b;
+}
+
+
+/** compare two setups */
+static bool _setup_equal(LedSetup * a, LedSetup * b)
+{
+        LedHardware *ha = led_setup_get_hardware(a);
+        LedHardware *hb = led_setup_get_hardware(b);
+
+        for(; ha && hb;
+            ha = led_hardware_list_get_next(ha),
+            hb = led_hardware_list_get_next(hb))
+        {
+                if(strcmp(led_hardware_get_name(ha),
+                          led_hardware_get_name(hb)) != 0 ||
+                   strcmp(led_hardware_plugin_get_family(ha),
+                          led_hardware_plugin_get_family(hb)) != 0 ||
+                   strcmp(led_hardware_get_id(ha),
+                          led_hardware_get_id(hb)) != 0 ||
+                   led_hardware_get_stride(ha) != led_hardware_get_stride(hb))
+                {
+                        fprintf(stderr, "hardware \"%s\" differs\n",
+                                led_hardware_get_name(ha));
+                        return false;
+                }
+
+                if(led_chain_get_ledcount(led_hardware_get_chain(ha)) !=
+                   led_chain_get_ledcount(led_hardware_get_chain(hb)))
+                {
+                        fprintf(stderr, "chain of \"%s\" differs\n",
+                                led_hardware_get_name(ha));
+                        return false;
+                }
+
+                if(!_tiles_equal(led_hardware_get_tile(ha),
+                                 led_hardware_get_tile(hb)))
+                        return false;
+        }
+
+        if(ha || hb)
+        {
+                fprintf(stderr, "amount of hardware differs\n");
+                return false;
+        }
+
+        return true;
+}
+
+
+/** load setup with one LED that has attribute, check if loading succeeds */
+static bool _attribute(const char *filename, const char *attribute,
+                       bool valid)
+{
+        FILE *f;
+        if(!(f = fopen(filename, "w")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        fprintf(f, "<niftyled>\n"
+                "<hardware name=\"hw\" plugin=\"capture\" id=\"capture\">\n"
+                "<chain ledcount=\"3\" pixel_format=\"RGB u8\"/>\n"
+                "<tile><chain ledcount=\"3\" pixel_format=\"RGB u8\">\n"
+                "<led %s/>\n"
+                "</chain></tile>\n</hardware>\n</niftyled>\n", attribute);
+        fclose(f);
+
+        LedSetup *s = led_prefs_setup_from_file_stream(filename);
+        led_setup_destroy(s);
+
+        if(!s == valid)
+        {
+                fprintf(stderr, "%s setup with <led %s/>\n",
+                        valid ? "failed to load" : "loaded", attribute);
+                return false;
+        }
+
+        return true;
+}
+
+
+/**
+ * load setup with a chain of 3 LEDs that has attributes & child nodes, check
+ * if loading succeeds
+ */
+static bool _chain(LedPrefs * p, const char *filename, const char *attributes,
+                   const char *children, bool valid)
+{
+        FILE *f;
+        if(!(f = fopen(filename, "w")))
+        {
+                perror("fopen");
+                return false;
+        }
+
+        fprintf(f, "<niftyled>\n"
+                "<hardware name=\"hw\" plugin=\"capture\" id=\"capture\">\n"
+                "<chain ledcount=\"3\" pixel_format=\"RGB u8\"/>\n"
+                "<tile><chain ledcount=\"3\" pixel_format=\"RGB u8\" %s>%s"
+                "</chain></tile>\n</hardware>\n</niftyled>\n", attributes,
+                children);
+        fclose(f);
+
+        /* load as stream */
+        LedSetup *s = led_prefs_setup_from_file_stream(filename);
+        led_setup_destroy(s);
+
+        /* load with document tree (keeps what was loaded before an error) */
+        LedPrefsNode *n = led_prefs_node_from_file(p, filename);
+        LedSetup *d = n ? led_prefs_setup_from_node(p, n) : NULL;
+        LedHardware *h = d ? led_setup_get_hardware(d) : NULL;
+        LedTile *t = h ? led_hardware_get_tile(h) : NULL;
+        bool loaded = t && led_tile_get_chain(t);
+        led_setup_destroy(d);
+        if(n)
+                led_prefs_node_free(n);
+
+        if(!s == valid || loaded != valid)
+        {
+                fprintf(stderr, "%s setup with <chain %s>%s</chain>\n",
+                        valid ? "failed to load" : "loaded", attributes,
+                        children);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_ERROR))
+                return EXIT_FAILURE;
+
+        int result = EXIT_FAILURE;
+        LedPrefs *p = NULL;
+        LedPrefsNode *n = NULL;
+        LedSetup *dom = NULL;
+        LedSetup *stream = NULL;
+
+        if(!_generate(CONFIG))
+                goto m_deinit;
+
+        if(!(p = led_prefs_init()))
+                goto m_deinit;
+
+        /* load with document tree */
+        double t = _now();
+        if(!(n = led_prefs_node_from_file(p, CONFIG)) ||
+           !(dom = led_prefs_setup_from_node(p, n)))
+                goto m_deinit;
+        double t_dom = _now() - t;
+
+        /* load as stream */
+        t = _now();
+        if(!(stream = led_prefs_setup_from_file_stream(CONFIG)))
+                goto m_deinit;
+        double t_stream = _now() - t;
+
+        printf("%d LEDs: DOM %.3f s, stream %.3f s\n",
+               HARDWARE * LEDS, t_dom, t_stream);
+
+        if(!_setup_equal(dom, stream))
+                goto m_deinit;
+
+        /* integer attributes */
+        if(!_attribute(CONFIG, "x=\"-12\"", true) ||
+           !_attribute(CONFIG, "y=\"2147483647\"", true) ||
+           !_attribute(CONFIG, "x=\"12abc\"", false) ||
+           !_attribute(CONFIG, "x=\"\"", false) ||
+           !_attribute(CONFIG, "y=\"2147483648\"", false) ||
+           !_attribute(CONFIG, "gain=\"99999999999999999999\"", false))
+                goto m_deinit;
+
+        /* packed arrays */
+        if(!_chain(p, CONFIG, "led_x=\"0 -1 2147483647\"", "", true) ||
+           !_chain(p, CONFIG, "led_x=\"0 1 2\" led_component=\" 2 1 0 \"", "",
+                   true) ||
+           !_chain(p, CONFIG, "led_x=\"0 1 2147483648\"", "", false) ||
+           !_chain(p, CONFIG, "led_x=\"0 1 2\" led_y=\"99999999999999999999\"",
+                   "", false) ||
+           !_chain(p, CONFIG, "led_x=\"0 1 2\" led_component=\"0 -1 2\"", "",
+                   false) ||
+           !_chain(p, CONFIG, "led_x=\"0 1 2\" led_gain=\"0 1 2x\"", "",
+                   false))
+                goto m_deinit;
+
+        /* layout components */
+        if(!_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\"/>", true) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\" "
+                   "components=\"2 1 0\"/>", true) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"3\" height=\"1\" "
+                   "components=\"1\"/>", false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\" "
+                   "components=\"0 1 2 0\"/>", false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\" "
+                   "components=\"0 1 3\"/>", false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\" "
+                   "components=\"0 1 2x\"/>", false))
+                goto m_deinit;
+
+        /* layout properties */
+        if(!_chain(p, CONFIG, "",
+                   "<layout type=\"ring\" count=\" 1 \" radius=\"1.5\" "
+                   "angle=\"90\" x=\"-2\" y=\"2\"/>", true) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1abc\" height=\"1\"/>",
+                   false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"\" height=\"1\"/>",
+                   false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"ring\" count=\"4294967297\" "
+                   "radius=\"1\"/>", false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"ring\" count=\"1\" radius=\"1x\"/>",
+                   false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"ring\" count=\"1\" radius=\"1e999\"/>",
+                   false) ||
+           !_chain(p, CONFIG, "",
+                   "<layout type=\"grid\" width=\"1\" height=\"1\" "
+                   "x=\"2147483648\"/>", false))
+                goto m_deinit;
+
+        result = EXIT_SUCCESS;
+
+m_deinit:
+        led_setup_destroy(stream);
+        led_setup_destroy(dom);
+        if(n)
+                led_prefs_node_free(n);
+        if(p)
+                led_prefs_deinit(p);
+        remove(CONFIG);
+
+        return result;
+}
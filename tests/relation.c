@@ -0,0 +1,127 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <niftyled.h>
+#include "_relation.h"
+
+
+/**
+ * move parts of sibling lists between lists with _relation_append() and
+ * check that the remaining siblings still have a valid list afterwards.
+ */
+
+
+/** check amount of siblings and last sibling of the list "r" belongs to */
+static bool _check(const char *name, Relation * r, int count, Relation * last)
+{
+        if(_relation_sibling_count(_relation_first(r)) != count - 1 ||
+           _relation_last(r) != last ||
+           _relation_nth(_relation_first(r), count - 1) != last)
+        {
+                fprintf(stderr, "list \"%s\" is broken\n", name);
+                return false;
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_FATAL))
+                return EXIT_FAILURE;
+
+        Relation a = { 0 }, b = { 0 }, c = { 0 }, d = { 0 };
+        Relation x = { 0 }, y = { 0 };
+        Relation p = { 0 }, q = { 0 }, z = { 0 };
+
+        /* a b c d & x y */
+        if(!_relation_append(&a, &b) ||
+           !_relation_append(&a, &c) ||
+           !_relation_append(&a, &d) || !_relation_append(&x, &y))
+                return EXIT_FAILURE;
+
+        /* move c d from the middle of a's list: a b & x y c d */
+        if(!_relation_append(&x, &c))
+                return EXIT_FAILURE;
+
+        if(!_check("a", &a, 2, &b) ||
+           !_check("x", &d, 4, &d) || _relation_next(&b) != NULL)
+                return EXIT_FAILURE;
+
+        /* move b, so a remains without siblings: a & x y c d b */
+        if(!_relation_append(&y, &b))
+                return EXIT_FAILURE;
+
+        if(!_check("a", &a, 1, &a) || !_check("x", &x, 5, &b))
+                return EXIT_FAILURE;
+
+        /* move head of list: p & z q */
+        if(!_relation_append(&p, &q) || !_relation_append(&z, &q))
+                return EXIT_FAILURE;
+
+        if(!_check("p", &p, 1, &p) || !_check("z", &z, 2, &q))
+                return EXIT_FAILURE;
+
+        /* objects can't be appended to their own list */
+        if(_relation_append(&x, &c))
+                return EXIT_FAILURE;
+
+        _relation_unlink(&q);
+        _relation_unlink(&z);
+        _relation_unlink(&c);
+        _relation_unlink(&x);
+        _relation_unlink(&b);
+        _relation_unlink(&y);
+        _relation_unlink(&d);
+        _relation_unlink(&a);
+        _relation_unlink(&p);
+
+        return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+		 * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+		 *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <limits.h>
+#include <niftyled.h>
+
+
+/**
+ * compare spatial queries of a LedSpace against a linear scan over all LEDs
+ * and print the time both need. Uses the built-in "capture" hardware plugin.
+ */
+
+
+/** amount of LEDs in test setup */
+#define LEDS            30000
+/** width & height of area LEDs are spread over */
+#define AREA            1024
+/** amount of queries */
+#define QUERIES         2000
+/** exit code to skip test */
+#define EXIT_SKIP       77
+
+
+
+/** current time in seconds */
+static double _now()
+{
+        struct timespec t;
+        clock_gettime(CLOCK_MONOTONIC, &t);
+        return (double) t.tv_sec + (double) t.tv_nsec / 1000000000.0;
+}
+
+
+/** find LEDs inside rectangle by testing every LED of every chain */
+static LedCount _linear_rect(LedSpace * sp,
+                             LedFrameCord x1, LedFrameCord y1,
+                             LedFrameCord x2, LedFrameCord y2,
+                             LedSpaceHit * hits)
+{
+        LedCount found = 0;
+        int i;
+        for(i = 0; i < led_space_get_chain_count(sp); i++)
+        {
+                LedChain *c = led_space_get_chain(sp, i, NULL);
+
+                LedCount n;
+                for(n = 0; n < led_chain_get_ledcount(c); n++)
+                {
+                        LedFrameCord x, y;
+                        led_get_pos(led_chain_get_nth(c, n), &x, &y);
+                        if(x < x1 || x >= x2 || y < y1 || y >= y2)
+                                continue;
+
+                        hits[found].chain = i;
+                        hits[found].led = n;
+                        found++;
+                }
+        }
+
+        return found;
+}
+
+
+int main(int argc, char *argv[])
+{
+        int result = EXIT_FAILURE;
+        LedSetup *s = NULL;
+        LedHardware *h = NULL;
+        LedTile *t = NULL;
+        LedSpace *sp = NULL;
+        LedSpaceHit *hits = NULL, *expected = NULL;
+
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_WARNING))
+                return EXIT_FAILURE;
+
+        /* create hardware (skip test if plugin isn't available) */
+        if(!(h = led_hardware_new("benchmark", "capture")))
+                return EXIT_SKIP;
+
+        if(!led_hardware_init(h, "*", LEDS, "RGB u8"))
+        {
+                led_hardware_destroy(h);
+                return EXIT_SKIP;
+        }
+
+        if(!(s = led_setup_new()))
+                goto m_deinit;
+        led_setup_set_hardware(s, h);
+
+
+        /* one tile with randomly placed LEDs */
+        LedChain *c;
+        if(!(c = led_chain_new(LEDS, "RGB u8")))
+                goto m_deinit;
+
+        srand(42);
+        LedCount n;
+        for(n = 0; n < LEDS; n++)
+        {
+                led_set_pos(led_chain_get_nth(c, n), rand() % AREA,
+                            rand() % AREA);
+                led_set_component(led_chain_get_nth(c, n), n % 3);
+        }
+
+        if(!(t = led_tile_new()))
+        {
+                led_chain_destroy(c);
+                goto m_deinit;
+        }
+        led_tile_set_chain(t, c);
+
+        if(!led_hardware_append_tile(h, t))
+                goto m_deinit;
+        t = NULL;
+
+
+        /* map & index */
+        if(!led_hardware_list_refresh_mapping(h))
+                goto m_deinit;
+
+        double start = _now();
+        if(!(sp = led_space_new(s)))
+                goto m_deinit;
+        double index_time = _now() - start;
+
+        if(!(hits = calloc(LEDS, sizeof(LedSpaceHit))) ||
+           !(expected = calloc(LEDS, sizeof(LedSpaceHit))))
+                goto m_deinit;
+
+
+        /* compare results of random queries */
+        double indexed = 0, linear = 0;
+        int q;
+        for(q = 0; q < QUERIES; q++)
+        {
+                LedFrameCord x = rand() % (AREA + 64) - 32;
+                LedFrameCord y = rand() % (AREA + 64) - 32;
+                LedFrameCord w = rand() % 64;
+                LedFrameCord hh = rand() % 64;
+
+                start = _now();
+                LedCount found = led_space_find_rect(sp, x, y, x + w, y + hh,
+                                                     hits, LEDS);
+                indexed += _now() - start;
+
+                start = _now();
+                LedCount ref = _linear_rect(sp, x, y, x + w, y + hh, expected);
+                linear += _now() - start;
+
+                if(found != ref)
+                {
+                        fprintf(stderr, "query %d: found %ld LEDs instead of %ld\n",
+                                q, found, ref);
+                        goto m_deinit;
+                }
+
+                for(n = 0; n < found; n++)
+                {
+                        if(hits[n].chain != expected[n].chain ||
+                           hits[n].led != expected[n].led)
+                        {
+                                fprintf(stderr, "query %d: hit %ld differs\n",
+                                        q, n);
+                                goto m_deinit;
+                        }
+                }
+        }
+
+        /* radius queries must only return LEDs inside the circle */
+        for(q = 0; q < QUERIES; q++)
+        {
+                LedFrameCord x = rand() % AREA;
+                LedFrameCord y = rand() % AREA;
+                LedFrameCord r = rand() % 32;
+
+                LedCount found = led_space_find_radius(sp, x, y, r, hits, LEDS);
+                for(n = 0; n < found; n++)
+                {
+                        LedFrameCord lx, ly;
+                        led_get_pos(led_chain_get_nth
+                                    (led_space_get_chain(sp, hits[n].chain,
+                                                         NULL), hits[n].led),
+                                    &lx, &ly);
+                        if((lx - x) * (lx - x) + (ly - y) * (ly - y) > r * r)
+                        {
+                                fprintf(stderr, "query %d: LED outside radius\n",
+                                        q);
+                                goto m_deinit;
+                        }
+                }
+        }
+
+        /* queries near the limits of LedFrameCord must not overflow */
+        if(led_space_find_radius(sp, INT_MAX, INT_MAX, 16, hits, LEDS) != 0 ||
+           led_space_find_radius(sp, INT_MIN, INT_MIN, 16, hits, LEDS) != 0)
+        {
+                fprintf(stderr, "found LEDs far outside of setup\n");
+                goto m_deinit;
+        }
+
+        if(led_space_find_radius(sp, 0, 0, INT_MAX, hits, LEDS) != LEDS)
+        {
+                fprintf(stderr, "huge radius didn't find all LEDs\n");
+                goto m_deinit;
+        }
+
+        printf("%d LEDs, %d rectangle queries\n", LEDS, QUERIES);
+        printf("building index: %f s\n", index_time);
+        printf("indexed: %f s, linear scan: %f s\n", indexed, linear);
+
+        result = EXIT_SUCCESS;
+
+
+m_deinit:
+        free(hits);
+        free(expected);
+        led_space_destroy(sp);
+        led_tile_destroy(t);
+        led_setup_destroy(s);
+
+        return result;
+}
@@ -0,0 +1,237 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <niftyled.h>
+#include "_stats.h"
+
+
+/**
+ * check bucket index & bounds of the timing histograms and the mean,
+ * percentiles & maximum calculated from them.
+ */
+
+
+/** linear sub-buckets per power of two */
+#define SUB             16
+/** largest value that's still resolved (2^41 - 1) */
+#define RESOLVED        ((1ULL << 41) - 1)
+
+
+
+/** check that v falls into a bucket that's at most 1/SUB wider than v */
+static bool _check_bucket(unsigned long long v)
+{
+        int b = _stats_bucket(v);
+        long long max = _stats_bucket_max(b);
+        long long below = b > 0 ? _stats_bucket_max(b - 1) : -1;
+
+        if((long long) v > max || (long long) v <= below)
+        {
+                fprintf(stderr, "%llu not in bucket %d (%lld..%lld]\n",
+                        v, b, below, max);
+                return false;
+        }
+
+        if((unsigned long long) (max - below) > v / SUB + 1)
+        {
+                fprintf(stderr, "bucket %d of %llu too wide (%lld..%lld]\n",
+                        b, v, below, max);
+                return false;
+        }
+
+        return true;
+}
+
+
+/** check bucket index of values */
+static bool _buckets()
+{
+        /* small values have their own bucket */
+        unsigned long long v;
+        for(v = 0; v < SUB; v++)
+        {
+                if(_stats_bucket(v) != (int) v ||
+                   _stats_bucket_max((int) v) != (long long) v)
+                {
+                        fprintf(stderr, "%llu isn't in its own bucket\n", v);
+                        return false;
+                }
+        }
+
+        /* every value up to 2^20, then around every power of two */
+        for(v = 0; v < (1 << 20); v++)
+        {
+                if(!_check_bucket(v))
+                        return false;
+        }
+
+        int bit;
+        for(bit = 20; bit <= 41; bit++)
+        {
+                unsigned long long p = 1ULL << bit;
+                if(!_check_bucket(p - 1) ||
+                   (p <= RESOLVED &&
+                    (!_check_bucket(p) || !_check_bucket(p + 1))))
+                        return false;
+        }
+
+        /* buckets are consecutive */
+        int last = _stats_bucket(RESOLVED);
+        int b;
+        for(b = 1; b <= last; b++)
+        {
+                if(_stats_bucket(_stats_bucket_max(b - 1) + 1) != b)
+                {
+                        fprintf(stderr, "bucket %d doesn't follow %d\n", b,
+                                b - 1);
+                        return false;
+                }
+        }
+
+        /* larger values saturate in last bucket */
+        if(_stats_bucket(RESOLVED + 1) != last ||
+           _stats_bucket(~0ULL) != last)
+        {
+                fprintf(stderr, "large values don't saturate\n");
+                return false;
+        }
+
+        return true;
+}
+
+
+/** check summary of a stage against expected values (within 1/SUB) */
+static bool _summary(LedStats * s, unsigned long long count, long long mean,
+                     long long p50, long long p99, long long max)
+{
+        LedStageStats r;
+        _stats_get(s, LED_STAGE_SEND, &r);
+
+        if(r.count != count || r.mean != mean || r.max != max ||
+           r.p50 < p50 || r.p50 > p50 + p50 / SUB ||
+           r.p99 < p99 || r.p99 > p99 + p99 / SUB || r.p99 > max)
+        {
+                fprintf(stderr, "got count=%llu mean=%lld p50=%lld "
+                        "p99=%lld max=%lld, expected count=%llu mean=%lld "
+                        "p50=%lld p99=%lld max=%lld\n", r.count, r.mean,
+                        r.p50, r.p99, r.max, count, mean, p50, p99, max);
+                return false;
+        }
+
+        return true;
+}
+
+
+/** check percentiles of recorded values */
+static bool _percentiles()
+{
+        LedStats *s;
+        if(!(s = _stats_new()))
+                return false;
+
+        bool result = false;
+
+        /* nothing recorded */
+        if(!_summary(s, 0, 0, 0, 0, 0))
+                goto _p_end;
+
+        /* one value (percentiles are limited by maximum) */
+        _stats_record(s, LED_STAGE_SEND, 12345);
+        if(!_summary(s, 1, 12345, 12345, 12345, 12345))
+                goto _p_end;
+
+        /* 1..1000 */
+        _stats_reset(s);
+        long long v;
+        for(v = 1; v <= 1000; v++)
+                _stats_record(s, LED_STAGE_SEND, v);
+        if(!_summary(s, 1000, 500, 500, 990, 1000))
+                goto _p_end;
+
+        /* outlier only shows in maximum */
+        for(v = 1; v <= 1000; v++)
+                _stats_record(s, LED_STAGE_SEND, 100);
+        _stats_record(s, LED_STAGE_SEND, 1000000);
+        LedStageStats r;
+        _stats_get(s, LED_STAGE_SEND, &r);
+        if(r.count != 2001 || r.max != 1000000 || r.p99 > 1000 ||
+           r.p50 < 100 || r.p50 > 100 + 100 / SUB)
+        {
+                fprintf(stderr, "outlier: p50=%lld p99=%lld max=%lld\n",
+                        r.p50, r.p99, r.max);
+                goto _p_end;
+        }
+
+        /* negative durations count as 0, other stages are untouched */
+        _stats_reset(s);
+        _stats_record(s, LED_STAGE_SEND, -5);
+        if(!_summary(s, 1, 0, 0, 0, 0))
+                goto _p_end;
+        _stats_get(s, LED_STAGE_SHOW, &r);
+        if(r.count != 0)
+                goto _p_end;
+
+        result = true;
+
+_p_end:
+        _stats_free(s);
+        return result;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_WARNING))
+                return EXIT_FAILURE;
+
+        if(!_buckets() || !_percentiles())
+                return EXIT_FAILURE;
+
+        return EXIT_SUCCESS;
+}
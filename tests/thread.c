@@ -0,0 +1,148 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <niftyled.h>
+#include "_thread.h"
+
+
+/**
+ * run jobs with _thread_pool_run() on different amounts of threads and
+ * check that every job runs exactly once and that all jobs run in the
+ * calling thread if no additional threads are allowed.
+ */
+
+
+/** maximum amount of jobs */
+#define JOBS            1000
+
+
+
+/** result of one job */
+typedef struct
+{
+        /** how often job ran */
+        int runs;
+        /** thread that ran job */
+        pthread_t thread;
+} Job;
+
+
+
+/** job: remember that it ran & who ran it */
+static void _job(size_t job, void *data)
+{
+        Job *jobs = data;
+
+        jobs[job].runs++;
+        jobs[job].thread = pthread_self();
+}
+
+
+/** run "n" jobs on "threads" threads and check results */
+static bool _run(size_t n, size_t threads)
+{
+        static Job jobs[JOBS];
+        memset(jobs, 0, sizeof(jobs));
+
+        if(!_thread_pool_run(_job, jobs, n, threads))
+        {
+                fprintf(stderr, "%lu jobs on %lu threads failed\n",
+                        (unsigned long) n, (unsigned long) threads);
+                return false;
+        }
+
+        size_t i;
+        for(i = 0; i < JOBS; i++)
+        {
+                int expected = i < n ? 1 : 0;
+                if(jobs[i].runs != expected)
+                {
+                        fprintf(stderr,
+                                "%lu jobs on %lu threads: job %lu ran %d times\n",
+                                (unsigned long) n, (unsigned long) threads,
+                                (unsigned long) i, jobs[i].runs);
+                        return false;
+                }
+
+                /* without additional threads, caller runs everything */
+                if(i < n && threads <= 1 &&
+                   !pthread_equal(jobs[i].thread, pthread_self()))
+                {
+                        fprintf(stderr, "job %lu didn't run in caller\n",
+                                (unsigned long) i);
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_WARNING))
+                return EXIT_FAILURE;
+
+        if(!_run(0, 4) ||
+           !_run(1, 0) ||
+           !_run(JOBS, 0) ||
+           !_run(JOBS, 1) ||
+           !_run(3, 16) ||
+           !_run(JOBS, 2) ||
+           !_run(JOBS, 8))
+                return EXIT_FAILURE;
+
+        /* NULL function */
+        if(_thread_pool_run(NULL, NULL, 1, 1))
+                return EXIT_FAILURE;
+
+        return EXIT_SUCCESS;
+}
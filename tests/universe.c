@@ -0,0 +1,226 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+		 * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+		 *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <niftyled.h>
+
+
+/**
+ * split a chain into DMX universes and send them as Art-Net (ArtDmx)
+ * packets over UDP loopback without copying the chain buffer. Every
+ * received universe is compared against the chain buffer. Uses the
+ * built-in "capture" hardware plugin as stand-in for a network node.
+ */
+
+
+/** amount of LEDs in test chain (512 RGB pixels) */
+#define LEDS            1536
+/** slots per DMX universe */
+#define SLOTS           512
+/** size of ArtDmx header */
+#define ARTDMX_HEADER   18
+/** exit code to skip test */
+#define EXIT_SKIP       77
+
+
+
+/** send all universes of hardware & compare what we receive */
+static int _loopback(LedHardware * h, LedUniversePacking packing,
+                     int tx, int rx, struct sockaddr_in *to)
+{
+        if(!led_hardware_set_universes(h, SLOTS, packing))
+                return EXIT_FAILURE;
+
+        LedChain *c = led_hardware_get_chain(h);
+        const unsigned char *buffer = led_chain_get_buffer(c);
+        size_t total = 0;
+
+        int u;
+        for(u = 0; u < led_hardware_get_universe_count(h); u++)
+        {
+                const LedUniverse *v;
+                if(!(v = led_hardware_get_universe(h, u)))
+                        return EXIT_FAILURE;
+
+                /* no pixel may cross universes */
+                if(packing == LED_UNIVERSE_PIXEL_ALIGNED &&
+                   (v->offset % 3 != 0 || v->size % 3 != 0))
+                {
+                        fprintf(stderr, "universe %d splits a pixel\n", u);
+                        return EXIT_FAILURE;
+                }
+
+                /* ArtDmx header (length must be even) */
+                size_t length = v->size + (v->size & 1);
+                unsigned char header[ARTDMX_HEADER] = {
+                        'A', 'r', 't', '-', 'N', 'e', 't', 0,
+                        0x00, 0x50, 0, 14, 0, 0,
+                        u & 0xff, (u >> 8) & 0x7f,
+                        (length >> 8) & 0xff, length & 0xff
+                };
+                unsigned char pad = 0;
+
+                /* header + view into chain buffer */
+                struct iovec iov[3] = {
+                        {.iov_base = header,.iov_len = sizeof(header)},
+                        {.iov_base = (void *) v->data,.iov_len = v->size},
+                        {.iov_base = &pad,.iov_len = length - v->size},
+                };
+                struct msghdr msg = {
+                        .msg_name = to,
+                        .msg_namelen = sizeof(*to),
+                        .msg_iov = iov,
+                        .msg_iovlen = 3,
+                };
+                if(sendmsg(tx, &msg, 0) < 0)
+                {
+                        perror("sendmsg");
+                        return EXIT_FAILURE;
+                }
+
+                unsigned char packet[ARTDMX_HEADER + SLOTS];
+                ssize_t r;
+                if((r = recv(rx, packet, sizeof(packet), 0)) !=
+                   (ssize_t) (ARTDMX_HEADER + length))
+                {
+                        fprintf(stderr, "universe %d: received %ld bytes\n",
+                                u, (long) r);
+                        return EXIT_FAILURE;
+                }
+
+                if(packet[14] != (u & 0xff) ||
+                   memcmp(packet + ARTDMX_HEADER,
+                          buffer + total, v->size) != 0)
+                {
+                        fprintf(stderr, "universe %d: wrong data\n", u);
+                        return EXIT_FAILURE;
+                }
+
+                total += v->size;
+        }
+
+        /* all of chain buffer sent? */
+        if(total != led_chain_get_buffer_size(c))
+        {
+                fprintf(stderr, "sent %lu of %lu bytes\n",
+                        (unsigned long) total,
+                        (unsigned long) led_chain_get_buffer_size(c));
+                return EXIT_FAILURE;
+        }
+
+        printf("%s: %d universes\n",
+               packing == LED_UNIVERSE_PACKED ? "packed" : "pixel-aligned",
+               led_hardware_get_universe_count(h));
+
+        return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char *argv[])
+{
+        int result = EXIT_FAILURE;
+        int tx = -1, rx = -1;
+        LedHardware *h = NULL;
+
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_WARNING))
+                return EXIT_FAILURE;
+
+        /* create hardware */
+        if(!(h = led_hardware_new("artnet", "capture")))
+                return EXIT_FAILURE;
+
+        if(!led_hardware_init(h, "node0", LEDS, "RGB u8"))
+                goto u_deinit;
+
+        unsigned char *buffer = led_chain_get_buffer(led_hardware_get_chain(h));
+        size_t i;
+        for(i = 0; i < led_chain_get_buffer_size(led_hardware_get_chain(h));
+            i++)
+                buffer[i] = (i * 7) & 0xff;
+
+
+        /* UDP loopback (skip test if we can't have it) */
+        struct sockaddr_in addr = {
+                .sin_family = AF_INET,
+                .sin_port = 0,
+        };
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if((rx = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+           (tx = socket(AF_INET, SOCK_DGRAM, 0)) < 0 ||
+           bind(rx, (struct sockaddr *) &addr, sizeof(addr)) < 0 ||
+           getsockname(rx, (struct sockaddr *) &addr, &len) < 0)
+        {
+                perror("socket");
+                result = EXIT_SKIP;
+                goto u_deinit;
+        }
+
+
+        if((result = _loopback(h, LED_UNIVERSE_PACKED, tx, rx, &addr))
+           != EXIT_SUCCESS)
+                goto u_deinit;
+
+        result = _loopback(h, LED_UNIVERSE_PIXEL_ALIGNED, tx, rx, &addr);
+
+
+u_deinit:
+        if(tx >= 0)
+                close(tx);
+        if(rx >= 0)
+                close(rx);
+        led_hardware_destroy(h);
+
+        return result;
+}
@@ -0,0 +1,291 @@
+/*
+ * libniftyled - Interface library for LED interfaces
+ * Copyright (C) 2006-2014 Daniel Hiepler <daniel@niftylight.de>
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ *
+ * Alternatively, the contents of this file may be used under the
+ * GNU Lesser General Public License Version 2.1 (the "LGPL"), in
+ * which case the following provisions apply instead of the ones
+ * mentioned above:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <niftyled.h>
+
+
+/**
+ * encode chains with every wire encoder and compare the frames captured by
+ * the built-in "capture" hardware plugin against known byte vectors.
+ */
+
+
+/** WS281x: zero bytes after a frame */
+#define WS281X_RESET    84
+/** DMX512: bytes per universe (start code + 512 slots) */
+#define DMX512_FRAME    513
+/** LEDs of DMX512 test chain (400 RGB pixels) */
+#define DMX_LEDS        1200
+
+
+
+/** create & initialize capture hardware with wire encoder */
+static LedHardware *_hardware(LedCount leds, const char *format,
+                              LedWireEncoder e)
+{
+        LedHardware *h;
+        if(!(h = led_hardware_new("wire", "capture")))
+                return NULL;
+
+        if(!led_hardware_init(h, "wire0", leds, format) ||
+           !led_hardware_set_wire_encoder(h, e))
+        {
+                led_hardware_destroy(h);
+                return NULL;
+        }
+
+        return h;
+}
+
+
+/** send & show hardware, return size of captured frame & write it to buf */
+static size_t _capture(LedHardware * h, bool dirty, unsigned char *buf,
+                       size_t size)
+{
+        if(!(dirty ? led_hardware_send_dirty(h) : led_hardware_send(h)) ||
+           !led_hardware_show(h))
+                return 0;
+
+        char *dump;
+        if(!led_hardware_plugin_prop_get_string(h, "frame", &dump))
+                return 0;
+
+        size_t n = strlen(dump) / 2;
+        if(n > size)
+                return 0;
+
+        size_t i;
+        for(i = 0; i < n; i++)
+        {
+                unsigned int v;
+                if(sscanf(dump + i * 2, "%2x", &v) != 1)
+                        return 0;
+                buf[i] = v;
+        }
+
+        return n;
+}
+
+
+/** compare captured frame against expected bytes */
+static bool _check(const char *name, const unsigned char *got, size_t gotsize,
+                   const unsigned char *expected, size_t size)
+{
+        if(gotsize != size)
+        {
+                fprintf(stderr, "%s: got %lu bytes instead of %lu\n", name,
+                        (unsigned long) gotsize, (unsigned long) size);
+                return false;
+        }
+
+        size_t i;
+        for(i = 0; i < size; i++)
+        {
+                if(got[i] != expected[i])
+                {
+                        fprintf(stderr, "%s: byte %lu is 0x%02x instead of 0x%02x\n",
+                                name, (unsigned long) i, got[i], expected[i]);
+                        return false;
+                }
+        }
+
+        return true;
+}
+
+
+/** APA102: start frame, 0xff + 3 bytes per pixel, end frame */
+static bool _apa102(unsigned char *buf, size_t size)
+{
+        static const unsigned char frame[] = {
+                0x00, 0x00, 0x00, 0x00,
+                0xff, 0x01, 0x02, 0x03,
+                0xff, 0x04, 0x05, 0x06,
+                0xff, 0xff, 0xff, 0xff,
+        };
+        static const unsigned char changed[] = {
+                0x00, 0x00, 0x00, 0x00,
+                0xff, 0x01, 0x02, 0x03,
+                0xff, 0x04, 0x80, 0x06,
+                0xff, 0xff, 0xff, 0xff,
+        };
+
+        LedHardware *h;
+        if(!(h = _hardware(6, "BGR u8", LED_WIRE_APA102)))
+                return false;
+
+        LedChain *c = led_hardware_get_chain(h);
+        unsigned char *b = led_chain_get_buffer(c);
+        int i;
+        for(i = 0; i < 6; i++)
+                b[i] = i + 1;
+
+        bool r = _check("apa102", buf, _capture(h, false, buf, size),
+                        frame, sizeof(frame));
+
+        /* partial send keeps the rest of the frame */
+        led_chain_set_greyscale(c, 4, 0x80);
+        r = r && _check("apa102 dirty", buf, _capture(h, true, buf, size),
+                        changed, sizeof(changed));
+
+        led_hardware_destroy(h);
+
+        /* APA102 has exactly 3 components per pixel */
+        if(!(h = _hardware(8, "RGBA u8", LED_WIRE_APA102)))
+                return false;
+
+        if(led_hardware_send(h))
+        {
+                fprintf(stderr, "apa102: RGBA chain was encoded\n");
+                r = false;
+        }
+
+        led_hardware_destroy(h);
+
+        return r;
+}
+
+
+/** WS281x-SPI: 3 SPI bits per data bit (1 -> 110, 0 -> 100) & reset */
+static bool _ws281x(unsigned char *buf, size_t size)
+{
+        unsigned char frame[9 + WS281X_RESET] = {
+                /* 0x00 */
+                0x92, 0x49, 0x24,
+                /* 0xff */
+                0xdb, 0x6d, 0xb6,
+                /* 0xa5 */
+                0xd3, 0x49, 0xa6,
+        };
+
+        LedHardware *h;
+        if(!(h = _hardware(3, "GRB u8", LED_WIRE_WS281X_SPI)))
+                return false;
+
+        unsigned char *b = led_chain_get_buffer(led_hardware_get_chain(h));
+        b[0] = 0x00;
+        b[1] = 0xff;
+        b[2] = 0xa5;
+
+        bool r = _check("ws281x-spi", buf, _capture(h, false, buf, size),
+                        frame, sizeof(frame));
+
+        led_hardware_destroy(h);
+
+        return r;
+}
+
+
+/** DMX512: null start code + 512 slots per universe */
+static bool _dmx512(unsigned char *buf, size_t size,
+                    LedUniversePacking packing, int universes)
+{
+        LedHardware *h;
+        if(!(h = _hardware(DMX_LEDS, "RGB u8", LED_WIRE_DMX512)))
+                return false;
+
+        /* default layout is 512 packed slots */
+        if(packing != LED_UNIVERSE_PACKED &&
+           !led_hardware_set_universes(h, 512, packing))
+        {
+                led_hardware_destroy(h);
+                return false;
+        }
+
+        unsigned char *b = led_chain_get_buffer(led_hardware_get_chain(h));
+        int i;
+        for(i = 0; i < DMX_LEDS; i++)
+                b[i] = (i * 7) & 0xff;
+
+        /* expected: slots of every universe as laid out, rest zero */
+        unsigned char *frame;
+        if(!(frame = calloc(universes, DMX512_FRAME)))
+        {
+                led_hardware_destroy(h);
+                return false;
+        }
+
+        size_t stride = packing == LED_UNIVERSE_PIXEL_ALIGNED ? 510 : 512;
+        for(i = 0; i < DMX_LEDS; i++)
+                frame[(i / stride) * DMX512_FRAME + 1 + i % stride] =
+                        (i * 7) & 0xff;
+
+        bool r = _check(packing == LED_UNIVERSE_PIXEL_ALIGNED ?
+                        "dmx512 pixel-aligned" : "dmx512 packed",
+                        buf, _capture(h, false, buf, size),
+                        frame, (size_t) universes * DMX512_FRAME);
+
+        free(frame);
+        led_hardware_destroy(h);
+
+        return r;
+}
+
+
+int main(int argc, char *argv[])
+{
+        /* check library version */
+        if(!LED_CHECK_VERSION)
+                return EXIT_FAILURE;
+
+        if(!nft_log_level_set(L_WARNING))
+                return EXIT_FAILURE;
+
+        size_t size = 4 * DMX512_FRAME;
+        unsigned char *buf;
+        if(!(buf = malloc(size)))
+                return EXIT_FAILURE;
+
+        int result = EXIT_FAILURE;
+        if(_apa102(buf, size) &&
+           _ws281x(buf, size) &&
+           _dmx512(buf, size, LED_UNIVERSE_PACKED, 3) &&
+           _dmx512(buf, size, LED_UNIVERSE_PIXEL_ALIGNED, 3))
+                result = EXIT_SUCCESS;
+
+        free(buf);
+
+        return result;
+}